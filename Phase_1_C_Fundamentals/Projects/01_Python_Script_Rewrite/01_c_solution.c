@@ -1,168 +1,1984 @@
+#define _DEFAULT_SOURCE  // madvise()
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <time.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#include <zlib.h>
 
-#define MAX_LINE_LENGTH 1024
-#define MAX_WORD_LENGTH 256
+#include "text_stats.h"
 
-typedef struct {
-    char filename[256];
-    int total_chars;
-    int total_words;
-    int total_lines;
-    char longest_word[MAX_WORD_LENGTH];
-    int longest_length;
-} TextStatistics;
+#define READ_BUFFER_SIZE (64 * 1024)
+#define MIN_CHUNK_SIZE (1024 * 1024)   // Smaller files are not worth a thread
+#define MAX_THREADS 256
+
+/* Incremental mode: sidecar file name, and bytes hashed at each end to recognize it */
+#define CHECKPOINT_SUFFIX ".wcstate"
+#define CHECKPOINT_HASHED 4096
+
+/* Compressed input: decompressed block size (two are in flight) and read size */
+#define DECOMPRESS_BLOCK (1024 * 1024)
+#define COMPRESSED_READ (256 * 1024)
+
+/* Follow mode: seconds between reports unless --interval says otherwise */
+#define DEFAULT_INTERVAL 5
+
+/* Many-file mode: small files are handed out in batches of about this size */
+#define BATCH_BYTES (1024 * 1024)
+#define BATCH_MAX_FILES 256
+
+/* Word frequency mode: strings are interned in blocks of this size */
+#define ARENA_BLOCK_SIZE (1024 * 1024)
+#define WORD_TABLE_INITIAL 4096
+
+/* Distinct word estimate: 2^14 one-byte registers, about 0.8% error */
+#define HLL_PRECISION 14
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+/**
+ * Scan bytes [offset, end) of a regular file through a read-only mapping,
+ * so the whole range is one buffer with no line length limit. Large
+ * ranges are split between up to `threads` threads. Returns -1 if the
+ * file cannot be mapped.
+ */
+static int scan_mapped(int fd, off_t offset, off_t end, int threads,
+                       TextStatsContext *counts) {
+    off_t base = offset - offset % sysconf(_SC_PAGESIZE);     // mmap wants whole pages
+    size_t skip = (size_t)(offset - base);
+    size_t size = (size_t)(end - offset);
+
+    if (size == 0) {
+        return 0;   // Nothing to map
+    }
+
+    char *mapping = mmap(NULL, skip + size, PROT_READ, MAP_PRIVATE, fd, base);
+    if (mapping == MAP_FAILED) {
+        return -1;
+    }
+    char *data = mapping + skip;
+
+    // Read front to back once: ask for aggressive read-ahead
+    madvise(mapping, skip + size, MADV_SEQUENTIAL);
+
+    if ((size_t)threads > size / MIN_CHUNK_SIZE) {
+        threads = (int)(size / MIN_CHUNK_SIZE);
+    }
+    ts_feed_parallel(counts, data, size, threads);
+    munmap(mapping, skip + size);
+    return 0;
+}
+
+/**
+ * Scan anything that cannot be mapped (pipes, terminals, /proc files)
+ * with plain read() calls. Returns -1 on a read error.
+ */
+static int scan_stream(int fd, TextStatsContext *counts) {
+    char buffer[READ_BUFFER_SIZE];
+    ssize_t n;
+
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        ts_feed(counts, buffer, (size_t)n);
+    }
+    return 0;
+}
 
 /**
- * Extract a single word from the line, removing punctuation.
- * Returns the length of the word, or 0 if at end of line.
+ * Compressed input. A second thread decompresses into two alternating
+ * blocks while this thread counts the other one, so decompression and
+ * counting overlap and nothing goes through a pipe. gzip comes from zlib;
+ * zstd is loaded at run time from libzstd.so.1 if it is installed, so it
+ * is not needed to build.
  */
-int extract_word(const char *line, int start_pos, char *word_buffer) {
-    int word_pos = 0;
+typedef void (*BufferHandler)(void *ctx, const char *buf, size_t len);
+
+typedef enum {
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD
+} Compression;
+
+/* Recognize the format from its magic number, not the file name */
+static Compression detect_compression(int fd) {
+    unsigned char magic[4];
+
+    if (pread(fd, magic, sizeof(magic), 0) < 2) {
+        return COMPRESSION_NONE;
+    }
+    if (magic[0] == 0x1F && magic[1] == 0x8B) {
+        return COMPRESSION_GZIP;
+    }
+    if (magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) {
+        return COMPRESSION_ZSTD;
+    }
+    return COMPRESSION_NONE;
+}
+
+/* The parts of the zstd streaming API we use (stable since zstd 1.0) */
+typedef struct {
+    const void *src;
+    size_t size;
+    size_t pos;
+} ZstdInBuffer;
+
+typedef struct {
+    void *dst;
+    size_t size;
+    size_t pos;
+} ZstdOutBuffer;
+
+static struct {
+    int loaded;                 // 1 = ok, -1 = not available
+    void *(*create)(void);
+    size_t (*release)(void *stream);
+    size_t (*init)(void *stream);
+    size_t (*decompress)(void *stream, ZstdOutBuffer *out, ZstdInBuffer *in);
+    unsigned (*is_error)(size_t code);
+    const char *(*error_name)(size_t code);
+} zstd;
+
+static pthread_mutex_t zstd_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int zstd_load(void) {
+    pthread_mutex_lock(&zstd_lock);
+    if (zstd.loaded == 0) {
+        void *lib = dlopen("libzstd.so.1", RTLD_NOW);
+
+        zstd.loaded = -1;
+        if (lib != NULL) {
+            *(void **)&zstd.create = dlsym(lib, "ZSTD_createDStream");
+            *(void **)&zstd.release = dlsym(lib, "ZSTD_freeDStream");
+            *(void **)&zstd.init = dlsym(lib, "ZSTD_initDStream");
+            *(void **)&zstd.decompress = dlsym(lib, "ZSTD_decompressStream");
+            *(void **)&zstd.is_error = dlsym(lib, "ZSTD_isError");
+            *(void **)&zstd.error_name = dlsym(lib, "ZSTD_getErrorName");
+            if (zstd.create && zstd.release && zstd.init && zstd.decompress &&
+                zstd.is_error && zstd.error_name) {
+                zstd.loaded = 1;
+            }
+        }
+    }
+    pthread_mutex_unlock(&zstd_lock);
+    return zstd.loaded > 0 ? 0 : -1;
+}
+
+/* Decompressor state, owned by the decompression thread */
+typedef struct {
+    int fd;
+    Compression kind;
+    unsigned char *input;
+    size_t input_length;        // Bytes in `input`
+    size_t input_pos;           // ... of which consumed
+    int input_eof;
+    z_stream gzip;
+    void *zstd_stream;
+    size_t zstd_pending;        // Last ZSTD_decompressStream() result: 0 = frame complete
+    int finished;
+    const char *error;
+} Decoder;
+
+static int decoder_refill(Decoder *dec) {
+    if (dec->input_pos < dec->input_length || dec->input_eof) {
+        return 0;
+    }
+    for (;;) {
+        ssize_t n = read(dec->fd, dec->input, COMPRESSED_READ);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            dec->error = strerror(errno);
+            return -1;
+        }
+        dec->input_length = (size_t)n;
+        dec->input_pos = 0;
+        dec->input_eof = n == 0;
+        return 0;
+    }
+}
+
+/* gzip: concatenated members are decoded one after another, like gzip -d */
+static size_t fill_gzip(Decoder *dec, char *out, size_t size) {
+    z_stream *z = &dec->gzip;
+
+    z->next_out = (Bytef *)out;
+    z->avail_out = (uInt)size;
+    while (z->avail_out > 0 && !dec->finished) {
+        if (decoder_refill(dec) < 0) {
+            break;
+        }
+        if (dec->input_pos == dec->input_length) {
+            dec->error = "unexpected end of compressed data";
+            break;
+        }
+        z->next_in = dec->input + dec->input_pos;
+        z->avail_in = (uInt)(dec->input_length - dec->input_pos);
+
+        int ret = inflate(z, Z_NO_FLUSH);
+        dec->input_pos = dec->input_length - z->avail_in;
 
-    // Skip whitespace
-    while (start_pos < (int)strlen(line) && isspace(line[start_pos])) {
-        start_pos++;
+        if (ret == Z_STREAM_END) {
+            // Another member follows, or the end (trailing garbage is ignored)
+            if (decoder_refill(dec) < 0) {
+                break;
+            }
+            if (dec->input_pos == dec->input_length || dec->input[dec->input_pos] != 0x1F) {
+                dec->finished = 1;
+            } else {
+                inflateReset(z);
+            }
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            dec->error = z->msg ? z->msg : "invalid gzip data";
+            break;
+        }
     }
+    return size - z->avail_out;
+}
 
-    // Copy alphanumeric characters only
-    while (start_pos < (int)strlen(line) && word_pos < MAX_WORD_LENGTH - 1) {
-        char c = line[start_pos];
+static size_t fill_zstd(Decoder *dec, char *out, size_t size) {
+    ZstdOutBuffer output = { out, size, 0 };
 
-        if (isalnum(c)) {
-            word_buffer[word_pos++] = c;
-        } else if (isspace(c)) {
-            break;  // End of word
+    while (output.pos < size && !dec->finished) {
+        if (decoder_refill(dec) < 0) {
+            break;
+        }
+        if (dec->input_pos == dec->input_length) {
+            if (dec->zstd_pending != 0) {
+                dec->error = "unexpected end of compressed data";
+            }
+            dec->finished = 1;
+            break;
         }
 
-        start_pos++;
+        ZstdInBuffer input = { dec->input, dec->input_length, dec->input_pos };
+        size_t ret = zstd.decompress(dec->zstd_stream, &output, &input);
+        dec->input_pos = input.pos;
+        if (zstd.is_error(ret)) {
+            dec->error = zstd.error_name(ret);
+            break;
+        }
+        dec->zstd_pending = ret;
     }
+    return output.pos;
+}
+
+/* The double buffer between the two threads */
+typedef struct {
+    Decoder decoder;
+    char *blocks[2];
+    size_t lengths[2];
+    int full[2];
+    int done;                   // Decompression thread has finished
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} Pipeline;
+
+static void *decompress_thread(void *arg) {
+    Pipeline *pipe = arg;
+    Decoder *dec = &pipe->decoder;
+
+    for (int slot = 0; ; slot ^= 1) {
+        pthread_mutex_lock(&pipe->lock);
+        while (pipe->full[slot]) {
+            pthread_cond_wait(&pipe->changed, &pipe->lock);
+        }
+        pthread_mutex_unlock(&pipe->lock);
 
-    word_buffer[word_pos] = '\0';  // Null terminate
-    return word_pos;                // Return word length
+        size_t length = dec->kind == COMPRESSION_GZIP
+                        ? fill_gzip(dec, pipe->blocks[slot], DECOMPRESS_BLOCK)
+                        : fill_zstd(dec, pipe->blocks[slot], DECOMPRESS_BLOCK);
+
+        pthread_mutex_lock(&pipe->lock);
+        if (length > 0) {
+            pipe->lengths[slot] = length;
+            pipe->full[slot] = 1;
+        }
+        if (length < DECOMPRESS_BLOCK) {
+            pipe->done = 1;     // End of data, or an error
+        }
+        pthread_cond_broadcast(&pipe->changed);
+        pthread_mutex_unlock(&pipe->lock);
+        if (length < DECOMPRESS_BLOCK) {
+            break;
+        }
+    }
+    return NULL;
 }
 
 /**
- * Count words in a line and extract them one by one.
- * Update longest_word if any word is longer than current longest.
+ * Decompress a whole file and pass it to handler() block by block. On
+ * failure returns -1 with *error describing it; the blocks before the
+ * error have been handled.
  */
-int process_line(const char *line, char *longest_word, int *longest_length) {
-    int word_count = 0;
-    int pos = 0;
-    char word[MAX_WORD_LENGTH];
+static int decompress_each_buffer(int fd, Compression kind, BufferHandler handler,
+                                  void *ctx, const char **error) {
+    Pipeline pipe;
+    pthread_t thread;
+    int status = 0;
+
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.decoder.fd = fd;
+    pipe.decoder.kind = kind;
+
+    if (kind == COMPRESSION_ZSTD && zstd_load() < 0) {
+        *error = "zstd input needs libzstd.so.1, which is not installed";
+        return -1;
+    }
+
+    pipe.decoder.input = malloc(COMPRESSED_READ);
+    pipe.blocks[0] = malloc(DECOMPRESS_BLOCK);
+    pipe.blocks[1] = malloc(DECOMPRESS_BLOCK);
+    if (pipe.decoder.input == NULL || pipe.blocks[0] == NULL || pipe.blocks[1] == NULL) {
+        *error = "out of memory";
+        status = -1;
+    } else if (kind == COMPRESSION_GZIP) {
+        if (inflateInit2(&pipe.decoder.gzip, 15 + 16) != Z_OK) {
+            *error = "cannot initialize zlib";
+            status = -1;
+        }
+    } else {
+        pipe.decoder.zstd_stream = zstd.create();
+        if (pipe.decoder.zstd_stream == NULL ||
+            zstd.is_error(zstd.init(pipe.decoder.zstd_stream))) {
+            *error = "cannot initialize zstd";
+            status = -1;
+        }
+    }
+    if (status < 0) {
+        free(pipe.decoder.input);
+        free(pipe.blocks[0]);
+        free(pipe.blocks[1]);
+        if (pipe.decoder.zstd_stream != NULL) {
+            zstd.release(pipe.decoder.zstd_stream);
+        }
+        return -1;
+    }
 
-    // Extract words from the line
-    while (pos < (int)strlen(line)) {
-        int word_len = extract_word(line, pos, word);
+    pthread_mutex_init(&pipe.lock, NULL);
+    pthread_cond_init(&pipe.changed, NULL);
 
-        if (word_len == 0) {
-            break;  // No more words
+    if (pthread_create(&thread, NULL, decompress_thread, &pipe) != 0) {
+        // No second thread: decompress and count in turns on this one
+        for (;;) {
+            size_t length = kind == COMPRESSION_GZIP
+                            ? fill_gzip(&pipe.decoder, pipe.blocks[0], DECOMPRESS_BLOCK)
+                            : fill_zstd(&pipe.decoder, pipe.blocks[0], DECOMPRESS_BLOCK);
+            if (length > 0) {
+                handler(ctx, pipe.blocks[0], length);
+            }
+            if (length < DECOMPRESS_BLOCK) {
+                break;
+            }
         }
+    } else {
+        for (int slot = 0; ; slot ^= 1) {
+            pthread_mutex_lock(&pipe.lock);
+            while (!pipe.full[slot] && !pipe.done) {
+                pthread_cond_wait(&pipe.changed, &pipe.lock);
+            }
+            int have = pipe.full[slot];
+            pthread_mutex_unlock(&pipe.lock);
+            if (!have) {
+                break;
+            }
 
-        word_count++;
+            handler(ctx, pipe.blocks[slot], pipe.lengths[slot]);
 
-        // Update longest word if this one is longer
-        if (word_len > *longest_length) {
-            *longest_length = word_len;
-            strncpy(longest_word, word, MAX_WORD_LENGTH - 1);
-            longest_word[MAX_WORD_LENGTH - 1] = '\0';  // Ensure null termination
+            pthread_mutex_lock(&pipe.lock);
+            pipe.full[slot] = 0;
+            pthread_cond_broadcast(&pipe.changed);
+            pthread_mutex_unlock(&pipe.lock);
         }
+        pthread_join(thread, NULL);
+    }
+
+    if (pipe.decoder.error != NULL) {
+        *error = pipe.decoder.error;
+        status = -1;
+    }
+    if (kind == COMPRESSION_GZIP) {
+        inflateEnd(&pipe.decoder.gzip);
+    } else {
+        zstd.release(pipe.decoder.zstd_stream);
+    }
+    pthread_cond_destroy(&pipe.changed);
+    pthread_mutex_destroy(&pipe.lock);
+    free(pipe.decoder.input);
+    free(pipe.blocks[0]);
+    free(pipe.blocks[1]);
+    return status;
+}
+
+/* Adapter so the decompressor can feed the counts */
+static void feed_counts(void *ctx, const char *buf, size_t len) {
+    ts_feed(ctx, buf, len);
+}
 
-        // Move position past this word and any whitespace
-        pos += strlen(word);
+/**
+ * 64-bit hash of a word, 8 bytes per step, with the splitmix64 finalizer
+ * so that every output bit depends on every input byte.
+ */
+static uint64_t hash_word(const char *word, size_t length) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ length;
+    uint64_t v;
+
+    while (length >= 8) {
+        memcpy(&v, word, 8);
+        h = (h ^ v) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+        word += 8;
+        length -= 8;
+    }
+    if (length > 0) {
+        v = 0;
+        memcpy(&v, word, length);
+        h = (h ^ v) * 0xBF58476D1CE4E5B9ULL;
     }
 
-    return word_count;
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
 }
 
 /**
- * Read a file and calculate text statistics.
+ * Where an incremental count stopped: the file it was for, how far it
+ * got, hashes of the first and the last CHECKPOINT_HASHED bytes before
+ * that point (to notice a file that was replaced or rewritten rather
+ * than appended to), and the counts and scanner state at that point -
+ * before ts_finish(), so a word or line left open at the end continues
+ * into the appended data. Edits between the two hashed ends go unnoticed.
  */
-TextStatistics count_text_statistics(const char *filename) {
+typedef struct {
+    unsigned long long device;
+    unsigned long long inode;
+    long long offset;
+    uint64_t head_hash;
+    uint64_t tail_hash;
     TextStatistics stats;
+    ScanState state;
+} Checkpoint;
+
+/* Hash `length` (at most CHECKPOINT_HASHED) bytes starting at `start` */
+static int hash_range(int fd, long long start, size_t length, uint64_t *hash) {
+    char buffer[CHECKPOINT_HASHED];
+    size_t have = 0;
+
+    while (have < length) {
+        ssize_t n = pread(fd, buffer + have, length - have, start + (off_t)have);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        have += (size_t)n;
+    }
+    *hash = hash_word(buffer, length);
+    return 0;
+}
+
+/* Hash the CHECKPOINT_HASHED bytes (or fewer) at each end of the first `offset` */
+static int hash_ends(int fd, long long offset, uint64_t *head, uint64_t *tail) {
+    size_t length = offset < CHECKPOINT_HASHED ? (size_t)offset : CHECKPOINT_HASHED;
+
+    if (hash_range(fd, 0, length, head) < 0) {
+        return -1;
+    }
+    return hash_range(fd, offset - (long long)length, length, tail);
+}
+
+static char *checkpoint_path(const char *filename) {
+    size_t length = strlen(filename) + sizeof(CHECKPOINT_SUFFIX);
+    char *path = malloc(length);
+
+    if (path != NULL) {
+        snprintf(path, length, "%s%s", filename, CHECKPOINT_SUFFIX);
+    }
+    return path;
+}
+
+/**
+ * Read a sidecar file: one "key value" per line. Returns -1 if there is
+ * none or it is not one of ours; the caller then counts from the start.
+ */
+static int load_checkpoint(const char *filename, Checkpoint *cp) {
+    char *path = checkpoint_path(filename);
+    FILE *file = path ? fopen(path, "r") : NULL;
+    char line[512];
+    int fields = 0;
+
+    free(path);
+    if (file == NULL) {
+        return -1;
+    }
+    memset(cp, 0, sizeof(*cp));
+
+    if (fgets(line, sizeof(line), file) == NULL || strcmp(line, "word_counter checkpoint 2\n") != 0) {
+        fclose(file);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *value = strchr(line, ' ');
+        if (value == NULL) {
+            continue;
+        }
+        *value++ = '\0';
+        value[strcspn(value, "\n")] = '\0';
+
+        if (strcmp(line, "device") == 0) {
+            cp->device = strtoull(value, NULL, 10);
+        } else if (strcmp(line, "inode") == 0) {
+            cp->inode = strtoull(value, NULL, 10);
+        } else if (strcmp(line, "offset") == 0) {
+            cp->offset = strtoll(value, NULL, 10);
+        } else if (strcmp(line, "head_hash") == 0) {
+            cp->head_hash = strtoull(value, NULL, 16);
+        } else if (strcmp(line, "tail_hash") == 0) {
+            cp->tail_hash = strtoull(value, NULL, 16);
+        } else if (strcmp(line, "chars") == 0) {
+            cp->stats.total_chars = strtoll(value, NULL, 10);
+        } else if (strcmp(line, "words") == 0) {
+            cp->stats.total_words = strtoll(value, NULL, 10);
+        } else if (strcmp(line, "lines") == 0) {
+            cp->stats.total_lines = strtoll(value, NULL, 10);
+        } else if (strcmp(line, "longest_length") == 0) {
+            cp->stats.longest_length = strtoll(value, NULL, 10);
+        } else if (strcmp(line, "longest_word") == 0) {
+            strncpy(cp->stats.longest_word, value, MAX_WORD_LENGTH - 1);
+        } else if (strcmp(line, "in_word") == 0) {
+            cp->state.in_word = atoi(value) != 0;
+        } else if (strcmp(line, "in_line") == 0) {
+            cp->state.in_line = atoi(value) != 0;
+        } else if (strcmp(line, "word_length") == 0) {
+            cp->state.word_length = strtoll(value, NULL, 10);
+        } else if (strcmp(line, "partial") == 0) {
+            strncpy(cp->state.partial, value, MAX_WORD_LENGTH - 1);
+            cp->state.partial_length = (int)strlen(cp->state.partial);
+        } else {
+            continue;
+        }
+        fields++;
+    }
+    fclose(file);
+
+    // All 14 fields, and counts that agree with the offset
+    if (fields != 14 || cp->offset < 0 || cp->stats.total_chars != cp->offset) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Write the sidecar next to the file, via a rename so it is never half written */
+static int save_checkpoint(const char *filename, const Checkpoint *cp) {
+    char *path = checkpoint_path(filename);
+    char *temp = path ? malloc(strlen(path) + 5) : NULL;
+    FILE *file = NULL;
+    int status = -1;
+
+    if (temp != NULL) {
+        sprintf(temp, "%s.tmp", path);
+        file = fopen(temp, "w");
+    }
+    if (file != NULL) {
+        fprintf(file, "word_counter checkpoint 2\n");
+        fprintf(file, "device %llu\ninode %llu\n", cp->device, cp->inode);
+        fprintf(file, "offset %lld\nhead_hash %016llx\ntail_hash %016llx\n", cp->offset,
+                (unsigned long long)cp->head_hash, (unsigned long long)cp->tail_hash);
+        fprintf(file, "chars %lld\nwords %lld\nlines %lld\n", cp->stats.total_chars,
+                cp->stats.total_words, cp->stats.total_lines);
+        fprintf(file, "longest_length %lld\nlongest_word %s\n", cp->stats.longest_length,
+                cp->stats.longest_word);
+        fprintf(file, "in_word %d\nin_line %d\nword_length %lld\npartial %.*s\n",
+                cp->state.in_word, cp->state.in_line, cp->state.word_length,
+                cp->state.partial_length, cp->state.partial);
+        status = fclose(file) == 0 && rename(temp, path) == 0 ? 0 : -1;
+        if (status < 0) {
+            remove(temp);
+        }
+    }
+    if (status < 0) {
+        fprintf(stderr, "Warning: Cannot save checkpoint for '%s'\n", filename);
+    }
+    free(path);
+    free(temp);
+    return status;
+}
+
+/**
+ * Count one file into *stats. Errors are reported on stderr and return -1.
+ * Files smaller than one read buffer are read rather than mapped: for
+ * them, setting up and tearing down the mapping costs more than the copy.
+ *
+ * With `incremental`, a regular file is counted from where its checkpoint
+ * stopped, if the checkpoint is for this file and the bytes at both ends
+ * of what it covers have not changed; a new checkpoint is saved afterwards.
+ */
+static int count_file(const char *filename, int threads, int incremental,
+                      TextStatistics *stats) {
+    TextStatsContext counts;
 
     // Initialize structure
-    strncpy(stats.filename, filename, sizeof(stats.filename) - 1);
-    stats.filename[sizeof(stats.filename) - 1] = '\0';
-    stats.total_chars = 0;
-    stats.total_words = 0;
-    stats.total_lines = 0;
-    stats.longest_word[0] = '\0';
-    stats.longest_length = 0;
+    ts_init(&counts);
+    strncpy(counts.stats.filename, filename, sizeof(counts.stats.filename) - 1);
+    *stats = counts.stats;
 
     // Open file for reading
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
-        perror("fopen");
-        exit(1);
+        perror("open");
+        return -1;
     }
 
-    char line[MAX_LINE_LENGTH];
+    struct stat st;
+    int status = -1;
+    int regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    Compression kind = regular ? detect_compression(fd) : COMPRESSION_NONE;
+    off_t start = 0;
+    Checkpoint cp;
 
-    // Read file line by line
-    while (fgets(line, sizeof(line), file) != NULL) {
-        stats.total_lines++;
+    // Compressed: count the decompressed text (no checkpoints, offsets
+    // in a compressed stream cannot be resumed from)
+    if (kind != COMPRESSION_NONE) {
+        const char *error = NULL;
+
+        status = decompress_each_buffer(fd, kind, feed_counts, &counts, &error);
+        *stats = ts_finish(&counts);
+        close(fd);
+        if (status < 0) {
+            fprintf(stderr, "Error reading file '%s': %s\n", filename, error);
+            return -1;
+        }
+        return 0;
+    }
+
+    // Pick up where the last run stopped
+    if (incremental && regular && load_checkpoint(filename, &cp) == 0) {
+        uint64_t head, tail;
+        if (cp.device == (unsigned long long)st.st_dev &&
+            cp.inode == (unsigned long long)st.st_ino &&
+            cp.offset <= (long long)st.st_size &&
+            hash_ends(fd, cp.offset, &head, &tail) == 0 &&
+            head == cp.head_hash && tail == cp.tail_hash) {
+            counts.stats.total_chars = cp.stats.total_chars;
+            counts.stats.total_words = cp.stats.total_words;
+            counts.stats.total_lines = cp.stats.total_lines;
+            counts.stats.longest_length = cp.stats.longest_length;
+            memcpy(counts.stats.longest_word, cp.stats.longest_word,
+                   sizeof(counts.stats.longest_word));
+            counts.state = cp.state;
+            start = (off_t)cp.offset;
+        }
+    }
 
-        // Count characters including newline
-        stats.total_chars += strlen(line);
+    // Map regular files; fall back to reading if that is not possible
+    if (regular && st.st_size - start >= READ_BUFFER_SIZE) {
+        status = scan_mapped(fd, start, st.st_size, threads, &counts);
+    }
+    if (status < 0 && (!regular || lseek(fd, start, SEEK_SET) == start)) {
+        status = scan_stream(fd, &counts);
+    }
 
-        // Process this line for words
-        int words_in_line = process_line(line, stats.longest_word, &stats.longest_length);
-        stats.total_words += words_in_line;
+    if (incremental && regular && status == 0) {
+        cp.device = (unsigned long long)st.st_dev;
+        cp.inode = (unsigned long long)st.st_ino;
+        cp.offset = counts.stats.total_chars;
+        cp.stats = counts.stats;
+        cp.state = counts.state;
+        if (hash_ends(fd, cp.offset, &cp.head_hash, &cp.tail_hash) == 0) {
+            save_checkpoint(filename, &cp);
+        }
     }
+    *stats = ts_finish(&counts);
 
     // Check for read errors
-    if (ferror(file)) {
-        fprintf(stderr, "Error reading file\n");
-        fclose(file);
-        exit(1);
+    if (status < 0) {
+        fprintf(stderr, "Error reading file '%s'\n", filename);
+        perror("read");
+        close(fd);
+        return -1;
     }
 
     // Clean up
-    fclose(file);
+    close(fd);
+    return 0;
+}
+
+/**
+ * Read a file and calculate text statistics, using up to `threads`
+ * threads for a large regular file (and a checkpoint if `incremental`).
+ */
+TextStatistics count_text_statistics(const char *filename, int threads, int incremental) {
+    TextStatistics stats;
 
+    if (count_file(filename, threads, incremental, &stats) < 0) {
+        exit(1);
+    }
     return stats;
 }
 
+/**
+ * Add one file's statistics to a running total. Files are added in
+ * order, so the longest word is the first one found, as in a single file.
+ */
+static void add_statistics(TextStatistics *total, const TextStatistics *stats) {
+    total->total_chars += stats->total_chars;
+    total->total_words += stats->total_words;
+    total->total_lines += stats->total_lines;
+    if (stats->longest_length > total->longest_length) {
+        memcpy(total->longest_word, stats->longest_word, sizeof(total->longest_word));
+        total->longest_length = stats->longest_length;
+    }
+}
+
 /**
  * Display statistics in formatted output.
  */
 void display_statistics(const TextStatistics *stats) {
     printf("=== Text Statistics ===\n");
     printf("File: %s\n", stats->filename);
-    printf("Total characters: %d\n", stats->total_chars);
-    printf("Total words: %d\n", stats->total_words);
-    printf("Total lines: %d\n", stats->total_lines);
+    printf("Total characters: %lld\n", stats->total_chars);
+    printf("Total words: %lld\n", stats->total_words);
+    printf("Total lines: %lld\n", stats->total_lines);
 
     if (stats->longest_length > 0) {
-        printf("Longest word: %s (%d characters)\n",
+        printf("Longest word: %s (%lld characters)\n",
                stats->longest_word, stats->longest_length);
     } else {
         printf("Longest word: (none)\n");
     }
 }
 
+typedef struct {
+    char *path;
+    long long size;
+} FileEntry;
+
+typedef struct {
+    FileEntry *files;
+    size_t count;
+    size_t capacity;
+    int skip_checkpoints;       // --incremental: leave out our .wcstate sidecars
+} FileList;
+
+static int add_file(FileList *list, const char *path, long long size) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        FileEntry *files = realloc(list->files, capacity * sizeof(*files));
+        if (files == NULL) {
+            fprintf(stderr, "Error: Out of memory\n");
+            return -1;
+        }
+        list->files = files;
+        list->capacity = capacity;
+    }
+
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return -1;
+    }
+    list->files[list->count].path = copy;
+    list->files[list->count].size = size;
+    list->count++;
+    return 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* A name ending in CHECKPOINT_SUFFIX */
+static int is_checkpoint_name(const char *name) {
+    size_t length = strlen(name);
+    size_t suffix = sizeof(CHECKPOINT_SUFFIX) - 1;
+
+    return length > suffix && strcmp(name + length - suffix, CHECKPOINT_SUFFIX) == 0;
+}
+
 /**
- * Main entry point.
+ * Add the files under a directory, in name order so the output does not
+ * depend on the file system. In incremental mode, checkpoint files are
+ * skipped. Symbolic links to directories are not followed (they could
+ * loop); links to files are counted. Returns the number of entries that
+ * could not be read.
  */
-int main(int argc, char *argv[]) {
-    // Check command line arguments
-    if (argc != 2) {
-        printf("Usage: %s <filename>\n", argv[0]);
-        printf("Example: %s sample_input.txt\n", argv[0]);
+static int add_directory(FileList *list, const char *dir) {
+    DIR *handle = opendir(dir);
+    if (handle == NULL) {
+        fprintf(stderr, "Error: Cannot open directory '%s'\n", dir);
+        perror("opendir");
+        return 1;
+    }
+
+    char **names = NULL;
+    size_t count = 0, capacity = 0;
+    int errors = 0;
+    struct dirent *entry;
+
+    while ((entry = readdir(handle)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 ||
+            (list->skip_checkpoints && is_checkpoint_name(entry->d_name))) {
+            continue;   // Our own checkpoints are not input
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 32;
+            char **grown = realloc(names, capacity * sizeof(*names));
+            if (grown == NULL) {
+                break;
+            }
+            names = grown;
+        }
+        if ((names[count] = strdup(entry->d_name)) == NULL) {
+            break;
+        }
+        count++;
+    }
+    if (entry != NULL) {
+        fprintf(stderr, "Error: Out of memory reading '%s'\n", dir);
+        errors++;
+    }
+    closedir(handle);
+    qsort(names, count, sizeof(*names), compare_names);
+
+    for (size_t i = 0; i < count; i++) {
+        size_t length = strlen(dir) + strlen(names[i]) + 2;
+        char *path = malloc(length);
+        struct stat st;
+
+        if (path == NULL) {
+            errors++;
+            free(names[i]);
+            continue;
+        }
+        snprintf(path, length, "%s%s%s", dir,
+                 dir[strlen(dir) - 1] == '/' ? "" : "/", names[i]);
+
+        if (lstat(path, &st) != 0) {
+            fprintf(stderr, "Error: Cannot open file '%s'\n", path);
+            perror("lstat");
+            errors++;
+        } else if (S_ISDIR(st.st_mode)) {
+            errors += add_directory(list, path);
+        } else if (S_ISLNK(st.st_mode)) {
+            if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+                errors += add_file(list, path, st.st_size) < 0;
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            errors += add_file(list, path, st.st_size) < 0;
+        }
+        free(path);
+        free(names[i]);
+    }
+    free(names);
+    return errors;
+}
+
+/**
+ * Add a command line argument: a file, or a directory to walk.
+ */
+static int add_path(FileList *list, const char *path) {
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", path);
+        perror("stat");
         return 1;
     }
+    if (S_ISDIR(st.st_mode)) {
+        return add_directory(list, path);
+    }
+    return add_file(list, path, S_ISREG(st.st_mode) ? st.st_size : 0) < 0;
+}
+
+/* Consecutive files [first, first + count) counted by one worker */
+typedef struct {
+    size_t first;
+    size_t count;
+    TextStatistics *results;
+    int *failed;
+    int done;
+} FileBatch;
 
-    const char *filename = argv[1];
+typedef struct {
+    const FileList *list;
+    FileBatch *batches;
+    size_t num_batches;
+    size_t next_batch;          // Next batch to hand out
+    size_t next_print;          // Next batch to print
+    TextStatistics total;
+    long long files_counted;
+    int errors;
+    int incremental;            // Use checkpoints
+    pthread_mutex_t lock;
+} FilePool;
 
-    // Count statistics
-    TextStatistics stats = count_text_statistics(filename);
+/* One line per file in the many-file and follow reports */
+static void print_file_header(void) {
+    printf("%10s %10s %12s %7s  %s\n", "Lines", "Words", "Characters", "Longest", "File");
+}
 
-    // Display results
-    display_statistics(&stats);
+static void print_file_row(const TextStatistics *stats, const char *path) {
+    printf("%10lld %10lld %12lld %7lld  %s\n", stats->total_lines, stats->total_words,
+           stats->total_chars, stats->longest_length, path);
+}
 
-    return 0;
+/**
+ * Print the batches that are finished, in order, and add them to the
+ * total. Called with the pool locked.
+ */
+static void print_finished(FilePool *pool) {
+    while (pool->next_print < pool->num_batches && pool->batches[pool->next_print].done) {
+        FileBatch *batch = &pool->batches[pool->next_print++];
+
+        for (size_t i = 0; i < batch->count; i++) {
+            const TextStatistics *stats = &batch->results[i];
+
+            if (batch->failed[i]) {
+                pool->errors++;
+                continue;
+            }
+            print_file_row(stats, pool->list->files[batch->first + i].path);
+            add_statistics(&pool->total, stats);
+            pool->files_counted++;
+        }
+        free(batch->results);
+        free(batch->failed);
+        batch->results = NULL;
+        batch->failed = NULL;
+    }
+}
+
+static void *file_worker(void *arg) {
+    FilePool *pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->next_batch < pool->num_batches) {
+        FileBatch *batch = &pool->batches[pool->next_batch++];
+        pthread_mutex_unlock(&pool->lock);
+
+        batch->results = malloc(batch->count * sizeof(*batch->results));
+        batch->failed = calloc(batch->count, sizeof(*batch->failed));
+        for (size_t i = 0; i < batch->count; i++) {
+            const char *path = pool->list->files[batch->first + i].path;
+            if (batch->results == NULL || batch->failed == NULL) {
+                fprintf(stderr, "Error: Out of memory counting '%s'\n", path);
+                exit(1);
+            }
+            batch->failed[i] = count_file(path, 1, pool->incremental, &batch->results[i]) < 0;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        batch->done = 1;
+        print_finished(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * Count every file on `threads` threads and print one line per file
+ * (lines, words, characters, longest word length, name) and the total.
+ * Small files are grouped into batches so each hand-out is worth the
+ * lock; each file is counted on a single thread. Returns the number of
+ * files that could not be read.
+ */
+static int count_many_files(const FileList *list, int threads, int incremental) {
+    FilePool pool;
+    pthread_t ids[MAX_THREADS];
+    int started;
+
+    memset(&pool, 0, sizeof(pool));
+    pool.list = list;
+    pool.incremental = incremental;
+    pool.batches = calloc(list->count ? list->count : 1, sizeof(*pool.batches));
+    if (pool.batches == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return (int)list->count;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+
+    for (size_t i = 0; i < list->count; ) {
+        FileBatch *batch = &pool.batches[pool.num_batches++];
+        long long bytes = 0;
+
+        batch->first = i;
+        do {
+            bytes += list->files[i++].size;
+        } while (i < list->count && bytes < BATCH_BYTES &&
+                 i - batch->first < BATCH_MAX_FILES);
+        batch->count = i - batch->first;
+    }
+
+    print_file_header();
+    for (started = 1; started < threads; started++) {
+        if (pthread_create(&ids[started], NULL, file_worker, &pool) != 0) {
+            break;
+        }
+    }
+    file_worker(&pool);
+    for (int i = 1; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+
+    snprintf(pool.total.filename, sizeof(pool.total.filename),
+             "total (%lld files)", pool.files_counted);
+    printf("\n");
+    display_statistics(&pool.total);
+
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.batches);
+    return pool.errors;
+}
+
+/**
+ * Call handler(ctx, buf, len) for the contents of a file: once with the
+ * whole file if it is mapped, or once per read() otherwise. Compressed
+ * files are decompressed on the way. Errors are reported on stderr and
+ * return -1.
+ */
+static int for_each_buffer(const char *filename, BufferHandler handler, void *ctx) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+        perror("open");
+        return -1;
+    }
+
+    struct stat st;
+    int regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    Compression kind = regular ? detect_compression(fd) : COMPRESSION_NONE;
+
+    if (kind != COMPRESSION_NONE) {
+        const char *error = NULL;
+        int status = decompress_each_buffer(fd, kind, handler, ctx, &error);
+        if (status < 0) {
+            fprintf(stderr, "Error reading file '%s': %s\n", filename, error);
+        }
+        close(fd);
+        return status;
+    }
+
+    if (regular && st.st_size >= READ_BUFFER_SIZE) {
+        char *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+            handler(ctx, data, (size_t)st.st_size);
+            munmap(data, (size_t)st.st_size);
+            close(fd);
+            return 0;
+        }
+    }
+
+    char buffer[READ_BUFFER_SIZE];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error reading file '%s'\n", filename);
+            perror("read");
+            close(fd);
+            return -1;
+        }
+        handler(ctx, buffer, (size_t)n);
+    }
+    close(fd);
+    return 0;
+}
+
+/**
+ * Bump allocator for word strings: one malloc per block, none per word,
+ * and everything is freed at once.
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+} Arena;
+
+static char *arena_copy(Arena *arena, const char *text, size_t length) {
+    ArenaBlock *block = arena->head;
+
+    if (block == NULL || block->size - block->used < length) {
+        size_t size = length > ARENA_BLOCK_SIZE ? length : ARENA_BLOCK_SIZE;
+        block = malloc(sizeof(ArenaBlock) + size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->used = 0;
+        block->size = size;
+        block->next = arena->head;
+        arena->head = block;
+    }
+
+    char *copy = block->data + block->used;
+    memcpy(copy, text, length);
+    block->used += length;
+    return copy;
+}
+
+static void arena_free(Arena *arena) {
+    while (arena->head != NULL) {
+        ArenaBlock *next = arena->head->next;
+        free(arena->head);
+        arena->head = next;
+    }
+}
+
+/**
+ * Splits buffers into words the way the longest-word search does: runs of
+ * non-space bytes, keeping only their alphanumeric characters. A word with
+ * no punctuation is passed on straight from the buffer; otherwise (or when
+ * it is cut off at the end of the buffer) it is collected in `current`.
+ */
+typedef struct {
+    char *current;
+    size_t current_length;
+    size_t current_size;
+    int failed;                 // Out of memory
+} WordReader;
+
+typedef void (*WordHandler)(void *ctx, const char *word, size_t length);
+
+static inline void read_words(WordReader *reader, const char *buf, size_t len,
+                              WordHandler handler, void *ctx) {
+    size_t i = 0;
+
+    while (i < len && !reader->failed) {
+        // Continue a word from the previous buffer, or skip to the next one
+        if (reader->current_length == 0) {
+            while (i < len && isspace((unsigned char)buf[i])) {
+                i++;
+            }
+            size_t start = i;
+            while (i < len && isalnum((unsigned char)buf[i])) {
+                i++;
+            }
+            if (i < len && isspace((unsigned char)buf[i])) {
+                if (i > start) {
+                    handler(ctx, buf + start, i - start);
+                }
+                continue;
+            }
+            i = start;
+        }
+
+        // Word with punctuation in it, or running past the end of buf
+        for (; i < len; i++) {
+            unsigned char c = (unsigned char)buf[i];
+
+            if (isspace(c)) {
+                if (reader->current_length > 0) {
+                    handler(ctx, reader->current, reader->current_length);
+                    reader->current_length = 0;
+                }
+                break;
+            }
+            if (isalnum(c)) {
+                if (reader->current_length == reader->current_size) {
+                    size_t size = reader->current_size ? reader->current_size * 2 : 256;
+                    char *grown = realloc(reader->current, size);
+                    if (grown == NULL) {
+                        reader->failed = 1;
+                        return;
+                    }
+                    reader->current = grown;
+                    reader->current_size = size;
+                }
+                reader->current[reader->current_length++] = (char)c;
+            }
+        }
+    }
+}
+
+/* End of a file: the last word ends here even without a space after it */
+static void finish_words(WordReader *reader, WordHandler handler, void *ctx) {
+    if (reader->current_length > 0) {
+        handler(ctx, reader->current, reader->current_length);
+        reader->current_length = 0;
+    }
+}
+
+/**
+ * Word counts in an open-addressing hash table (linear probing). The hash
+ * is stored with each entry, so probes compare it before the text and
+ * growing the table never hashes a word again.
+ */
+typedef struct {
+    uint64_t hash;
+    const char *word;           // In the arena, not NUL-terminated
+    size_t length;
+    long long count;
+} WordEntry;
+
+typedef struct {
+    WordEntry *entries;
+    size_t capacity;            // Power of two
+    size_t used;
+    TextStatsContext counts;    // The word count, as the statistics count it
+    long long words;
+    Arena arena;
+    int failed;                 // Out of memory
+    WordReader reader;
+} WordTable;
+
+static int word_table_grow(WordTable *table) {
+    size_t capacity = table->capacity ? table->capacity * 2 : WORD_TABLE_INITIAL;
+    WordEntry *entries = calloc(capacity, sizeof(*entries));
+
+    if (entries == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->entries[i].word != NULL) {
+            size_t slot = table->entries[i].hash & (capacity - 1);
+            while (entries[slot].word != NULL) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            entries[slot] = table->entries[i];
+        }
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    return 0;
+}
+
+static void word_table_add(void *ctx, const char *word, size_t length) {
+    WordTable *table = ctx;
+
+    if (table->failed) {
+        return;
+    }
+
+    // Keep the load factor under 70%
+    if ((table->used + 1) * 10 > table->capacity * 7 && word_table_grow(table) < 0) {
+        table->failed = 1;
+        return;
+    }
+
+    uint64_t hash = hash_word(word, length);
+    size_t slot = hash & (table->capacity - 1);
+
+    while (table->entries[slot].word != NULL) {
+        WordEntry *entry = &table->entries[slot];
+        if (entry->hash == hash && entry->length == length &&
+            memcmp(entry->word, word, length) == 0) {
+            entry->count++;
+            return;
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+
+    const char *copy = arena_copy(&table->arena, word, length);
+    if (copy == NULL) {
+        table->failed = 1;
+        return;
+    }
+    table->entries[slot].hash = hash;
+    table->entries[slot].word = copy;
+    table->entries[slot].length = length;
+    table->entries[slot].count = 1;
+    table->used++;
+}
+
+static void count_words_in_buffer(void *ctx, const char *buf, size_t len) {
+    WordTable *table = ctx;
+    read_words(&table->reader, buf, len, word_table_add, table);
+    ts_feed(&table->counts, buf, len);
+}
+
+/* Order for the top-K list: higher count first, then the word */
+static int entry_before(const WordEntry *a, const WordEntry *b) {
+    if (a->count != b->count) {
+        return a->count > b->count;
+    }
+    size_t n = a->length < b->length ? a->length : b->length;
+    int cmp = memcmp(a->word, b->word, n);
+    return cmp != 0 ? cmp < 0 : a->length < b->length;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return entry_before(b, a) - entry_before(a, b);
+}
+
+/* Restore the heap below `i`; the root is the entry that ranks last */
+static void sift_down(WordEntry *heap, size_t count, size_t i) {
+    for (;;) {
+        size_t worst = i, left = 2 * i + 1, right = 2 * i + 2;
+
+        if (left < count && entry_before(&heap[worst], &heap[left])) {
+            worst = left;
+        }
+        if (right < count && entry_before(&heap[worst], &heap[right])) {
+            worst = right;
+        }
+        if (worst == i) {
+            return;
+        }
+        WordEntry tmp = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = tmp;
+        i = worst;
+    }
+}
+
+/**
+ * Count every word in the files and print the K most frequent. The K
+ * best are kept in a heap while walking the table, so only those K are
+ * ever sorted. Returns the number of files that could not be read.
+ */
+static int count_top_words(const FileList *list, size_t top) {
+    WordTable table;
+    int errors = 0;
+
+    memset(&table, 0, sizeof(table));
+    ts_init(&table.counts);
+    if (word_table_grow(&table) < 0) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < list->count && !table.failed && !table.reader.failed; i++) {
+        if (for_each_buffer(list->files[i].path, count_words_in_buffer, &table) < 0) {
+            errors++;
+        } else {
+            table.words += ts_finish(&table.counts).total_words;
+        }
+        ts_init(&table.counts);
+        finish_words(&table.reader, word_table_add, &table);
+    }
+    if (table.failed || table.reader.failed) {
+        fprintf(stderr, "Error: Out of memory after %zu distinct words\n", table.used);
+        errors++;
+    }
+
+    // Select the top K with a heap whose root is the weakest of them
+    if (top > table.used) {
+        top = table.used;
+    }
+    WordEntry *heap = malloc((top ? top : 1) * sizeof(*heap));
+    size_t count = 0;
+
+    if (heap == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        errors++;
+        top = 0;
+    }
+    for (size_t i = 0; i < table.capacity && top > 0; i++) {
+        const WordEntry *entry = &table.entries[i];
+
+        if (entry->word == NULL) {
+            continue;
+        }
+        if (count < top) {
+            heap[count++] = *entry;
+            if (count == top) {
+                for (size_t j = top / 2; j-- > 0; ) {
+                    sift_down(heap, top, j);
+                }
+            }
+        } else if (entry_before(entry, &heap[0])) {
+            heap[0] = *entry;
+            sift_down(heap, top, 0);
+        }
+    }
+    qsort(heap, count, sizeof(*heap), compare_entries);
+
+    printf("=== Top %zu Words ===\n", count);
+    printf("Words counted: %lld\n", table.words);
+    printf("Distinct words: %zu\n", table.used);
+    for (size_t i = 0; i < count; i++) {
+        printf("%10lld  %.*s\n", heap[i].count, (int)heap[i].length, heap[i].word);
+    }
+
+    free(heap);
+    free(table.entries);
+    free(table.reader.current);
+    arena_free(&table.arena);
+    return errors;
+}
+
+/**
+ * HyperLogLog (Flajolet et al. 2007): each word's hash picks a register
+ * with its top HLL_PRECISION bits, and the register keeps the longest run
+ * of leading zeros seen in the remaining bits. The state is a fixed
+ * HLL_REGISTERS bytes however many words there are, and two sketches
+ * merge by taking the larger value of each register.
+ */
+typedef struct {
+    uint8_t registers[HLL_REGISTERS];
+} HyperLogLog;
+
+static inline void hll_add(HyperLogLog *hll, uint64_t hash) {
+    size_t index = hash >> (64 - HLL_PRECISION);
+    uint64_t rest = (hash << HLL_PRECISION) | (1ULL << (HLL_PRECISION - 1));
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+
+    if (rank > hll->registers[index]) {
+        hll->registers[index] = rank;
+    }
+}
+
+static void hll_merge(HyperLogLog *into, const HyperLogLog *from) {
+    for (size_t i = 0; i < HLL_REGISTERS; i++) {
+        if (from->registers[i] > into->registers[i]) {
+            into->registers[i] = from->registers[i];
+        }
+    }
+}
+
+/* Raw estimate, with linear counting while many registers are still empty */
+static double hll_estimate(const HyperLogLog *hll) {
+    const double m = HLL_REGISTERS;
+    double sum = 0;
+    size_t zeros = 0;
+
+    for (size_t i = 0; i < HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -hll->registers[i]);
+        zeros += hll->registers[i] == 0;
+    }
+
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / zeros);
+    }
+    return estimate;
+}
+
+/* One thread's share of the distinct-word count */
+typedef struct {
+    HyperLogLog hll;
+    WordReader reader;
+    TextStatsContext counts;    // The word count, as the statistics count it
+    long long words;
+
+    // Files [next_file..) are shared between all workers
+    const FileList *list;
+    size_t *next_file;
+    pthread_mutex_t *lock;
+    int errors;
+
+    // Or one slice of a mapped file
+    const char *buf;
+    size_t len;
+} DistinctWorker;
+
+static void add_distinct(void *ctx, const char *word, size_t length) {
+    DistinctWorker *worker = ctx;
+
+    hll_add(&worker->hll, hash_word(word, length));
+}
+
+static void add_distinct_buffer(void *ctx, const char *buf, size_t len) {
+    DistinctWorker *worker = ctx;
+    read_words(&worker->reader, buf, len, add_distinct, worker);
+    ts_feed(&worker->counts, buf, len);
+}
+
+/* End of a file or slice; the words of a file that failed are not added */
+static void finish_distinct(DistinctWorker *worker, int failed) {
+    finish_words(&worker->reader, add_distinct, worker);
+    if (!failed) {
+        worker->words += ts_finish(&worker->counts).total_words;
+    }
+    ts_init(&worker->counts);
+}
+
+static void *distinct_worker(void *arg) {
+    DistinctWorker *worker = arg;
+
+    if (worker->buf != NULL) {
+        add_distinct_buffer(worker, worker->buf, worker->len);
+        finish_distinct(worker, 0);
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(worker->lock);
+        size_t i = (*worker->next_file)++;
+        pthread_mutex_unlock(worker->lock);
+        if (i >= worker->list->count) {
+            return NULL;
+        }
+
+        int failed = for_each_buffer(worker->list->files[i].path, add_distinct_buffer, worker) < 0;
+        worker->errors += failed;
+        finish_distinct(worker, failed);
+    }
+}
+
+/**
+ * Estimate the number of distinct words in the files with HyperLogLog,
+ * on up to `threads` threads. Each thread fills its own registers and
+ * they are merged at the end. Files are shared out whole; a single large
+ * file is split into slices that start and end at whitespace, so no word
+ * is cut in two. Returns the number of files that could not be read.
+ */
+static int count_distinct_words(const FileList *list, int threads) {
+    DistinctWorker *workers = calloc((size_t)threads, sizeof(*workers));
+    pthread_t ids[MAX_THREADS];
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    size_t next_file = 0;
+    char *data = MAP_FAILED;
+    size_t size = 0;
+    int errors = 0;
+    int started;
+
+    if (workers == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < threads; i++) {
+        ts_init(&workers[i].counts);
+    }
+
+    // One large (uncompressed) file: map it and split it
+    if (list->count == 1 && list->files[0].size >= 2 * MIN_CHUNK_SIZE && threads > 1) {
+        int fd = open(list->files[0].path, O_RDONLY);
+        if (fd >= 0 && detect_compression(fd) == COMPRESSION_NONE) {
+            size = (size_t)list->files[0].size;
+            data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+        }
+    }
+    if (data != MAP_FAILED) {
+        madvise(data, size, MADV_SEQUENTIAL);
+        if ((size_t)threads > size / MIN_CHUNK_SIZE) {
+            threads = (int)(size / MIN_CHUNK_SIZE);
+        }
+        size_t begin = 0;
+        for (int i = 0; i < threads; i++) {
+            size_t end = (i == threads - 1) ? size : size / threads * (i + 1);
+            while (end < size && !isspace((unsigned char)data[end])) {
+                end++;
+            }
+            if (end < begin) {
+                end = begin;
+            }
+            workers[i].buf = data + begin;
+            workers[i].len = end - begin;
+            begin = end;
+        }
+    } else {
+        if ((size_t)threads > list->count) {
+            threads = list->count > 0 ? (int)list->count : 1;
+        }
+        for (int i = 0; i < threads; i++) {
+            workers[i].list = list;
+            workers[i].next_file = &next_file;
+            workers[i].lock = &lock;
+        }
+    }
+
+    for (started = 1; started < threads; started++) {
+        if (pthread_create(&ids[started], NULL, distinct_worker, &workers[started]) != 0) {
+            break;
+        }
+    }
+    distinct_worker(&workers[0]);
+    for (int i = started; i < threads; i++) {
+        distinct_worker(&workers[i]);
+    }
+    for (int i = 1; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+
+    // Merge the registers
+    long long words = 0;
+    for (int i = 0; i < threads; i++) {
+        if (i > 0) {
+            hll_merge(&workers[0].hll, &workers[i].hll);
+        }
+        words += workers[i].words;
+        errors += workers[i].errors;
+        if (workers[i].reader.failed) {
+            fprintf(stderr, "Error: Out of memory\n");
+            errors++;
+        }
+        free(workers[i].reader.current);
+    }
+
+    printf("=== Distinct Words (HyperLogLog) ===\n");
+    printf("Words counted: %lld\n", words);
+    printf("Distinct words (estimate): %.0f\n", hll_estimate(&workers[0].hll));
+    printf("Standard error: %.1f%%\n", 104.0 / sqrt(HLL_REGISTERS));
+
+    if (data != MAP_FAILED) {
+        munmap(data, size);
+    }
+    free(workers);
+    return errors;
+}
+
+/**
+ * A file watched by --follow. Counts run from when following started and
+ * carry on across rotation and truncation: the old file's last word and
+ * line are closed off, and counting continues in the new contents.
+ */
+typedef struct {
+    const char *path;
+    const char *name;           // Last path component, as directory events report it
+    int fd;
+    unsigned long long inode;
+    off_t offset;               // Bytes of the current file counted so far
+    int file_watch;             // inotify watch on the file
+    int dir_watch;              // ... and on its directory, to see it come back
+    TextStatsContext counts;
+} FollowedFile;
+
+/* Count whatever has been written since the last call */
+static void follow_read(FollowedFile *file) {
+    char buffer[READ_BUFFER_SIZE];
+    struct stat st;
+    ssize_t n;
+
+    // Shorter than what we have counted: truncated (copytruncate rotation)
+    if (fstat(file->fd, &st) == 0 && st.st_size < file->offset) {
+        ts_finish(&file->counts);
+        file->offset = 0;
+    }
+
+    while ((n = pread(file->fd, buffer, sizeof(buffer), file->offset)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error reading file '%s'\n", file->path);
+            perror("read");
+            return;
+        }
+        ts_feed(&file->counts, buffer, (size_t)n);
+        file->offset += n;
+    }
+}
+
+/* Start on the file now at file->path; -1 if there is none (yet) */
+static int follow_open(FollowedFile *file, int inotify_fd) {
+    struct stat st;
+    int fd = open(file->path, O_RDONLY);
+
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || S_ISDIR(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    file->fd = fd;
+    file->inode = (unsigned long long)st.st_ino;
+    file->offset = 0;
+    file->file_watch = inotify_add_watch(inotify_fd, file->path,
+                                         IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
+    return 0;
+}
+
+/**
+ * The path now names a different file (rotated, or deleted and
+ * recreated): finish the old one and start on the new one.
+ */
+static void follow_reopen(FollowedFile *file, int inotify_fd) {
+    struct stat st;
+
+    if (stat(file->path, &st) != 0 || (file->fd >= 0 &&
+        (unsigned long long)st.st_ino == file->inode)) {
+        return;     // Not there yet, or still the same file
+    }
+    if (file->fd >= 0) {
+        follow_read(file);
+        ts_finish(&file->counts);
+        inotify_rm_watch(inotify_fd, file->file_watch);
+        close(file->fd);
+        file->fd = -1;
+    }
+    if (follow_open(file, inotify_fd) == 0) {
+        follow_read(file);
+    }
+}
+
+static void follow_report(const FollowedFile *files, int count) {
+    char now[32];
+    time_t t = time(NULL);
+    struct tm tm;
+
+    localtime_r(&t, &tm);
+    strftime(now, sizeof(now), "%Y-%m-%d %H:%M:%S", &tm);
+    printf("\n=== %s ===\n", now);
+    print_file_header();
+
+    for (int i = 0; i < count; i++) {
+        // Include the word and line still open at the end, as a full count would
+        TextStatsContext counts = files[i].counts;
+        TextStatistics stats = ts_finish(&counts);
+        print_file_row(&stats, files[i].path);
+    }
+    fflush(stdout);
+}
+
+/**
+ * Count the files, then keep counting what is appended to them, printing
+ * the statistics every `interval` seconds. inotify says when a file was
+ * written to, renamed or deleted, and when a file appeared in a watched
+ * directory; nothing is polled or re-read. Runs until interrupted.
+ */
+static int follow_files(char **paths, int count, int interval) {
+    FollowedFile *files = calloc((size_t)count, sizeof(*files));
+    int inotify_fd = inotify_init1(IN_CLOEXEC);
+
+    if (files == NULL || inotify_fd < 0) {
+        fprintf(stderr, "Error: Cannot watch files\n");
+        perror("inotify_init1");
+        goto done;
+    }
+
+    for (int i = 0; i < count; i++) {
+        files[i].fd = -1;
+    }
+    for (int i = 0; i < count; i++) {
+        FollowedFile *file = &files[i];
+        const char *slash = strrchr(paths[i], '/');
+        char dir[4096];
+
+        file->path = paths[i];
+        file->name = slash ? slash + 1 : paths[i];
+        ts_init(&file->counts);
+        strncpy(file->counts.stats.filename, paths[i], sizeof(file->counts.stats.filename) - 1);
+
+        if (follow_open(file, inotify_fd) < 0) {
+            fprintf(stderr, "Error: Cannot open file '%s'\n", paths[i]);
+            perror("open");
+            goto done;
+        }
+        snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - paths[i]) + 1 : 1,
+                 slash ? paths[i] : ".");
+        file->dir_watch = inotify_add_watch(inotify_fd, dir, IN_CREATE | IN_MOVED_TO);
+        follow_read(file);
+    }
+    follow_report(files, count);
+
+    char events[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    time_t next_report = time(NULL) + interval;
+
+    for (;;) {
+        time_t now = time(NULL);
+        if (now >= next_report) {
+            follow_report(files, count);
+            next_report = now + interval;
+        }
+
+        struct pollfd pfd = { inotify_fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, (int)(next_report - now) * 1000);
+        if (ready < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        ssize_t len = read(inotify_fd, events, sizeof(events));
+        for (char *p = events; len > 0 && p < events + len; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+
+            for (int i = 0; i < count; i++) {
+                FollowedFile *file = &files[i];
+
+                if (file->fd >= 0 && event->wd == file->file_watch &&
+                    (event->mask & IN_MODIFY)) {
+                    follow_read(file);
+                } else if (event->wd == file->dir_watch && event->len > 0 &&
+                           strcmp(event->name, file->name) == 0) {
+                    follow_reopen(file, inotify_fd);
+                }
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+done:
+    for (int i = 0; files != NULL && i < count; i++) {
+        if (files[i].fd >= 0) {
+            close(files[i].fd);
+        }
+    }
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+    free(files);
+    return 1;
+}
+
+/**
+ * Main entry point.
+ */
+int main(int argc, char *argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 1;
+    int threads_given = 0;
+    long top = 0;
+    int distinct = 0;
+    int incremental = 0;
+    int follow = 0;
+    long interval = DEFAULT_INTERVAL;
+    int interval_given = 0;
+    int arg = 1;
+
+    // Options
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        char *end;
+
+        if (strcmp(argv[arg], "--distinct") == 0) {
+            distinct = 1;
+            arg++;
+            continue;
+        }
+        if (strcmp(argv[arg], "--incremental") == 0) {
+            incremental = 1;
+            arg++;
+            continue;
+        }
+        if (strcmp(argv[arg], "--follow") == 0) {
+            follow = 1;
+            arg++;
+            continue;
+        }
+        long value = strtol(argv[arg + 1], &end, 10);
+
+        if (strcmp(argv[arg], "-j") == 0) {
+            if (*end != '\0' || value < 1 || value > MAX_THREADS) {
+                printf("Invalid thread count: %s (1-%d)\n", argv[arg + 1], MAX_THREADS);
+                return 1;
+            }
+            threads = (int)value;
+            threads_given = 1;
+        } else if (strcmp(argv[arg], "--top") == 0) {
+            if (*end != '\0' || value < 1) {
+                printf("Invalid word count: %s\n", argv[arg + 1]);
+                return 1;
+            }
+            top = value;
+        } else if (strcmp(argv[arg], "--interval") == 0) {
+            if (*end != '\0' || value < 1 || value > 86400) {
+                printf("Invalid interval: %s (1-86400 seconds)\n", argv[arg + 1]);
+                return 1;
+            }
+            interval = value;
+            interval_given = 1;
+        } else {
+            break;
+        }
+        arg += 2;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+
+    // Check command line arguments
+    if (argc - arg < 1 || argv[arg][0] == '-') {
+        printf("Usage: %s [-j threads] [--incremental] [--top K | --distinct]"
+               " <file or directory>...\n", argv[0]);
+        printf("       %s --follow [--interval seconds] <file>...\n", argv[0]);
+        printf("Example: %s sample_input.txt\n", argv[0]);
+        printf("         %s -j 8 /var/log\n", argv[0]);
+        printf("         %s --top 20 /var/log/syslog\n", argv[0]);
+        printf("         %s --distinct /var/log\n", argv[0]);
+        printf("         %s --incremental /var/log/syslog\n", argv[0]);
+        printf("         %s --follow --interval 10 /var/log/syslog\n", argv[0]);
+        return 1;
+    }
+
+    if (top > 0 && distinct) {
+        printf("--top and --distinct cannot be used together\n");
+        return 1;
+    }
+    if (incremental && (top > 0 || distinct)) {
+        printf("--incremental only applies to statistics, not --top or --distinct\n");
+        return 1;
+    }
+
+    if (follow && (top > 0 || distinct || incremental || threads_given)) {
+        printf("--follow cannot be combined with -j, --top, --distinct or --incremental\n");
+        return 1;
+    }
+    if (interval_given && !follow) {
+        printf("--interval only applies to --follow\n");
+        return 1;
+    }
+
+    // Keep counting as the files grow
+    if (follow) {
+        return follow_files(argv + arg, argc - arg, (int)interval);
+    }
+
+    // Word frequencies or distinct words instead of statistics
+    if (top > 0 || distinct) {
+        FileList list = {0};
+        int errors = 0;
+
+        for (int i = arg; i < argc; i++) {
+            errors += add_path(&list, argv[i]);
+        }
+        if (top > 0) {
+            errors += count_top_words(&list, (size_t)top);
+        } else {
+            errors += count_distinct_words(&list, threads);
+        }
+        for (size_t i = 0; i < list.count; i++) {
+            free(list.files[i].path);
+        }
+        free(list.files);
+        return errors > 0 ? 1 : 0;
+    }
+
+    // One file: the full report
+    struct stat st;
+    if (argc - arg == 1 && (stat(argv[arg], &st) != 0 || !S_ISDIR(st.st_mode))) {
+        TextStatistics stats = count_text_statistics(argv[arg], threads, incremental);
+        display_statistics(&stats);
+        return 0;
+    }
+
+    // Several files or directories: a line per file and the total
+    FileList list = {0};
+    int errors = 0;
+
+    list.skip_checkpoints = incremental;
+    for (int i = arg; i < argc; i++) {
+        errors += add_path(&list, argv[i]);
+    }
+    errors += count_many_files(&list, threads, incremental);
+
+    for (size_t i = 0; i < list.count; i++) {
+        free(list.files[i].path);
+    }
+    free(list.files);
+
+    return errors > 0 ? 1 : 0;
 }
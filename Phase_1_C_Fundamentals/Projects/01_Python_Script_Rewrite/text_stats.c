@@ -0,0 +1,497 @@
+/*
+ * Word Counter - Text Statistics
+ *
+ * See text_stats.h. The scanner looks at every byte once: on x86, 64
+ * bytes at a time are classified with AVX2 (or SSE2) into whitespace,
+ * alphanumeric and newline bitmasks, words and lines are counted with
+ * popcount, and words are only looked at one by one when one could be
+ * the new longest word. The byte loop handles the rest.
+ *
+ * ts_merge() works from the edges of the two texts: the last word of
+ * the first may continue in the head of the second, in which case the
+ * two are one word and the second text's head is not a word of its own.
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORD_COUNTER_HAVE_X86 1
+#endif
+
+#include "text_stats.h"
+
+/**
+ * Copy the alphanumeric characters of a word into longest_word, after any
+ * prefix carried over from the previous buffer. Only called when the word
+ * beats the current longest, so the scan itself never copies.
+ */
+static void record_longest(TextStatistics *stats, const ScanState *state,
+                           const char *buf, size_t start, size_t end) {
+    int n = state->partial_length;
+
+    memcpy(stats->longest_word, state->partial, n);
+    for (size_t i = start; i < end && n < MAX_WORD_LENGTH - 1; i++) {
+        if (isalnum((unsigned char)buf[i])) {
+            stats->longest_word[n++] = buf[i];
+        }
+    }
+    stats->longest_word[n] = '\0';
+    stats->longest_length = state->word_length;
+}
+
+/**
+ * Finish the current word at buf[end] (a whitespace byte).
+ */
+static inline void end_word(ScanState *state, TextStatistics *stats,
+                            const char *buf, size_t word_start, size_t end) {
+    if (state->word_length > stats->longest_length) {
+        record_longest(stats, state, buf, word_start, end);
+    }
+    state->in_word = 0;
+    state->partial_length = 0;
+}
+
+/**
+ * The byte-at-a-time scanner: buf[start..end). Used on its own where there
+ * is no SIMD kernel, and for the last few bytes of a buffer otherwise.
+ */
+static void scan_bytes(ScanState *state, TextStatistics *stats, const char *buf,
+                       size_t start, size_t end, size_t *word_start) {
+    for (size_t i = start; i < end; i++) {
+        unsigned char c = (unsigned char)buf[i];
+
+        if (isspace(c)) {
+            if (c == '\n') {
+                stats->total_lines++;
+            }
+            if (state->in_word) {
+                end_word(state, stats, buf, *word_start, i);
+            }
+        } else {
+            if (!state->in_word) {
+                state->in_word = 1;
+                state->word_length = 0;
+                *word_start = i;
+                stats->total_words++;
+            }
+            if (isalnum(c)) {
+                state->word_length++;
+            }
+        }
+    }
+}
+
+#ifdef WORD_COUNTER_HAVE_X86
+
+/* Bits 0..n-1 set (n < 64) */
+#define LOW_BITS(n) ((1ULL << (n)) - 1)
+
+/**
+ * Does `mask` contain a run of at least k consecutive set bits? Each step
+ * doubles the run length tested, so this is a handful of shifts.
+ */
+__attribute__((always_inline))
+static inline int has_run(uint64_t mask, long long k) {
+    long long have = 1;
+
+    if (k > 64) {
+        return 0;
+    }
+    while (have * 2 <= k) {
+        mask &= mask >> have;
+        have *= 2;
+    }
+    mask &= mask >> (k - have);
+    return mask != 0;
+}
+
+/**
+ * Count one 64-byte block from its character-class masks (bit i = byte
+ * base + i). Word starts and newlines are popcounts. Words are only
+ * walked one by one when one of them is long enough to beat the longest
+ * word so far, which after the first few lines is almost never.
+ */
+__attribute__((always_inline))
+static inline void scan_block(ScanState *state, TextStatistics *stats, const char *buf,
+                              size_t base, uint64_t space, uint64_t alnum,
+                              uint64_t newline, size_t *word_start) {
+    uint64_t word = ~space;
+    uint64_t prev = (word << 1) | (uint64_t)state->in_word;    // Byte before is in a word
+    uint64_t starts = word & ~prev;
+    uint64_t ends = space & prev;
+
+    stats->total_lines += __builtin_popcountll(newline);
+    stats->total_words += __builtin_popcountll(starts);
+
+    // Word carried in from the previous block
+    if (state->in_word) {
+        if (ends == 0) {
+            state->word_length += __builtin_popcountll(alnum);
+            return;
+        }
+        int end = __builtin_ctzll(ends);
+        state->word_length += __builtin_popcountll(alnum & LOW_BITS(end));
+        end_word(state, stats, buf, *word_start, base + end);
+        word &= ~LOW_BITS(end);
+    }
+
+    // Word running on into the next block
+    uint64_t open = 0;
+    int open_start = 0;
+    if (word >> 63) {
+        open_start = 63 - __builtin_clzll(starts);
+        open = ~LOW_BITS(open_start);
+        word &= ~open;
+    }
+
+    // Words that start and end in this block
+    if (word != 0 && has_run(word, stats->longest_length + 1)) {
+        uint64_t pending = starts & word;
+
+        while (pending) {
+            int start = __builtin_ctzll(pending);
+            int end = __builtin_ctzll(space & ~LOW_BITS(start));
+            long long length = __builtin_popcountll(alnum & LOW_BITS(end) & ~LOW_BITS(start));
+
+            if (length > stats->longest_length) {
+                state->word_length = length;
+                record_longest(stats, state, buf, base + start, base + end);
+            }
+            pending &= pending - 1;
+        }
+    }
+
+    if (open) {
+        state->in_word = 1;
+        state->word_length = __builtin_popcountll(alnum & open);
+        *word_start = base + open_start;
+    }
+}
+
+/**
+ * AVX2: classify 32 bytes per instruction. Whitespace is ' ' or 9..13
+ * (\t \n \v \f \r), alnum is '0'..'9' or a letter, like isspace() and
+ * isalnum() in the C locale. Unsigned range checks are done as
+ * min(x - lo, hi - lo) == x - lo.
+ */
+__attribute__((target("avx2,popcnt,bmi")))
+static size_t scan_blocks_avx2(ScanState *state, TextStatistics *stats, const char *buf,
+                               size_t len, size_t *word_start) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i zero_char = _mm256_set1_epi8('0');
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i letter_a = _mm256_set1_epi8('a');
+    const __m256i twenty_five = _mm256_set1_epi8(25);
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64) {
+        uint64_t space_mask = 0, alnum_mask = 0, newline_mask = 0;
+
+        for (int half = 0; half < 2; half++) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i + 32 * half));
+            __m256i ctrl = _mm256_sub_epi8(v, tab);
+            __m256i digit = _mm256_sub_epi8(v, zero_char);
+            __m256i letter = _mm256_sub_epi8(_mm256_or_si256(v, lower), letter_a);
+
+            __m256i is_space = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(ctrl, four), ctrl));
+            __m256i is_alnum = _mm256_or_si256(
+                _mm256_cmpeq_epi8(_mm256_min_epu8(digit, nine), digit),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(letter, twenty_five), letter));
+
+            space_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_space) << (32 * half);
+            alnum_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_alnum) << (32 * half);
+            newline_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline))
+                            << (32 * half);
+        }
+        scan_block(state, stats, buf, i, space_mask, alnum_mask, newline_mask, word_start);
+    }
+    return i;
+}
+
+/**
+ * SSE2: the same classification, 16 bytes at a time.
+ */
+__attribute__((target("sse2,popcnt")))
+static size_t scan_blocks_sse2(ScanState *state, TextStatistics *stats, const char *buf,
+                               size_t len, size_t *word_start) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i letter_a = _mm_set1_epi8('a');
+    const __m128i twenty_five = _mm_set1_epi8(25);
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64) {
+        uint64_t space_mask = 0, alnum_mask = 0, newline_mask = 0;
+
+        for (int part = 0; part < 4; part++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(buf + i + 16 * part));
+            __m128i ctrl = _mm_sub_epi8(v, tab);
+            __m128i digit = _mm_sub_epi8(v, zero_char);
+            __m128i letter = _mm_sub_epi8(_mm_or_si128(v, lower), letter_a);
+
+            __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                _mm_cmpeq_epi8(_mm_min_epu8(ctrl, four), ctrl));
+            __m128i is_alnum = _mm_or_si128(
+                _mm_cmpeq_epi8(_mm_min_epu8(digit, nine), digit),
+                _mm_cmpeq_epi8(_mm_min_epu8(letter, twenty_five), letter));
+
+            space_mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_space) << (16 * part);
+            alnum_mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_alnum) << (16 * part);
+            newline_mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline))
+                            << (16 * part);
+        }
+        scan_block(state, stats, buf, i, space_mask, alnum_mask, newline_mask, word_start);
+    }
+    return i;
+}
+
+#endif /* WORD_COUNTER_HAVE_X86 */
+
+/**
+ * Count the words in buf[0..len) without the per-buffer bookkeeping:
+ * the SIMD kernel takes the whole 64-byte blocks, the byte loop the rest.
+ */
+static void scan_words(ScanState *state, TextStatistics *stats, const char *buf,
+                       size_t len, size_t *word_start) {
+    size_t done = 0;
+
+#ifdef WORD_COUNTER_HAVE_X86
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") &&
+        __builtin_cpu_supports("bmi")) {
+        done = scan_blocks_avx2(state, stats, buf, len, word_start);
+    } else if (__builtin_cpu_supports("sse2") && __builtin_cpu_supports("popcnt")) {
+        done = scan_blocks_sse2(state, stats, buf, len, word_start);
+    }
+#endif
+    scan_bytes(state, stats, buf, done, len, word_start);
+}
+
+/**
+ * Word continues in the next buffer: keep what we have of it.
+ */
+static void save_partial(ScanState *state, const char *buf, size_t word_start, size_t len) {
+    int n = state->partial_length;
+
+    for (size_t i = word_start; i < len && n < MAX_WORD_LENGTH - 1; i++) {
+        if (isalnum((unsigned char)buf[i])) {
+            state->partial[n++] = buf[i];
+        }
+    }
+    state->partial_length = n;
+}
+
+/**
+ * Count the characters, lines and words in a buffer in one pass. A word is
+ * a run of non-space bytes (like Python's str.split()); its length is the
+ * number of alphanumeric characters in it, so punctuation does not count.
+ */
+static void scan_buffer(ScanState *state, TextStatistics *stats, const char *buf, size_t len) {
+    size_t word_start = 0;      // Where the current word starts in buf
+
+    if (len == 0) {
+        return;
+    }
+    stats->total_chars += len;
+    state->in_line = buf[len - 1] != '\n';
+
+    scan_words(state, stats, buf, len, &word_start);
+    if (state->in_word) {
+        save_partial(state, buf, word_start, len);
+    }
+}
+
+/**
+ * End of input: a word or line running up to the last byte is complete
+ * now (Python counts a last line without a newline too).
+ */
+static void scan_finish(ScanState *state, TextStatistics *stats) {
+    if (state->in_word && state->word_length > stats->longest_length) {
+        record_longest(stats, state, NULL, 0, 0);
+    }
+    if (state->in_line) {
+        stats->total_lines++;
+    }
+    state->in_word = 0;
+    state->in_line = 0;
+    state->partial_length = 0;
+}
+
+/* The first word of the text ends here (if it has not yet): keep it */
+static void close_head(TextStatsContext *ctx) {
+    if (ctx->head_in_word && !ctx->head_closed) {
+        memcpy(ctx->head, ctx->state.partial, ctx->state.partial_length);
+        ctx->head_stored = ctx->state.partial_length;
+        ctx->head_length = ctx->state.word_length;
+        ctx->head_closed = 1;
+    }
+}
+
+/* A word already cleaned up: the longest if it beats the current one */
+static void offer_longest(TextStatistics *stats, const char *word, int stored,
+                          long long length) {
+    if (length > stats->longest_length) {
+        memcpy(stats->longest_word, word, stored);
+        stats->longest_word[stored] = '\0';
+        stats->longest_length = length;
+    }
+}
+
+void ts_init(TextStatsContext *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void ts_feed(TextStatsContext *ctx, const char *buf, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    if (ctx->stats.total_chars == 0) {
+        ctx->head_in_word = !isspace((unsigned char)buf[0]);
+    }
+
+    // Still in the first word: scan up to its end separately to keep it
+    if (ctx->head_in_word && !ctx->head_closed) {
+        size_t end = 0;
+        while (end < len && !isspace((unsigned char)buf[end])) {
+            end++;
+        }
+        scan_buffer(&ctx->state, &ctx->stats, buf, end);
+        if (end == len) {
+            return;
+        }
+        close_head(ctx);
+        buf += end;
+        len -= end;
+    }
+    scan_buffer(&ctx->state, &ctx->stats, buf, len);
+}
+
+void ts_merge(TextStatsContext *a, const TextStatsContext *b) {
+    TextStatistics *stats = &a->stats;
+    ScanState *state = &a->state;
+
+    if (b->stats.total_chars == 0) {
+        return;
+    }
+    if (stats->total_chars == 0) {
+        char filename[sizeof(stats->filename)];
+        memcpy(filename, stats->filename, sizeof(filename));
+        *a = *b;
+        memcpy(stats->filename, filename, sizeof(filename));
+        return;
+    }
+
+    stats->total_chars += b->stats.total_chars;
+    stats->total_words += b->stats.total_words;
+    stats->total_lines += b->stats.total_lines;
+
+    if (state->in_word && b->head_in_word) {
+        // a's last word goes on into b: b's head is the rest of it
+        int whole = b->head_closed;
+        const char *rest = whole ? b->head : b->state.partial;
+        int stored = whole ? b->head_stored : b->state.partial_length;
+        int room = MAX_WORD_LENGTH - 1 - state->partial_length;
+
+        memcpy(state->partial + state->partial_length, rest, stored < room ? stored : room);
+        state->partial_length += stored < room ? stored : room;
+        state->word_length += whole ? b->head_length : b->state.word_length;
+        stats->total_words--;
+
+        if (!whole) {
+            state->in_line = b->state.in_line;     // b is all one word, and it goes on
+            return;
+        }
+        close_head(a);
+        offer_longest(stats, state->partial, state->partial_length, state->word_length);
+
+        // b's own longest, unless that was its head (which the joined word beats)
+        if (b->stats.longest_length != b->head_length) {
+            offer_longest(stats, b->stats.longest_word, (int)strlen(b->stats.longest_word),
+                          b->stats.longest_length);
+        }
+    } else {
+        if (state->in_word) {
+            close_head(a);      // a's last word ends where b starts
+            offer_longest(stats, state->partial, state->partial_length, state->word_length);
+        }
+        offer_longest(stats, b->stats.longest_word, (int)strlen(b->stats.longest_word),
+                      b->stats.longest_length);
+    }
+    *state = b->state;
+}
+
+TextStatistics ts_finish(TextStatsContext *ctx) {
+    close_head(ctx);
+    scan_finish(&ctx->state, &ctx->stats);
+    return ctx->stats;
+}
+
+/* One thread's share of a buffer, counted as a text of its own */
+typedef struct {
+    TextStatsContext counts;
+    const char *buf;
+    size_t len;
+    pthread_t id;
+} Chunk;
+
+static void *count_chunk(void *arg) {
+    Chunk *chunk = arg;
+
+    ts_init(&chunk->counts);
+    ts_feed(&chunk->counts, chunk->buf, chunk->len);
+    return NULL;
+}
+
+void ts_feed_parallel(TextStatsContext *ctx, const char *buf, size_t len, int threads) {
+    Chunk *chunks = NULL;
+    int started;
+
+    if (threads > 1 && (size_t)threads <= len) {
+        chunks = malloc(sizeof(*chunks) * (size_t)threads);
+    }
+    if (chunks == NULL) {
+        ts_feed(ctx, buf, len);
+        return;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        size_t begin = len / threads * i;
+        size_t end = (i == threads - 1) ? len : len / threads * (i + 1);
+        chunks[i].buf = buf + begin;
+        chunks[i].len = end - begin;
+    }
+
+    // Chunk 0 runs on this thread; if a thread cannot be started, its
+    // chunk is counted here too
+    for (started = 1; started < threads; started++) {
+        if (pthread_create(&chunks[started].id, NULL, count_chunk, &chunks[started]) != 0) {
+            break;
+        }
+    }
+    count_chunk(&chunks[0]);
+    for (int i = started; i < threads; i++) {
+        count_chunk(&chunks[i]);
+    }
+    for (int i = 1; i < started; i++) {
+        pthread_join(chunks[i].id, NULL);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        ts_merge(ctx, &chunks[i].counts);
+    }
+    free(chunks);
+}
@@ -0,0 +1,91 @@
+/*
+ * Word Counter - Text Statistics
+ *
+ * The counting core of word_counter as a library, for programs that
+ * already hold the text in memory. A context is fed any number of
+ * buffers, split anywhere (inside a word or a line too), then finished:
+ *
+ *   TextStatsContext ctx;
+ *   ts_init(&ctx);
+ *   ts_feed(&ctx, buf, len);            // as often as needed
+ *   TextStatistics stats = ts_finish(&ctx);
+ *
+ * Consecutive pieces of one text can also be counted in separate
+ * contexts (on different threads, say) and combined in text order with
+ * ts_merge(); the result is the same as counting the text in one go.
+ *
+ * Counting follows 01_python_solution.py: a word is a run of non-space
+ * bytes, its length is the number of alphanumeric characters in it, and
+ * the longest word is the first one of the greatest length. None of
+ * these functions can fail: they do not print or exit, and the only one
+ * that allocates (ts_feed_parallel) falls back to one thread without it.
+ */
+
+#ifndef TEXT_STATS_H
+#define TEXT_STATS_H
+
+#include <stddef.h>
+
+/* Longest word kept (the length reported is not limited), with terminator */
+#define MAX_WORD_LENGTH 256
+
+typedef struct {
+    char filename[256];                 // For the caller; the library leaves it alone
+    long long total_chars;
+    long long total_words;
+    long long total_lines;
+    char longest_word[MAX_WORD_LENGTH];
+    long long longest_length;
+} TextStatistics;
+
+/**
+ * Word state carried from one buffer to the next, so a word split across
+ * two reads is still counted once.
+ */
+typedef struct {
+    int in_word;                        // Last byte seen was part of a word
+    int in_line;                        // Bytes seen since the last newline
+    long long word_length;              // Alphanumeric characters in it so far
+    char partial[MAX_WORD_LENGTH];      // Those characters, if the word started
+    int partial_length;                 //   in an earlier buffer
+} ScanState;
+
+/**
+ * Counts so far. `stats` and `state` are what a single pass has at this
+ * point (word_counter's checkpoints save and restore just those two);
+ * the head describes the word the text starts with, which ts_merge() may
+ * have to join to the last word of the text before it.
+ */
+typedef struct {
+    TextStatistics stats;
+    ScanState state;
+    int head_in_word;                   // The first byte was not a space
+    int head_closed;                    // ... and that first word has ended
+    long long head_length;              // Its alphanumeric characters
+    char head[MAX_WORD_LENGTH];         // The first MAX_WORD_LENGTH - 1 of them
+    int head_stored;
+} TextStatsContext;
+
+void ts_init(TextStatsContext *ctx);
+
+/* Count buf[0..len) as the continuation of what ctx has seen */
+void ts_feed(TextStatsContext *ctx, const char *buf, size_t len);
+
+/*
+ * ts_feed() with the buffer split between `threads` threads (worth it
+ * from a few MB up). The result is identical.
+ */
+void ts_feed_parallel(TextStatsContext *ctx, const char *buf, size_t len, int threads);
+
+/* Add `b`, the text that follows `a`, to `a` */
+void ts_merge(TextStatsContext *a, const TextStatsContext *b);
+
+/*
+ * End of the text: a word or line running up to the last byte is
+ * complete now. Returns the statistics (also left in ctx->stats). More
+ * input after this starts a new word and line, as after a file that was
+ * truncated; such a context should not be merged any more.
+ */
+TextStatistics ts_finish(TextStatsContext *ctx);
+
+#endif /* TEXT_STATS_H */
@@ -49,6 +49,12 @@ unsigned short calculate_checksum(unsigned short *data, int len) {
     for (int i = 0; i < len / 2; i++) {
         sum += data[i];
     }
+    if (len % 2) {
+        // Odd length: the last byte is padded with a zero byte
+        unsigned short last = 0;
+        *(unsigned char *)&last = ((unsigned char *)data)[len - 1];
+        sum += last;
+    }
     while (sum >> 16) {
         sum = (sum & 0xFFFF) + (sum >> 16);
     }
@@ -13,26 +13,20 @@
 #include <stdint.h>
 #include <arpa/inet.h>
 #include <ctype.h>
-
-#define BINARY_STR_MAX 33
-#define HEX_STR_MAX 9
-#define OCTAL_STR_MAX 12
-#define IP_STR_MAX 16
-
-typedef enum {
-    RESULT_OK = 0,
-    RESULT_INVALID_INPUT = 1,
-    RESULT_OVERFLOW = 2,
-    RESULT_FORMAT_ERROR = 3
-} ConversionResult;
-
-typedef enum {
-    OUTPUT_DECIMAL = 1 << 0,
-    OUTPUT_BINARY = 1 << 1,
-    OUTPUT_HEX = 1 << 2,
-    OUTPUT_OCTAL = 1 << 3,
-    OUTPUT_ALL = OUTPUT_DECIMAL | OUTPUT_BINARY | OUTPUT_HEX | OUTPUT_OCTAL
-} OutputFormat;
+#include <errno.h>
+#include <unistd.h>
+
+#include "converter.h"
+#include "hexdump.h"
+#include "hexdecode.h"
+#include "server.h"
+#include "bitstats.h"
+#include "ipset.h"
+#include "mac.h"
+#include "checksum.h"
+#include "varint.h"
+#include "timestamp.h"
+#include "ipsort.h"
 
 /* ============================================================================
  * BASE CONVERSION FUNCTIONS
@@ -43,11 +37,16 @@ ConversionResult format_binary(uint32_t value, char *buffer, size_t buffer_size)
         return RESULT_FORMAT_ERROR;
     }
 
-    // Process all 32 bits, starting from MSB (bit 31) down to LSB (bit 0)
-    for (int i = 31; i >= 0; i--) {
-        // Extract bit at position i and convert to character
-        int bit = (value >> i) & 1;
-        buffer[31 - i] = bit ? '1' : '0';
+    // Four bits at a time, starting from the top nibble (bits 31-28):
+    // each nibble's four characters come from a table
+    static const char nibble_bits[16][4] = {
+        {'0','0','0','0'}, {'0','0','0','1'}, {'0','0','1','0'}, {'0','0','1','1'},
+        {'0','1','0','0'}, {'0','1','0','1'}, {'0','1','1','0'}, {'0','1','1','1'},
+        {'1','0','0','0'}, {'1','0','0','1'}, {'1','0','1','0'}, {'1','0','1','1'},
+        {'1','1','0','0'}, {'1','1','0','1'}, {'1','1','1','0'}, {'1','1','1','1'},
+    };
+    for (int i = 0; i < 8; i++) {
+        memcpy(buffer + 4 * i, nibble_bits[(value >> (28 - 4 * i)) & 0xF], 4);
     }
     buffer[32] = '\0';  // Null terminate
 
@@ -118,14 +117,56 @@ uint32_t parse_binary(const char *str) {
     return result;
 }
 
+/*
+ * A non-empty string of digits in `base` (no prefix, sign or spaces)
+ * whose value fits in 32 bits. Shared by parse_auto_checked() and the
+ * fast paths of parse_hex() and parse_octal().
+ */
+static ConversionResult parse_digits(const char *str, unsigned base, uint32_t *value) {
+    if (str[0] == '\0') {
+        return RESULT_INVALID_INPUT;
+    }
+
+    uint64_t result = 0;
+    for (; *str != '\0'; str++) {
+        unsigned c = (unsigned char)*str;
+        unsigned digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            digit = (c | 0x20) - 'a' + 10;
+        } else {
+            return RESULT_INVALID_INPUT;
+        }
+        if (digit >= base) {
+            return RESULT_INVALID_INPUT;
+        }
+
+        result = result * base + digit;
+        if (result > 0xFFFFFFFFULL) {
+            return RESULT_OVERFLOW;
+        }
+    }
+
+    *value = (uint32_t)result;
+    return RESULT_OK;
+}
+
 uint32_t parse_hex(const char *str) {
     if (str == NULL || str[0] == '\0') {
         return 0;
     }
 
-    // Use strtoul for hex parsing - handles "0x" prefix
+    // Plain digits, the common case, are parsed without strtoul()
+    uint32_t value;
+    int prefix = (str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) ? 2 : 0;
+    if (parse_digits(str + prefix, 16, &value) == RESULT_OK) {
+        return value;
+    }
+
+    // Otherwise use strtoul for hex parsing - handles "0x" prefix
     char *endptr;
-    uint32_t value = (uint32_t)strtoul(str, &endptr, 16);
+    value = (uint32_t)strtoul(str, &endptr, 16);
 
     // Validate that entire string was parsed
     if (*endptr != '\0') {
@@ -140,9 +181,14 @@ uint32_t parse_octal(const char *str) {
         return 0;
     }
 
-    // Use strtoul for octal parsing
+    uint32_t value;
+    if (parse_digits(str, 8, &value) == RESULT_OK) {
+        return value;
+    }
+
+    // Otherwise use strtoul for octal parsing
     char *endptr;
-    uint32_t value = (uint32_t)strtoul(str, &endptr, 8);
+    value = (uint32_t)strtoul(str, &endptr, 8);
 
     // Validate entire string was parsed
     if (*endptr != '\0') {
@@ -169,6 +215,32 @@ uint32_t parse_auto(const char *str) {
     }
 }
 
+/*
+ * Like parse_auto(), but reports invalid digits and values that do not
+ * fit in 32 bits instead of returning 0. Used where a bad value must be
+ * distinguishable from a real 0 (e.g. the server mode).
+ */
+ConversionResult parse_auto_checked(const char *str, uint32_t *value) {
+    if (str == NULL || str[0] == '\0') {
+        return RESULT_INVALID_INPUT;
+    }
+
+    unsigned base = 10;
+    if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        base = 16;
+        str += 2;
+    } else if (str[0] == '0' && (str[1] == 'b' || str[1] == 'B')) {
+        base = 2;
+        str += 2;
+    } else if (str[0] == '0' && str[1] != '\0') {
+        base = 8;
+        str += 1;
+    }
+
+    // A prefix with no digits after it is invalid too
+    return parse_digits(str, base, value);
+}
+
 /* ============================================================================
  * ENDIANNESS FUNCTIONS
  * ============================================================================ */
@@ -205,6 +277,12 @@ uint32_t parse_ip_string(const char *ip_str) {
         return 0;
     }
 
+    // Canonical dotted quads (by far the common case) skip sscanf()
+    uint32_t host_ip;
+    if (parse_ipv4_span(ip_str, strlen(ip_str), &host_ip) == RESULT_OK) {
+        return htonl(host_ip);
+    }
+
     unsigned char a, b, c, d;
 
     // Parse four octets separated by dots
@@ -219,6 +297,46 @@ uint32_t parse_ip_string(const char *ip_str) {
     return htonl(ip);
 }
 
+/*
+ * Strict dotted-quad parser over a (not necessarily terminated) span.
+ * Accepts exactly what inet_pton(AF_INET) accepts: four decimal octets
+ * 0-255 without leading zeros. The result is in host byte order, so it
+ * can be compared and sorted as a plain integer.
+ */
+ConversionResult parse_ipv4_span(const char *str, size_t len, uint32_t *ip_host) {
+    uint32_t ip = 0;
+    size_t pos = 0;
+
+    for (int octet = 0; octet < 4; octet++) {
+        if (octet > 0) {
+            if (pos >= len || str[pos] != '.') {
+                return RESULT_INVALID_INPUT;
+            }
+            pos++;
+        }
+
+        unsigned value = 0;
+        size_t digits = 0;
+        while (pos < len && str[pos] >= '0' && str[pos] <= '9' && digits < 4) {
+            value = value * 10 + (unsigned)(str[pos] - '0');
+            pos++;
+            digits++;
+        }
+        if (digits == 0 || digits > 3 || value > 255 ||
+            (digits > 1 && str[pos - digits] == '0')) {
+            return RESULT_INVALID_INPUT;
+        }
+        ip = (ip << 8) | value;
+    }
+
+    if (pos != len) {
+        return RESULT_INVALID_INPUT;  // Trailing characters
+    }
+
+    *ip_host = ip;
+    return RESULT_OK;
+}
+
 void format_ip_address(uint32_t ip_binary, char *buffer, size_t buffer_size) {
     if (buffer_size < IP_STR_MAX) {
         return;
@@ -227,14 +345,21 @@ void format_ip_address(uint32_t ip_binary, char *buffer, size_t buffer_size) {
     // Convert from network byte order to host byte order
     uint32_t host_ip = ntohl(ip_binary);
 
-    // Extract individual octets
-    unsigned char a = (host_ip >> 24) & 0xFF;
-    unsigned char b = (host_ip >> 16) & 0xFF;
-    unsigned char c = (host_ip >> 8) & 0xFF;
-    unsigned char d = host_ip & 0xFF;
-
-    // Format as string
-    snprintf(buffer, buffer_size, "%u.%u.%u.%u", a, b, c, d);
+    // Write each octet as decimal without leading zeros, then a dot;
+    // the last dot becomes the terminator
+    char *p = buffer;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        unsigned octet = (host_ip >> shift) & 0xFF;
+        if (octet >= 100) {
+            *p++ = (char)('0' + octet / 100);
+        }
+        if (octet >= 10) {
+            *p++ = (char)('0' + octet / 10 % 10);
+        }
+        *p++ = (char)('0' + octet % 10);
+        *p++ = '.';
+    }
+    p[-1] = '\0';
 }
 
 const char* get_port_name(uint16_t port) {
@@ -259,8 +384,8 @@ const char* get_port_name(uint16_t port) {
  * ============================================================================ */
 
 uint32_t extract_field(uint32_t value, int start_bit, int num_bits) {
-    // Create mask with num_bits ones
-    uint32_t mask = (1U << num_bits) - 1;
+    // Create mask with num_bits ones (valid up to and including 32)
+    uint32_t mask = FIELD_MASK(num_bits);
 
     // Shift right to position, then mask
     return (value >> start_bit) & mask;
@@ -268,8 +393,8 @@ uint32_t extract_field(uint32_t value, int start_bit, int num_bits) {
 
 void set_field(uint32_t *value, int start_bit, int num_bits,
                uint32_t field_value) {
-    // Create mask with num_bits ones
-    uint32_t mask = (1U << num_bits) - 1;
+    // Create mask with num_bits ones (valid up to and including 32)
+    uint32_t mask = FIELD_MASK(num_bits);
 
     // Clear the bits we're about to set
     *value &= ~(mask << start_bit);
@@ -278,6 +403,119 @@ void set_field(uint32_t *value, int start_bit, int num_bits,
     *value |= (field_value & mask) << start_bit;
 }
 
+/* ============================================================================
+ * BIT FIELD DESCRIPTORS
+ * ============================================================================ */
+
+static const BitFieldDesc IPV4_FIELDS[] = {
+    IPV4_VERSION, IPV4_IHL, IPV4_DSCP, IPV4_ECN, IPV4_TOTAL_LENGTH,
+    IPV4_IDENTIFICATION, IPV4_FLAGS, IPV4_FRAGMENT_OFFSET,
+    IPV4_TTL, IPV4_PROTOCOL, IPV4_CHECKSUM, IPV4_SOURCE, IPV4_DESTINATION
+};
+
+static const BitFieldDesc TCP_FIELDS[] = {
+    TCP_SOURCE_PORT, TCP_DEST_PORT, TCP_SEQUENCE, TCP_ACKNOWLEDGMENT,
+    TCP_DATA_OFFSET, TCP_FLAGS, TCP_WINDOW, TCP_CHECKSUM, TCP_URGENT_POINTER
+};
+
+static const BitFieldDesc UDP_FIELDS[] = {
+    UDP_SOURCE_PORT, UDP_DEST_PORT, UDP_LENGTH, UDP_CHECKSUM
+};
+
+#define LAYOUT(name, table, words) \
+    { name, table, sizeof(table) / sizeof(table[0]), words }
+
+const FieldLayout FIELD_LAYOUTS[] = {
+    LAYOUT("ipv4", IPV4_FIELDS, 5),
+    LAYOUT("tcp", TCP_FIELDS, 5),
+    LAYOUT("udp", UDP_FIELDS, 2),
+};
+const size_t NUM_FIELD_LAYOUTS = sizeof(FIELD_LAYOUTS) / sizeof(FIELD_LAYOUTS[0]);
+
+const FieldLayout *find_field_layout(const char *name) {
+    for (size_t i = 0; i < NUM_FIELD_LAYOUTS; i++) {
+        if (strcmp(FIELD_LAYOUTS[i].name, name) == 0) {
+            return &FIELD_LAYOUTS[i];
+        }
+    }
+    return NULL;
+}
+
+/* Look up a field by "layout.field" name, e.g. "ipv4.dscp" */
+const BitFieldDesc *find_field(const char *qualified_name) {
+    const char *dot = strchr(qualified_name, '.');
+    if (dot == NULL) {
+        return NULL;
+    }
+
+    char layout_name[32];
+    size_t len = (size_t)(dot - qualified_name);
+    if (len >= sizeof(layout_name)) {
+        return NULL;
+    }
+    memcpy(layout_name, qualified_name, len);
+    layout_name[len] = '\0';
+
+    const FieldLayout *layout = find_field_layout(layout_name);
+    if (layout == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < layout->num_fields; i++) {
+        if (strcmp(layout->fields[i].name, dot + 1) == 0) {
+            return &layout->fields[i];
+        }
+    }
+    return NULL;
+}
+
+uint32_t extract_desc(const uint32_t *header_words, const BitFieldDesc *field) {
+    return FIELD_GET(header_words[field->word], field->start_bit, field->num_bits);
+}
+
+/*
+ * Extract one field from `count` headers stored back to back, `stride`
+ * words apart. Shift and mask are hoisted out of the loop, leaving a
+ * straight-line body (load, shift, and) that the compiler vectorizes.
+ */
+void extract_field_batch(const uint32_t *restrict records, size_t count,
+                         size_t stride, const BitFieldDesc *field,
+                         uint32_t *restrict out) {
+    const uint32_t *src = records + field->word;
+    const unsigned shift = field->start_bit;
+    const uint32_t mask = FIELD_MASK(field->num_bits);
+
+    if (stride == 1) {
+        // Contiguous words: the common "one column" case
+        for (size_t i = 0; i < count; i++) {
+            out[i] = (src[i] >> shift) & mask;
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = (src[i * stride] >> shift) & mask;
+        }
+    }
+}
+
+/*
+ * Same as extract_field_batch() but for raw headers straight off the wire
+ * (network byte order), `stride_bytes` apart. memcpy() keeps unaligned
+ * loads legal; it compiles to a plain load followed by a byte swap.
+ */
+void extract_field_batch_be(const uint8_t *restrict records, size_t count,
+                            size_t stride_bytes, const BitFieldDesc *field,
+                            uint32_t *restrict out) {
+    const uint8_t *src = records + (size_t)field->word * 4;
+    const unsigned shift = field->start_bit;
+    const uint32_t mask = FIELD_MASK(field->num_bits);
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t word;
+        memcpy(&word, src + i * stride_bytes, sizeof(word));
+        out[i] = (ntohl(word) >> shift) & mask;
+    }
+}
+
 /* ============================================================================
  * OUTPUT AND FORMATTING
  * ============================================================================ */
@@ -397,6 +635,606 @@ void display_byte_swap(uint32_t value) {
     printf("\n");
 }
 
+void display_header_fields(const FieldLayout *layout, const uint32_t *words,
+                           size_t num_words) {
+    printf("=== %s Header Fields ===\n", layout->name);
+    for (size_t i = 0; i < layout->num_fields; i++) {
+        const BitFieldDesc *f = &layout->fields[i];
+        if (f->word >= num_words) {
+            continue;  // Word not supplied on the command line
+        }
+        uint32_t value = extract_desc(words, f);
+        printf("  %-16s word %u bits [%2u:%2u]  %10u  0x%0*x\n",
+               f->name, f->word, f->start_bit + f->num_bits - 1, f->start_bit,
+               value, (f->num_bits + 3) / 4, value);
+    }
+}
+
+int run_fields_mode(int argc, char *argv[]) {
+    if (argc < 3) {
+        printf("Usage: converter --fields <layout> <word> [word...]\n");
+        printf("Layouts:");
+        for (size_t i = 0; i < NUM_FIELD_LAYOUTS; i++) {
+            printf(" %s", FIELD_LAYOUTS[i].name);
+        }
+        printf("\n");
+        return 1;
+    }
+
+    const FieldLayout *layout = find_field_layout(argv[2]);
+    if (layout == NULL) {
+        printf("Unknown layout: %s\n", argv[2]);
+        return 1;
+    }
+
+    uint32_t words[16] = {0};
+    size_t num_words = (size_t)(argc - 3);
+    if (num_words > sizeof(words) / sizeof(words[0])) {
+        printf("Too many words: %zu (at most %zu)\n",
+               num_words, sizeof(words) / sizeof(words[0]));
+        return 1;
+    }
+    for (size_t i = 0; i < num_words; i++) {
+        // A mistyped word must not be decoded as 0
+        if (parse_auto_checked(argv[3 + i], &words[i]) != RESULT_OK) {
+            printf("Invalid word: %s (not a 32-bit number)\n", argv[3 + i]);
+            return 1;
+        }
+    }
+
+    display_header_fields(layout, words, num_words);
+    return 0;
+}
+
+/*
+ * Parse the "-s <offset>" / "-l <length>" options shared by the file
+ * modes (same letters as xxd), plus one mode-specific numeric option
+ * `extra_option` (NULL if none) stored in *extra_value. Returns the
+ * index of the first non-option argument, or -1 on error.
+ */
+int parse_range_options(int argc, char *argv[], int first,
+                        uint64_t *offset, uint64_t *length,
+                        const char *extra_option, uint64_t *extra_value) {
+    *offset = 0;
+    *length = 0;
+
+    int i = first;
+    while (i < argc && argv[i][0] == '-' && argv[i][1] != '\0') {
+        if (i + 1 >= argc) {
+            printf("Missing value for option %s\n", argv[i]);
+            return -1;
+        }
+        uint64_t *target = NULL;
+        if (strcmp(argv[i], "-s") == 0) {
+            target = offset;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            target = length;
+        } else if (extra_option != NULL && strcmp(argv[i], extra_option) == 0) {
+            target = extra_value;
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            return -1;
+        }
+        if (!parse_size_arg(argv[i + 1], target)) {
+            printf("Invalid value for %s: %s\n", argv[i], argv[i + 1]);
+            return -1;
+        }
+        i += 2;
+    }
+    return i;
+}
+
+int run_hexdump_mode(int argc, char *argv[]) {
+    uint64_t offset, length;
+    int i = parse_range_options(argc, argv, 2, &offset, &length, NULL, NULL);
+    if (i < 0 || i != argc - 1) {
+        printf("Usage: converter --hexdump [-s offset] [-l length] <file>\n");
+        return 1;
+    }
+
+    return hexdump_file(argv[i], offset, length, STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+}
+
+int run_unhex_mode(int argc, char *argv[]) {
+    HexInputStyle style = HEX_INPUT_PLAIN;
+    int i = 2;
+    if (i < argc && strcmp(argv[i], "-x") == 0) {
+        style = HEX_INPUT_XXD;
+        i++;
+    }
+    if (i != argc - 1) {
+        printf("Usage: converter --unhex [-x] <file>  (binary written to stdout)\n");
+        return 1;
+    }
+
+    return hex_decode_file(argv[i], style, STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+}
+
+int run_popcount_mode(int argc, char *argv[]) {
+    uint64_t offset, length, block_size = 0;
+    int i = parse_range_options(argc, argv, 2, &offset, &length, "-b", &block_size);
+    if (i < 0 || i != argc - 1) {
+        printf("Usage: converter --popcount [-s offset] [-l length] [-b block] <file>\n");
+        return 1;
+    }
+
+    return popcount_file(argv[i], offset, length, block_size, STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+}
+
+int run_hamming_mode(int argc, char *argv[]) {
+    uint64_t offset, length;
+    int i = parse_range_options(argc, argv, 2, &offset, &length, NULL, NULL);
+    if (i < 0 || i != argc - 2) {
+        printf("Usage: converter --hamming [-s offset] [-l length] <file1> <file2>\n");
+        return 1;
+    }
+
+    return hamming_files(argv[i], argv[i + 1], offset, length, STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+}
+
+int run_bitdiff_mode(int argc, char *argv[]) {
+    uint64_t offset, length, max_lines = 0;
+    int i = parse_range_options(argc, argv, 2, &offset, &length, "-n", &max_lines);
+    if (i < 0 || i != argc - 2) {
+        printf("Usage: converter --bitdiff [-s offset] [-l length] [-n max-lines] <file1> <file2>\n");
+        return 1;
+    }
+
+    return bitdiff_files(argv[i], argv[i + 1], offset, length, max_lines,
+                         STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+}
+
+void display_mac_info(uint64_t mac, const OuiDatabase *db) {
+    char colon[MAC_STR_MAX], dash[MAC_STR_MAX], dot[MAC_STR_MAX], bare[MAC_STR_MAX];
+    colon[format_mac(mac, MAC_STYLE_COLON, 0, colon)] = '\0';
+    dash[format_mac(mac, MAC_STYLE_DASH, 1, dash)] = '\0';
+    dot[format_mac(mac, MAC_STYLE_DOT, 0, dot)] = '\0';
+    bare[format_mac(mac, MAC_STYLE_BARE, 0, bare)] = '\0';
+
+    // The two low bits of the first octet carry the address type
+    uint8_t first_octet = (uint8_t)(mac >> 40);
+
+    printf("=== MAC Address Converter ===\n");
+    printf("  Colon:        %s\n", colon);
+    printf("  Dash:         %s\n", dash);
+    printf("  Cisco:        %s\n", dot);
+    printf("  Bare hex:     %s\n", bare);
+    printf("  Integer:      %llu\n", (unsigned long long)mac);
+    printf("  Type:         %s, %s\n",
+           (first_octet & 0x01) ? "multicast" : "unicast",
+           (first_octet & 0x02) ? "locally administered" : "universally administered");
+    if (db != NULL) {
+        const char *vendor;
+        size_t vendor_len = oui_lookup(db, mac, &vendor);
+        if (vendor_len > 0) {
+            printf("  Vendor:       %.*s\n", (int)vendor_len, vendor);
+        } else {
+            printf("  Vendor:       (not registered)\n");
+        }
+    }
+}
+
+int run_mac_mode(int argc, char *argv[]) {
+    OuiDatabase db;
+    int have_db = 0;
+    int i = 2;
+    if (i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+        if (oui_open(argv[i + 1], &db) != RESULT_OK) {
+            return 1;
+        }
+        have_db = 1;
+        i += 2;
+    }
+    if (i >= argc) {
+        printf("Usage: converter --mac [-d oui.db] <mac>...\n");
+        return 1;
+    }
+
+    int status = 0;
+    for (; i < argc; i++) {
+        uint64_t mac;
+        if (parse_mac_span(argv[i], strlen(argv[i]), &mac) != RESULT_OK) {
+            printf("Invalid MAC address: %s\n", argv[i]);
+            status = 1;
+            continue;
+        }
+        display_mac_info(mac, have_db ? &db : NULL);
+    }
+
+    if (have_db) {
+        oui_close(&db);
+    }
+    return status;
+}
+
+int run_mac_batch_mode(int argc, char *argv[]) {
+    int style = MAC_STYLE_COLON;
+    int uppercase = 0;
+    int column = 1;
+    const char *db_path = NULL;
+
+    int i = 2;
+    while (i < argc && argv[i][0] == '-' && argv[i][1] != '\0') {
+        if (strcmp(argv[i], "-u") == 0) {
+            uppercase = 1;
+            i++;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printf("Missing value for option %s\n", argv[i]);
+            return 1;
+        }
+        if (strcmp(argv[i], "-f") == 0) {
+            style = mac_style_from_name(argv[i + 1]);
+            if (style < 0) {
+                printf("Unknown MAC style: %s (colon, dash, dot, bare)\n", argv[i + 1]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-k") == 0) {
+            column = atoi(argv[i + 1]);
+            if (column < 1) {
+                printf("Invalid column: %s\n", argv[i + 1]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-d") == 0) {
+            db_path = argv[i + 1];
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        i += 2;
+    }
+    if (i < argc - 1) {
+        printf("Usage: converter --mac-batch [-f style] [-u] [-k column] [-d oui.db] [file]\n");
+        return 1;
+    }
+
+    OuiDatabase db;
+    if (db_path != NULL && oui_open(db_path, &db) != RESULT_OK) {
+        return 1;
+    }
+    ConversionResult result = mac_convert_lines(i < argc ? argv[i] : NULL, column,
+                                                (MacStyle)style, uppercase,
+                                                db_path ? &db : NULL, STDOUT_FILENO);
+    if (db_path != NULL) {
+        oui_close(&db);
+    }
+    return result == RESULT_OK ? 0 : 1;
+}
+
+int run_oui_compile_mode(int argc, char *argv[]) {
+    if (argc < 4) {
+        printf("Usage: converter --oui-compile <out.db> <oui.txt|oui.csv>...\n");
+        return 1;
+    }
+    return oui_compile((const char *const *)(argv + 3), argc - 3, argv[2]) == RESULT_OK ? 0 : 1;
+}
+
+int run_checksum_mode(int argc, char *argv[]) {
+    uint64_t offset, length;
+    int i = parse_range_options(argc, argv, 2, &offset, &length, NULL, NULL);
+    if (i < 0 || i >= argc) {
+        printf("Usage: converter --checksum [-s offset] [-l length] <file> [algorithm]...\n");
+        printf("Algorithms: inet, crc32, crc32c, adler32, fletcher16 (default: all)\n");
+        return 1;
+    }
+
+    return checksum_file(argv[i], offset, length, (const char *const *)(argv + i + 1),
+                         argc - i - 1) == RESULT_OK ? 0 : 1;
+}
+
+/* "ac 02" style byte list */
+void print_byte_list(const uint8_t *bytes, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        printf(i == 0 ? "%02x" : " %02x", bytes[i]);
+    }
+}
+
+/* One line per encoded byte: continuation bit, then the 7 payload bits */
+void print_varint_groups(const uint8_t *bytes, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        char bits[8];
+        for (int b = 0; b < 7; b++) {
+            bits[b] = (bytes[i] & (0x40 >> b)) ? '1' : '0';
+        }
+        bits[7] = '\0';
+        printf("    Byte %zu:     %d %s  0x%02x  %s\n", i, bytes[i] >> 7, bits,
+               bytes[i], (bytes[i] & 0x80) ? "more" : "last");
+    }
+}
+
+void display_varint_info(const char *str) {
+    uint64_t value;
+    int negative = str[0] == '-';
+    if (negative) {
+        char *endptr;
+        errno = 0;
+        long long v = strtoll(str, &endptr, 0);
+        if (errno != 0 || *endptr != '\0') {
+            printf("Invalid value: %s\n", str);
+            return;
+        }
+        value = (uint64_t)v;
+    } else if (!parse_size_arg(str, &value)) {
+        printf("Invalid value: %s\n", str);
+        return;
+    }
+
+    uint8_t encoded[VARINT_MAX_BYTES];
+    size_t n = varint_encode(value, encoded);
+
+    printf("=== Varint Encoder ===\n");
+    if (negative) {
+        printf("  Value:        %lld\n", (long long)value);
+    } else {
+        printf("  Value:        %llu\n", (unsigned long long)value);
+    }
+    printf("  Varint:       ");
+    print_byte_list(encoded, n);
+    printf("  (%zu byte%s%s)\n", n, n == 1 ? "" : "s",
+           negative ? ", as protobuf int64" : "");
+    print_varint_groups(encoded, n);
+
+    // Zigzag and signed LEB128 need the value to fit in int64
+    if (negative || value <= INT64_MAX) {
+        uint64_t zz = zigzag_encode((int64_t)value);
+        printf("  Zigzag:       %llu -> ", (unsigned long long)zz);
+        n = varint_encode(zz, encoded);
+        print_byte_list(encoded, n);
+        printf("\n  SLEB128:      ");
+        n = sleb128_encode((int64_t)value, encoded);
+        print_byte_list(encoded, n);
+        printf("\n");
+    }
+}
+
+int run_varint_mode(int argc, char *argv[]) {
+    if (argc < 3) {
+        printf("Usage: converter --varint <value>...\n");
+        return 1;
+    }
+    for (int i = 2; i < argc; i++) {
+        display_varint_info(argv[i]);
+    }
+    return 0;
+}
+
+/* Hex digit value, or -1 */
+int hex_digit_value(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int run_varint_decode_mode(int argc, char *argv[]) {
+    if (argc < 3) {
+        printf("Usage: converter --varint-decode <hex bytes>...  (e.g. ac02 or \"ac 02\")\n");
+        return 1;
+    }
+
+    // Collect the bytes of all arguments; spaces, ':' and a 0x prefix are allowed
+    uint8_t bytes[256];
+    size_t len = 0;
+    for (int i = 2; i < argc; i++) {
+        const char *p = argv[i];
+        if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+            p += 2;
+        }
+        while (*p != '\0') {
+            if (*p == ' ' || *p == ':') {
+                p++;
+                continue;
+            }
+            int hi = hex_digit_value((unsigned char)p[0]);
+            int lo = hi < 0 ? -1 : hex_digit_value((unsigned char)p[1]);
+            if (lo < 0 || len == sizeof(bytes)) {
+                printf("Invalid hex bytes: %s\n", argv[i]);
+                return 1;
+            }
+            bytes[len++] = (uint8_t)(hi << 4 | lo);
+            p += 2;
+        }
+    }
+
+    printf("=== Varint Decoder ===\n");
+    size_t pos = 0;
+    for (int index = 1; pos < len; index++) {
+        uint64_t value;
+        size_t used;
+        ConversionResult result = varint_decode(bytes + pos, len - pos, &value, &used);
+        if (result != RESULT_OK) {
+            printf("  %s varint at byte %zu\n",
+                   result == RESULT_OVERFLOW ? "Malformed" : "Truncated", pos);
+            return 1;
+        }
+        int64_t sleb;
+        size_t sleb_used;
+        sleb128_decode(bytes + pos, used, &sleb, &sleb_used);
+
+        printf("  Value %d:      ", index);
+        print_byte_list(bytes + pos, used);
+        printf(" -> %llu\n", (unsigned long long)value);
+        print_varint_groups(bytes + pos, used);
+        printf("    Zigzag:     %lld\n", (long long)zigzag_decode(value));
+        if (sleb_used == used) {
+            printf("    SLEB128:    %lld\n", (long long)sleb);
+        }
+        pos += used;
+    }
+    return 0;
+}
+
+int run_varint_stream_mode(int argc, char *argv[]) {
+    int zigzag = 0;
+    int i = 2;
+    if (i < argc && strcmp(argv[i], "-z") == 0) {
+        zigzag = 1;
+        i++;
+    }
+
+    if (strcmp(argv[1], "--varint-encode") == 0) {
+        if (i < argc - 1) {
+            printf("Usage: converter --varint-encode [-z] [file]  (stream written to stdout)\n");
+            return 1;
+        }
+        return varint_encode_lines(i < argc ? argv[i] : NULL, zigzag, STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+    }
+
+    uint64_t offset, length;
+    i = parse_range_options(argc, argv, i, &offset, &length, NULL, NULL);
+    if (i < 0 || i != argc - 1) {
+        printf("Usage: converter --varint-file [-z] [-s offset] [-l length] <file>\n");
+        return 1;
+    }
+    return varint_decode_file(argv[i], offset, length, zigzag, STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+}
+
+void display_time_info(const Timestamp *ts) {
+    static const char *const WEEKDAYS[] = {
+        "Thursday", "Friday", "Saturday", "Sunday", "Monday", "Tuesday", "Wednesday"
+    };
+    static const struct {
+        const char *label;
+        TimeFormat format;
+        int frac_digits;
+    } ROWS[] = {
+        { "RFC 3339:", TIME_ISO, 9 },      { "Epoch s:", TIME_EPOCH_S, 0 },
+        { "Epoch ms:", TIME_EPOCH_MS, 0 }, { "Epoch us:", TIME_EPOCH_US, 0 },
+        { "Epoch ns:", TIME_EPOCH_NS, 0 }, { "NTP:", TIME_NTP, 0 },
+        { "PTP (TAI):", TIME_PTP, 0 },
+    };
+
+    printf("=== Timestamp Converter ===\n");
+    for (size_t i = 0; i < sizeof(ROWS) / sizeof(ROWS[0]); i++) {
+        char buffer[TIME_STR_MAX];
+        size_t n = format_timestamp(ts, ROWS[i].format, ROWS[i].frac_digits, buffer);
+        if (n > 0) {
+            printf("  %-13s %.*s\n", ROWS[i].label, (int)n, buffer);
+        } else {
+            printf("  %-13s (out of range)\n", ROWS[i].label);
+        }
+    }
+
+    // 1970-01-01 was a Thursday
+    int64_t days = ts->seconds / 86400 - (ts->seconds % 86400 < 0);
+    int weekday = (int)(((days % 7) + 7) % 7);
+    printf("  Weekday:      %s\n", WEEKDAYS[weekday]);
+}
+
+int run_time_mode(int argc, char *argv[]) {
+    int from = -1;  // Guess per value
+    int i = 2;
+    if (i + 1 < argc && strcmp(argv[i], "-f") == 0) {
+        from = time_format_from_name(argv[i + 1], NULL);
+        if (from < 0) {
+            printf("Unknown time format: %s (auto, s, ms, us, ns, iso, ntp, ptp)\n", argv[i + 1]);
+            return 1;
+        }
+        i += 2;
+    }
+    if (i >= argc) {
+        printf("Usage: converter --time [-f format] <timestamp>...\n");
+        return 1;
+    }
+
+    int status = 0;
+    for (; i < argc; i++) {
+        const char *str = argv[i];
+        size_t len = strlen(str);
+        Timestamp ts;
+        ConversionResult result;
+        if (from >= 0) {
+            result = parse_timestamp(str, len, (TimeFormat)from, &ts);
+        } else {
+            // ISO dates have a '-' after the year; then try numbers, then NTP, then PTP
+            result = parse_timestamp(str, len, len > 4 && str[4] == '-' ? TIME_ISO : TIME_EPOCH_AUTO, &ts);
+            if (result != RESULT_OK) {
+                result = parse_timestamp(str, len, TIME_NTP, &ts);
+            }
+            if (result != RESULT_OK) {
+                result = parse_timestamp(str, len, TIME_PTP, &ts);
+            }
+        }
+        if (result != RESULT_OK) {
+            printf("Invalid timestamp: %s\n", str);
+            status = 1;
+            continue;
+        }
+        display_time_info(&ts);
+    }
+    return status;
+}
+
+int run_time_batch_mode(int argc, char *argv[]) {
+    int from = TIME_EPOCH_AUTO, to = TIME_ISO;
+    int frac_digits = 0;
+    int column = 1;
+
+    int i = 2;
+    while (i < argc && argv[i][0] == '-' && argv[i][1] != '\0') {
+        if (i + 1 >= argc) {
+            printf("Missing value for option %s\n", argv[i]);
+            return 1;
+        }
+        const char *value = argv[i + 1];
+        if (strcmp(argv[i], "-f") == 0) {
+            from = time_format_from_name(value, NULL);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            to = time_format_from_name(value, &frac_digits);
+        } else if (strcmp(argv[i], "-k") == 0) {
+            column = atoi(value);
+            if (column < 1) {
+                printf("Invalid column: %s\n", value);
+                return 1;
+            }
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        if (from < 0 || to < 0) {
+            printf("Unknown time format: %s (auto, s, ms, us, ns, iso, iso3, iso6, iso9, ntp, ptp)\n",
+                   value);
+            return 1;
+        }
+        i += 2;
+    }
+    if (i < argc - 1) {
+        printf("Usage: converter --time-batch [-f from] [-t to] [-k column] [file]\n");
+        return 1;
+    }
+
+    return timestamp_convert_lines(i < argc ? argv[i] : NULL, column, (TimeFormat)from,
+                                   (TimeFormat)to, frac_digits, STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+}
+
+int run_ipsort_mode(int argc, char *argv[]) {
+    uint64_t column = 1;
+    uint64_t threads = (uint64_t)sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 2;
+    while (i < argc && argv[i][0] == '-' && argv[i][1] != '\0') {
+        uint64_t *target = strcmp(argv[i], "-k") == 0 ? &column :
+                           strcmp(argv[i], "-j") == 0 ? &threads : NULL;
+        if (target == NULL) {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        if (i + 1 >= argc || !parse_size_arg(argv[i + 1], target) ||
+            *target < 1 || *target > 1024) {
+            printf("Invalid value for %s\n", argv[i]);
+            return 1;
+        }
+        i += 2;
+    }
+    if (i < argc - 1) {
+        printf("Usage: converter --ipsort [-k column] [-j threads] [file]\n");
+        return 1;
+    }
+
+    return ip_sort_count(i < argc ? argv[i] : NULL, (int)column, (int)threads,
+                         STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+}
+
 void print_usage(void) {
     printf("Binary Data Converter - Usage\n\n");
     printf("Syntax:  converter <value> [format]\n\n");
@@ -410,6 +1248,28 @@ void print_usage(void) {
     printf("  endian           Byte order conversions\n");
     printf("  swap             Swap bytes\n");
     printf("  detect-endian    Detect system endianness\n\n");
+    printf("Modes:\n");
+    printf("  converter --fields <layout> <word>...   Decode header words (ipv4, tcp, udp)\n");
+    printf("  converter --hexdump [-s off] [-l len] <file>   xxd-style dump of a file range\n");
+    printf("  converter --unhex [-x] <file>                  Hex text (-x: xxd dump) to binary\n");
+    printf("  converter --popcount [-s off] [-l len] [-b block] <file>   Set bits per block\n");
+    printf("  converter --hamming [-s off] [-l len] <file1> <file2>      Bits that differ\n");
+    printf("  converter --bitdiff [-s off] [-l len] [-n max] <file1> <file2>   Flipped bits\n");
+    printf("  converter --checksum [-s off] [-l len] <file> [algo]...   Internet/CRC/Adler sums\n");
+    printf("  converter --varint <value>...                  Varint, zigzag and SLEB128 bytes\n");
+    printf("  converter --varint-decode <hex bytes>...       Decode varints byte by byte\n");
+    printf("  converter --varint-encode [-z] [file]          Numbers (one per line) to a stream\n");
+    printf("  converter --varint-file [-z] [-s off] [-l len] <file>   Decode a varint stream\n");
+    printf("  converter --time [-f format] <timestamp>...    Epoch, RFC 3339, NTP and PTP forms\n");
+    printf("  converter --time-batch [-f from] [-t to] [-k col] [file]\n");
+    printf("                                                 Convert timestamps, one per line\n");
+    printf("  converter --ipset <command> ...                IPv4 address sets (run for help)\n");
+    printf("  converter --ipsort [-k col] [-j threads] [file]   Sorted unique IPs with counts\n");
+    printf("  converter --mac [-d oui.db] <mac>...           MAC address in every style\n");
+    printf("  converter --mac-batch [-f style] [-u] [-k col] [-d oui.db] [file]\n");
+    printf("                                                 Normalize MACs, one per line\n");
+    printf("  converter --oui-compile <out.db> <ieee-file>...   Build the vendor database\n");
+    printf("  converter --serve <socket-path>                Answer requests on a Unix socket\n\n");
     printf("Examples:\n");
     printf("  converter 255 all\n");
     printf("  converter 0xFF all\n");
@@ -417,18 +1277,95 @@ void print_usage(void) {
     printf("  converter 192.168.1.1 ip\n");
     printf("  converter 0xDEADBEEF swap\n");
     printf("  converter detect-endian\n");
+    printf("  converter --fields ipv4 0x4500003c 0x1c464000 0x40060000\n");
+    printf("  converter --hexdump -s 0x40 -l 256 capture.bin\n");
+    printf("  converter --unhex router_dump.txt > packet.bin\n");
+    printf("  converter --popcount -b 0x10000 flash.img\n");
+    printf("  converter --bitdiff -n 100 good_card.bin failing_card.bin\n");
+    printf("  converter --checksum -s 14 -l 20 frame.bin inet\n");
+    printf("  converter --varint 300\n");
+    printf("  converter --varint-file -z telemetry.bin\n");
+    printf("  converter --time 1700000000123\n");
+    printf("  converter --time-batch -f ms -t iso3 -k 2 device.log\n");
+    printf("  converter --ipset diff observed.txt allowlist.ips -\n");
+    printf("  converter --ipsort -k 3 access.log\n");
+    printf("  converter --mac -d oui.db 001a.2b3c.4d5e\n");
+    printf("  converter --mac-batch -f dot -k 2 arp_table.txt\n");
+    printf("  converter --serve /tmp/converter.sock\n");
 }
 
 /* ============================================================================
  * MAIN PROGRAM
  * ============================================================================ */
 
+/* Left out when the functions are built as libconverter.so */
+#ifndef CONVERTER_NO_MAIN
+
 int main(int argc, char *argv[]) {
     if (argc < 2) {
         print_usage();
         return 1;
     }
 
+    if (strcmp(argv[1], "--fields") == 0) {
+        return run_fields_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--hexdump") == 0) {
+        return run_hexdump_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--unhex") == 0) {
+        return run_unhex_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--popcount") == 0) {
+        return run_popcount_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--hamming") == 0) {
+        return run_hamming_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--bitdiff") == 0) {
+        return run_bitdiff_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--checksum") == 0) {
+        return run_checksum_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--varint") == 0) {
+        return run_varint_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--varint-decode") == 0) {
+        return run_varint_decode_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--varint-encode") == 0 || strcmp(argv[1], "--varint-file") == 0) {
+        return run_varint_stream_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--time") == 0) {
+        return run_time_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--time-batch") == 0) {
+        return run_time_batch_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--ipset") == 0) {
+        return run_ipset(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "--ipsort") == 0) {
+        return run_ipsort_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--mac") == 0) {
+        return run_mac_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--mac-batch") == 0) {
+        return run_mac_batch_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--oui-compile") == 0) {
+        return run_oui_compile_mode(argc, argv);
+    }
+    if (strcmp(argv[1], "--serve") == 0) {
+        if (argc != 3) {
+            printf("Usage: converter --serve <socket-path>\n");
+            return 1;
+        }
+        return run_server(argv[2]);
+    }
+
     const char *input_str = argv[1];
     const char *format_str = (argc > 2) ? argv[2] : "all";
 
@@ -481,3 +1418,5 @@ int main(int argc, char *argv[]) {
 
     return 0;
 }
+
+#endif /* CONVERTER_NO_MAIN */
@@ -0,0 +1,531 @@
+/*
+ * Binary Data Converter - Microbenchmarks
+ *
+ * Times each converter function against the libc routine (or compiler
+ * builtin) a program would otherwise use for the same job, over inputs
+ * shaped like real traffic rather than a single repeated value:
+ *
+ *   values     bit length uniform over 1..32, so small numbers (ports,
+ *              flags, counters) are as common as full 32-bit ones
+ *   addresses  mostly private ranges (10/8, 172.16/12, 192.168/16) with
+ *              some public addresses mixed in
+ *   headers    random IPv4 headers; fields picked from the ipv4 layout
+ *
+ * Results are printed as JSON, one entry per function with ns/op,
+ * operations per second and (for text functions) bytes per second.
+ *
+ * Usage: ./benchmark [--min-time SECONDS] [--filter SUBSTRING]
+ */
+
+#define _GNU_SOURCE  // clock_gettime()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "converter.h"
+
+/* Inputs per data set: large enough to defeat branch prediction on
+ * the input pattern, small enough to stay in L2 */
+#define NUM_INPUTS 4096
+#define TEXT_MAX 40
+
+/* ============================================================================
+ * INPUT DATA
+ * ============================================================================ */
+
+static uint32_t values[NUM_INPUTS];
+static char bin_text[NUM_INPUTS][TEXT_MAX];
+static char hex_text[NUM_INPUTS][TEXT_MAX];
+static char oct_text[NUM_INPUTS][TEXT_MAX];
+static char auto_text[NUM_INPUTS][TEXT_MAX];    // Mix of decimal, 0x.., 0..
+static size_t text_len[4][NUM_INPUTS];          // bin, hex, oct, auto
+
+static uint32_t addresses[NUM_INPUTS];          // Network byte order
+static char ip_text[NUM_INPUTS][IP_STR_MAX];
+static size_t ip_len[NUM_INPUTS];
+
+static uint32_t headers[NUM_INPUTS][5];
+static const BitFieldDesc *header_fields[NUM_INPUTS];
+
+enum { TEXT_BIN, TEXT_HEX, TEXT_OCT, TEXT_AUTO };
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t next_random(void) {
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static uint32_t random_address(void) {
+    uint32_t r = next_random();
+    switch (next_random() % 8) {
+        case 0: case 1: case 2:
+            return 0x0A000000 | (r & 0x00FFFFFF);   // 10.0.0.0/8
+        case 3: case 4:
+            return 0xC0A80000 | (r & 0x0000FFFF);   // 192.168.0.0/16
+        case 5:
+            return 0xAC100000 | (r & 0x000FFFFF);   // 172.16.0.0/12
+        default:
+            return r;                               // Anywhere
+    }
+}
+
+static void generate_inputs(void) {
+    const FieldLayout *ipv4 = find_field_layout("ipv4");
+
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        unsigned bits = 1 + next_random() % 32;
+        uint32_t v = (next_random() & FIELD_MASK(bits)) | (1u << (bits - 1));
+        values[i] = v;
+
+        format_binary(v, bin_text[i], TEXT_MAX);
+        text_len[TEXT_BIN][i] = strlen(bin_text[i]);
+        text_len[TEXT_HEX][i] = (size_t)snprintf(hex_text[i], TEXT_MAX, "%x", v);
+        text_len[TEXT_OCT][i] = (size_t)snprintf(oct_text[i], TEXT_MAX, "%o", v);
+        switch (next_random() % 4) {
+            case 0:
+                text_len[TEXT_AUTO][i] = (size_t)snprintf(auto_text[i], TEXT_MAX, "0x%x", v);
+                break;
+            case 1:
+                text_len[TEXT_AUTO][i] = (size_t)snprintf(auto_text[i], TEXT_MAX, "0%o", v);
+                break;
+            default:
+                text_len[TEXT_AUTO][i] = (size_t)snprintf(auto_text[i], TEXT_MAX, "%u", v);
+                break;
+        }
+
+        uint32_t ip = random_address();
+        addresses[i] = htonl(ip);
+        ip_len[i] = (size_t)snprintf(ip_text[i], IP_STR_MAX, "%u.%u.%u.%u",
+                                     ip >> 24, (ip >> 16) & 0xFF,
+                                     (ip >> 8) & 0xFF, ip & 0xFF);
+
+        for (int w = 0; w < 5; w++) {
+            headers[i][w] = next_random();
+        }
+        header_fields[i] = &ipv4->fields[next_random() % ipv4->num_fields];
+    }
+}
+
+/* ============================================================================
+ * BENCHMARK BODIES
+ *
+ * Each function makes one pass over its data set and returns a value
+ * derived from every result, so the compiler cannot drop the calls.
+ * ============================================================================ */
+
+static uint32_t run_format_binary(void) {
+    char buf[BINARY_STR_MAX];
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        format_binary(values[i], buf, sizeof(buf));
+        sum += (uint8_t)buf[31];
+    }
+    return sum;
+}
+
+static uint32_t run_format_hex(void) {
+    char buf[HEX_STR_MAX];
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        format_hex(values[i], buf, sizeof(buf));
+        sum += (uint8_t)buf[7];
+    }
+    return sum;
+}
+
+static uint32_t run_snprintf_hex(void) {
+    char buf[HEX_STR_MAX];
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        snprintf(buf, sizeof(buf), "%08x", values[i]);
+        sum += (uint8_t)buf[7];
+    }
+    return sum;
+}
+
+static uint32_t run_format_octal(void) {
+    char buf[OCTAL_STR_MAX];
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        format_octal(values[i], buf, sizeof(buf));
+        sum += (uint8_t)buf[10];
+    }
+    return sum;
+}
+
+static uint32_t run_snprintf_octal(void) {
+    char buf[OCTAL_STR_MAX];
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        snprintf(buf, sizeof(buf), "%011o", values[i]);
+        sum += (uint8_t)buf[10];
+    }
+    return sum;
+}
+
+static uint32_t run_parse_binary(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += parse_binary(bin_text[i]);
+    }
+    return sum;
+}
+
+static uint32_t run_strtoul_binary(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += (uint32_t)strtoul(bin_text[i], NULL, 2);
+    }
+    return sum;
+}
+
+static uint32_t run_parse_hex(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += parse_hex(hex_text[i]);
+    }
+    return sum;
+}
+
+static uint32_t run_strtoul_hex(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += (uint32_t)strtoul(hex_text[i], NULL, 16);
+    }
+    return sum;
+}
+
+static uint32_t run_parse_octal(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += parse_octal(oct_text[i]);
+    }
+    return sum;
+}
+
+static uint32_t run_strtoul_octal(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += (uint32_t)strtoul(oct_text[i], NULL, 8);
+    }
+    return sum;
+}
+
+static uint32_t run_parse_auto(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += parse_auto(auto_text[i]);
+    }
+    return sum;
+}
+
+static uint32_t run_parse_auto_checked(void) {
+    uint32_t sum = 0, value;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        if (parse_auto_checked(auto_text[i], &value) == RESULT_OK) {
+            sum += value;
+        }
+    }
+    return sum;
+}
+
+static uint32_t run_strtoul_auto(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += (uint32_t)strtoul(auto_text[i], NULL, 0);
+    }
+    return sum;
+}
+
+static uint32_t run_format_ip_address(void) {
+    char buf[IP_STR_MAX];
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        format_ip_address(addresses[i], buf, sizeof(buf));
+        sum += (uint8_t)buf[2];
+    }
+    return sum;
+}
+
+static uint32_t run_inet_ntop(void) {
+    char buf[INET_ADDRSTRLEN];
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        inet_ntop(AF_INET, &addresses[i], buf, sizeof(buf));
+        sum += (uint8_t)buf[2];
+    }
+    return sum;
+}
+
+static uint32_t run_parse_ip_string(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += parse_ip_string(ip_text[i]);
+    }
+    return sum;
+}
+
+static uint32_t run_parse_ipv4_span(void) {
+    uint32_t sum = 0, ip;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        if (parse_ipv4_span(ip_text[i], ip_len[i], &ip) == RESULT_OK) {
+            sum += ip;
+        }
+    }
+    return sum;
+}
+
+static uint32_t run_inet_pton(void) {
+    uint32_t sum = 0;
+    struct in_addr addr;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        if (inet_pton(AF_INET, ip_text[i], &addr) == 1) {
+            sum += addr.s_addr;
+        }
+    }
+    return sum;
+}
+
+static uint32_t run_swap_bytes_32(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += swap_bytes_32(values[i]);
+    }
+    return sum;
+}
+
+static uint32_t run_builtin_bswap32(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += __builtin_bswap32(values[i]);
+    }
+    return sum;
+}
+
+static uint32_t run_swap_bytes_16(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += swap_bytes_16((uint16_t)values[i]);
+    }
+    return sum;
+}
+
+static uint32_t run_builtin_bswap16(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        sum += __builtin_bswap16((uint16_t)values[i]);
+    }
+    return sum;
+}
+
+static uint32_t run_extract_field(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        const BitFieldDesc *f = header_fields[i];
+        sum += extract_field(headers[i][f->word], f->start_bit, f->num_bits);
+    }
+    return sum;
+}
+
+static uint32_t run_inline_shift_mask(void) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        const BitFieldDesc *f = header_fields[i];
+        sum += FIELD_GET(headers[i][f->word], f->start_bit, f->num_bits);
+    }
+    return sum;
+}
+
+/* ============================================================================
+ * BENCHMARK TABLE AND DRIVER
+ * ============================================================================ */
+
+/* What a benchmark's bytes/s figure counts */
+typedef enum {
+    BYTES_NONE,         // Integer in, integer out
+    BYTES_BIN_IN,       // Length of the parsed text
+    BYTES_HEX_IN,
+    BYTES_OCT_IN,
+    BYTES_AUTO_IN,
+    BYTES_IP_IN,        // Dotted quad, parsed or produced
+    BYTES_BIN_OUT,      // Fixed-width output: 32 binary digits
+    BYTES_HEX_OUT,      // 8 hex digits
+    BYTES_OCT_OUT       // 11 octal digits
+} ByteCount;
+
+typedef struct {
+    const char *name;
+    const char *baseline;       // Name of the entry this one is compared with
+    uint32_t (*run)(void);
+    ByteCount bytes;
+    double ns_per_op;           // Filled in by the driver
+} Benchmark;
+
+static Benchmark benchmarks[] = {
+    { "format_binary",      NULL,                run_format_binary,      BYTES_BIN_OUT, 0 },
+    { "format_hex",         "snprintf_hex",      run_format_hex,         BYTES_HEX_OUT, 0 },
+    { "snprintf_hex",       NULL,                run_snprintf_hex,       BYTES_HEX_OUT, 0 },
+    { "format_octal",       "snprintf_octal",    run_format_octal,       BYTES_OCT_OUT, 0 },
+    { "snprintf_octal",     NULL,                run_snprintf_octal,     BYTES_OCT_OUT, 0 },
+    { "parse_binary",       "strtoul_binary",    run_parse_binary,       BYTES_BIN_IN,  0 },
+    { "strtoul_binary",     NULL,                run_strtoul_binary,     BYTES_BIN_IN,  0 },
+    { "parse_hex",          "strtoul_hex",       run_parse_hex,          BYTES_HEX_IN,  0 },
+    { "strtoul_hex",        NULL,                run_strtoul_hex,        BYTES_HEX_IN,  0 },
+    { "parse_octal",        "strtoul_octal",     run_parse_octal,        BYTES_OCT_IN,  0 },
+    { "strtoul_octal",      NULL,                run_strtoul_octal,      BYTES_OCT_IN,  0 },
+    { "parse_auto",         "strtoul_auto",      run_parse_auto,         BYTES_AUTO_IN, 0 },
+    { "parse_auto_checked", "strtoul_auto",      run_parse_auto_checked, BYTES_AUTO_IN, 0 },
+    { "strtoul_auto",       NULL,                run_strtoul_auto,       BYTES_AUTO_IN, 0 },
+    { "format_ip_address",  "inet_ntop",         run_format_ip_address,  BYTES_IP_IN,   0 },
+    { "inet_ntop",          NULL,                run_inet_ntop,          BYTES_IP_IN,   0 },
+    { "parse_ip_string",    "inet_pton",         run_parse_ip_string,    BYTES_IP_IN,   0 },
+    { "parse_ipv4_span",    "inet_pton",         run_parse_ipv4_span,    BYTES_IP_IN,   0 },
+    { "inet_pton",          NULL,                run_inet_pton,          BYTES_IP_IN,   0 },
+    { "swap_bytes_32",      "builtin_bswap32",   run_swap_bytes_32,      BYTES_NONE,    0 },
+    { "builtin_bswap32",    NULL,                run_builtin_bswap32,    BYTES_NONE,    0 },
+    { "swap_bytes_16",      "builtin_bswap16",   run_swap_bytes_16,      BYTES_NONE,    0 },
+    { "builtin_bswap16",    NULL,                run_builtin_bswap16,    BYTES_NONE,    0 },
+    { "extract_field",      "inline_shift_mask", run_extract_field,      BYTES_NONE,    0 },
+    { "inline_shift_mask",  NULL,                run_inline_shift_mask,  BYTES_NONE,    0 },
+};
+
+#define NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+/* Average text length per operation for a benchmark, 0 if none */
+static double bytes_per_op(const Benchmark *b) {
+    const size_t *lengths;
+    switch (b->bytes) {
+        case BYTES_BIN_IN:  lengths = text_len[TEXT_BIN]; break;
+        case BYTES_HEX_IN:  lengths = text_len[TEXT_HEX]; break;
+        case BYTES_OCT_IN:  lengths = text_len[TEXT_OCT]; break;
+        case BYTES_AUTO_IN: lengths = text_len[TEXT_AUTO]; break;
+        case BYTES_IP_IN:   lengths = ip_len; break;
+        case BYTES_BIN_OUT: return 32;
+        case BYTES_HEX_OUT: return 8;
+        case BYTES_OCT_OUT: return 11;
+        default:            return 0;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        total += lengths[i];
+    }
+    return (double)total / NUM_INPUTS;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile uint32_t sink;
+
+/*
+ * Time one benchmark: repeat passes until min_time has elapsed, five
+ * times over, and keep the fastest round (the one least disturbed by
+ * interrupts and frequency changes).
+ */
+static double measure(Benchmark *b, double min_time) {
+    double best = 0;
+
+    b->run();  // Warm caches and branch predictors
+    for (int round = 0; round < 5; round++) {
+        uint64_t passes = 0;
+        uint32_t acc = 0;
+        double start = now_seconds(), elapsed;
+        do {
+            acc += b->run();
+            passes++;
+            elapsed = now_seconds() - start;
+        } while (elapsed < min_time / 5);
+        sink += acc;
+
+        double ns = elapsed * 1e9 / ((double)passes * NUM_INPUTS);
+        if (round == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+static Benchmark *find_benchmark(const char *name) {
+    for (size_t i = 0; i < NUM_BENCHMARKS; i++) {
+        if (strcmp(benchmarks[i].name, name) == 0) {
+            return &benchmarks[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    double min_time = 0.5;
+    const char *filter = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--min-time SECONDS] [--filter SUBSTRING]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    generate_inputs();
+
+    // A baseline is measured whenever something compared with it is
+    for (size_t i = 0; i < NUM_BENCHMARKS; i++) {
+        Benchmark *b = &benchmarks[i];
+        if (filter != NULL && strstr(b->name, filter) == NULL) {
+            continue;
+        }
+        b->ns_per_op = measure(b, min_time);
+        if (b->baseline != NULL) {
+            Benchmark *base = find_benchmark(b->baseline);
+            if (base->ns_per_op == 0) {
+                base->ns_per_op = measure(base, min_time);
+            }
+        }
+    }
+
+    printf("{\n");
+    printf("  \"inputs_per_pass\": %d,\n", NUM_INPUTS);
+    printf("  \"min_time_s\": %.3f,\n", min_time);
+    printf("  \"results\": [");
+    int first = 1;
+    for (size_t i = 0; i < NUM_BENCHMARKS; i++) {
+        const Benchmark *b = &benchmarks[i];
+        if (b->ns_per_op == 0) {
+            continue;
+        }
+        double ops_per_sec = 1e9 / b->ns_per_op;
+
+        printf("%s\n    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"ops_per_sec\": %.0f",
+               first ? "" : ",", b->name, b->ns_per_op, ops_per_sec);
+        double bytes = bytes_per_op(b);
+        if (bytes != 0) {
+            printf(", \"bytes_per_op\": %.2f, \"mb_per_sec\": %.1f",
+                   bytes, bytes * ops_per_sec / 1e6);
+        }
+        if (b->baseline != NULL) {
+            const Benchmark *base = find_benchmark(b->baseline);
+            printf(", \"baseline\": \"%s\", \"speedup\": %.2f",
+                   base->name, base->ns_per_op / b->ns_per_op);
+        }
+        printf("}");
+        first = 0;
+    }
+    printf("\n  ]\n}\n");
+
+    return 0;
+}
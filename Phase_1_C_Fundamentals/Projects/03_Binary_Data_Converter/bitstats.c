@@ -0,0 +1,364 @@
+/*
+ * Binary Data Converter - Bit Statistics
+ *
+ * Three kernel tiers, picked at run time:
+ *
+ *   AVX2     32 bytes per step. vpshufb looks up the bit count of each
+ *            nibble in a 16-entry table; per-byte counts accumulate in
+ *            8-bit lanes for up to 31 steps before vpsadbw widens them
+ *            into 64-bit totals.
+ *   POPCNT   8 bytes per step with the popcnt instruction.
+ *   scalar   Same loop, __builtin_popcountll without a target.
+ *
+ * Hamming distance is the population count of a XOR b, so both share
+ * the kernels. The bit-flip report skips equal regions 32 bytes at a
+ * time (vpcmpeqb + vpmovmskb) and only formats the bytes that differ.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bitstats.h"
+#include "file_io.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITSTATS_HAVE_X86 1
+#endif
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+/* ============================================================================
+ * POPCOUNT KERNELS
+ *
+ * b == NULL counts the bits of a[]; otherwise the bits of a[] ^ b[].
+ * ============================================================================ */
+
+static inline __attribute__((always_inline))
+uint64_t count_words(const uint8_t *a, const uint8_t *b, size_t size) {
+    uint64_t total = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t wa, wb = 0;
+        memcpy(&wa, a + i, 8);
+        if (b != NULL) {
+            memcpy(&wb, b + i, 8);
+        }
+        total += (uint64_t)__builtin_popcountll(wa ^ wb);
+    }
+    for (; i < size; i++) {
+        total += (uint64_t)__builtin_popcount(a[i] ^ (b != NULL ? b[i] : 0));
+    }
+    return total;
+}
+
+static uint64_t count_scalar(const uint8_t *a, const uint8_t *b, size_t size) {
+    return count_words(a, b, size);
+}
+
+#ifdef BITSTATS_HAVE_X86
+
+__attribute__((target("popcnt")))
+static uint64_t count_popcnt(const uint8_t *a, const uint8_t *b, size_t size) {
+    return count_words(a, b, size);
+}
+
+__attribute__((target("avx2,popcnt")))
+static uint64_t count_avx2(const uint8_t *a, const uint8_t *b, size_t size) {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+
+    while (size - i >= 32) {
+        // Each step adds at most 8 per byte lane, so 31 steps cannot overflow
+        size_t steps = (size - i) / 32;
+        if (steps > 31) {
+            steps = 31;
+        }
+
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t s = 0; s < steps; s++, i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+            if (b != NULL) {
+                v = _mm256_xor_si256(v, _mm256_loadu_si256((const __m256i *)(b + i)));
+            }
+            __m256i lo = _mm256_and_si256(v, low_nibble);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble);
+            acc = _mm256_add_epi8(acc, _mm256_shuffle_epi8(lut, lo));
+            acc = _mm256_add_epi8(acc, _mm256_shuffle_epi8(lut, hi));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, _mm256_setzero_si256()));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, total);
+    uint64_t result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return result + count_words(a + i, b != NULL ? b + i : NULL, size - i);
+}
+
+/* Index of the first differing byte, or size */
+__attribute__((target("avx2,bmi")))
+static size_t first_difference_avx2(const uint8_t *a, const uint8_t *b, size_t size) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+        if (equal != 0xFFFFFFFFu) {
+            return i + (size_t)_tzcnt_u32(~equal);
+        }
+    }
+    for (; i < size && a[i] == b[i]; i++) {
+    }
+    return i;
+}
+
+#endif /* BITSTATS_HAVE_X86 */
+
+static uint64_t count_bits(const uint8_t *a, const uint8_t *b, size_t size) {
+#ifdef BITSTATS_HAVE_X86
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return count_avx2(a, b, size);
+    }
+    if (__builtin_cpu_supports("popcnt")) {
+        return count_popcnt(a, b, size);
+    }
+#endif
+    return count_scalar(a, b, size);
+}
+
+uint64_t popcount_bytes(const uint8_t *data, size_t size) {
+    return count_bits(data, NULL, size);
+}
+
+uint64_t hamming_bytes(const uint8_t *a, const uint8_t *b, size_t size) {
+    return count_bits(a, b, size);
+}
+
+size_t find_first_difference(const uint8_t *a, const uint8_t *b, size_t size) {
+#ifdef BITSTATS_HAVE_X86
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")) {
+        return first_difference_avx2(a, b, size);
+    }
+#endif
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t wa, wb;
+        memcpy(&wa, a + i, 8);
+        memcpy(&wb, b + i, 8);
+        if (wa != wb) {
+            break;
+        }
+    }
+    for (; i < size && a[i] == b[i]; i++) {
+    }
+    return i;
+}
+
+/* ============================================================================
+ * FILE MODES
+ * ============================================================================ */
+
+/* Write a formatted line of at most 160 characters */
+#define REPORT_LINE_MAX 160
+
+static void print_line(OutBuf *out, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void print_line(OutBuf *out, const char *fmt, ...) {
+    char *dst = outbuf_reserve(out, REPORT_LINE_MAX);
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(dst, REPORT_LINE_MAX, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        outbuf_commit(out, (size_t)n < REPORT_LINE_MAX ? (size_t)n : REPORT_LINE_MAX - 1);
+    }
+}
+
+ConversionResult popcount_file(const char *path, uint64_t offset,
+                               uint64_t length, uint64_t block_size,
+                               int out_fd) {
+    MappedFile file;
+    ConversionResult result = map_file_range(path, offset, length, &file);
+    if (result != RESULT_OK) {
+        return result;
+    }
+
+    OutBuf *out = outbuf_open(out_fd);
+    if (out == NULL) {
+        unmap_file(&file);
+        return RESULT_OVERFLOW;
+    }
+
+    if (block_size == 0 || block_size > file.size) {
+        block_size = file.size;
+    }
+
+    uint64_t total = 0;
+    if (block_size < file.size) {
+        print_line(out, "%-18s %12s %14s %9s\n", "offset", "ones", "bits", "density");
+        for (size_t pos = 0; pos < file.size; pos += block_size) {
+            size_t n = file.size - pos < block_size ? file.size - pos : (size_t)block_size;
+            uint64_t ones = popcount_bytes(file.data + pos, n);
+            total += ones;
+            print_line(out, "0x%016llx %12llu %14llu %8.4f%%\n",
+                       (unsigned long long)(file.offset + pos),
+                       (unsigned long long)ones, (unsigned long long)n * 8,
+                       100.0 * (double)ones / ((double)n * 8));
+        }
+    } else {
+        total = popcount_bytes(file.data, file.size);
+    }
+
+    uint64_t bits = (uint64_t)file.size * 8;
+    print_line(out, "Total: %llu of %llu bits set (%.4f%%)\n",
+               (unsigned long long)total, (unsigned long long)bits,
+               bits != 0 ? 100.0 * (double)total / (double)bits : 0.0);
+
+    result = outbuf_close(out);
+    unmap_file(&file);
+    return result;
+}
+
+/* Map the same range of two files; note on stderr if their sizes differ */
+static ConversionResult map_file_pair(const char *path_a, const char *path_b,
+                                      uint64_t offset, uint64_t length,
+                                      MappedFile *a, MappedFile *b) {
+    ConversionResult result = map_file_range(path_a, offset, length, a);
+    if (result != RESULT_OK) {
+        return result;
+    }
+    result = map_file_range(path_b, offset, length, b);
+    if (result != RESULT_OK) {
+        unmap_file(a);
+        return result;
+    }
+
+    if (a->size != b->size) {
+        fprintf(stderr, "Note: range sizes differ (%zu vs %zu bytes); "
+                "comparing the first %zu\n",
+                a->size, b->size, a->size < b->size ? a->size : b->size);
+    }
+    return RESULT_OK;
+}
+
+ConversionResult hamming_files(const char *path_a, const char *path_b,
+                               uint64_t offset, uint64_t length, int out_fd) {
+    MappedFile a, b;
+    ConversionResult result = map_file_pair(path_a, path_b, offset, length, &a, &b);
+    if (result != RESULT_OK) {
+        return result;
+    }
+
+    size_t size = a.size < b.size ? a.size : b.size;
+    uint64_t distance = hamming_bytes(a.data, b.data, size);
+
+    OutBuf *out = outbuf_open(out_fd);
+    if (out == NULL) {
+        unmap_file(&a);
+        unmap_file(&b);
+        return RESULT_OVERFLOW;
+    }
+    print_line(out, "Compared:         %zu bytes from offset 0x%llx\n",
+               size, (unsigned long long)a.offset);
+    print_line(out, "Hamming distance: %llu bits (%.6f%%)\n",
+               (unsigned long long)distance,
+               size != 0 ? 100.0 * (double)distance / ((double)size * 8) : 0.0);
+
+    result = outbuf_close(out);
+    unmap_file(&a);
+    unmap_file(&b);
+    return result;
+}
+
+/* "0x0000000000001f2a: 41 -> 0b  -6 +3 +1\n"; returns characters written */
+static size_t format_flip_line(uint64_t offset, uint8_t before, uint8_t after,
+                               char *dst) {
+    char *p = dst;
+    *p++ = '0';
+    *p++ = 'x';
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        *p++ = HEX_DIGITS[(offset >> shift) & 0xF];
+    }
+    memcpy(p, ": ", 2);
+    p += 2;
+    *p++ = HEX_DIGITS[before >> 4];
+    *p++ = HEX_DIGITS[before & 0xF];
+    memcpy(p, " -> ", 4);
+    p += 4;
+    *p++ = HEX_DIGITS[after >> 4];
+    *p++ = HEX_DIGITS[after & 0xF];
+    *p++ = ' ';
+
+    // Bit 7 is the MSB, matching extract_field() numbering
+    uint8_t flipped = before ^ after;
+    for (int bit = 7; bit >= 0; bit--) {
+        if (flipped & (1u << bit)) {
+            *p++ = ' ';
+            *p++ = (after & (1u << bit)) ? '+' : '-';
+            *p++ = (char)('0' + bit);
+        }
+    }
+    *p++ = '\n';
+    return (size_t)(p - dst);
+}
+
+/* Longest flip line: 18 offset + 2 + 2 + 4 + 2 + 1 + 8 * 3 + newline */
+#define FLIP_LINE_MAX 64
+
+ConversionResult bitdiff_files(const char *path_a, const char *path_b,
+                               uint64_t offset, uint64_t length,
+                               uint64_t max_lines, int out_fd) {
+    MappedFile a, b;
+    ConversionResult result = map_file_pair(path_a, path_b, offset, length, &a, &b);
+    if (result != RESULT_OK) {
+        return result;
+    }
+
+    OutBuf *out = outbuf_open(out_fd);
+    if (out == NULL) {
+        unmap_file(&a);
+        unmap_file(&b);
+        return RESULT_OVERFLOW;
+    }
+
+    size_t size = a.size < b.size ? a.size : b.size;
+    uint64_t bytes_differing = 0, set = 0, cleared = 0;
+
+    size_t pos = find_first_difference(a.data, b.data, size);
+    while (pos < size) {
+        uint8_t before = a.data[pos], after = b.data[pos];
+
+        // Past the line limit only the totals are kept
+        if (max_lines == 0 || bytes_differing < max_lines) {
+            char *dst = outbuf_reserve(out, FLIP_LINE_MAX);
+            outbuf_commit(out, format_flip_line(a.offset + pos, before, after, dst));
+        }
+        bytes_differing++;
+        set += (uint64_t)__builtin_popcount((uint8_t)(~before & after));
+        cleared += (uint64_t)__builtin_popcount((uint8_t)(before & ~after));
+
+        pos++;
+        pos += find_first_difference(a.data + pos, b.data + pos, size - pos);
+    }
+    uint64_t bits_flipped = set + cleared;
+
+    if (max_lines != 0 && bytes_differing > max_lines) {
+        print_line(out, "... %llu more differing bytes not shown\n",
+                   (unsigned long long)(bytes_differing - max_lines));
+    }
+
+    print_line(out, "%llu bytes differ, %llu bits flipped (%llu set, %llu cleared)\n",
+               (unsigned long long)bytes_differing, (unsigned long long)bits_flipped,
+               (unsigned long long)set, (unsigned long long)cleared);
+
+    result = outbuf_close(out);
+    unmap_file(&a);
+    unmap_file(&b);
+    return result;
+}
@@ -0,0 +1,48 @@
+/*
+ * Binary Data Converter - Bit Statistics
+ *
+ * Whole-file versions of the bit-level operations: population count per
+ * block, Hamming distance between two files, and a report of every
+ * flipped bit, for diffing firmware images and memory dumps.
+ */
+
+#ifndef BITSTATS_H
+#define BITSTATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+
+/* Number of set bits in `size` bytes */
+uint64_t popcount_bytes(const uint8_t *data, size_t size);
+
+/* Number of bit positions at which a[] and b[] differ */
+uint64_t hamming_bytes(const uint8_t *a, const uint8_t *b, size_t size);
+
+/* Index of the first byte where a[] and b[] differ, or `size` if none */
+size_t find_first_difference(const uint8_t *a, const uint8_t *b, size_t size);
+
+/*
+ * Print the set-bit count and density of each `block_size`-byte block of
+ * a file range (block_size 0 = one block), followed by the total.
+ */
+ConversionResult popcount_file(const char *path, uint64_t offset,
+                               uint64_t length, uint64_t block_size,
+                               int out_fd);
+
+/* Print the Hamming distance between the same range of two files */
+ConversionResult hamming_files(const char *path_a, const char *path_b,
+                               uint64_t offset, uint64_t length, int out_fd);
+
+/*
+ * Print one line per differing byte, listing the flipped bits
+ * ("+n" = bit n went 0->1 in the second file, "-n" = 1->0), then a
+ * summary. At most `max_lines` lines are printed (0 = no limit); the
+ * summary always counts every difference.
+ */
+ConversionResult bitdiff_files(const char *path_a, const char *path_b,
+                               uint64_t offset, uint64_t length,
+                               uint64_t max_lines, int out_fd);
+
+#endif /* BITSTATS_H */
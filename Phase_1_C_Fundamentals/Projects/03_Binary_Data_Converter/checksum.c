@@ -0,0 +1,506 @@
+/*
+ * Binary Data Converter - Checksums
+ *
+ * Every algorithm here is a chain of dependent additions or shifts, so
+ * the kernels split the input across independent accumulators that the
+ * CPU can advance in parallel, then combine them at the end:
+ *
+ *   Internet   four 64-bit accumulators of 32-bit words; ones'
+ *              complement folding happens once at the end
+ *   CRC32      PCLMULQDQ folding of four 128-bit lanes (Intel's "Fast
+ *              CRC Computation Using PCLMULQDQ"), slicing-by-8 tables
+ *              otherwise
+ *   CRC32C     SSE4.2 crc32 instruction on three interleaved streams,
+ *              merged with precomputed "shift by n zero bytes" tables
+ *   Adler-32   32-byte blocks with SSSE3 multiply-adds for the weighted
+ *   Fletcher   sum; the modulo is deferred for as many blocks as the
+ *              32-bit sums allow
+ */
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "checksum.h"
+#include "file_io.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHECKSUM_HAVE_X86 1
+#endif
+
+/* ============================================================================
+ * INTERNET CHECKSUM
+ * ============================================================================ */
+
+/* Fold a 64-bit ones' complement sum to 16 bits */
+static uint16_t fold_sum(uint64_t sum) {
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)sum;
+}
+
+/* Bytes summed before the accumulators are folded (keeps them from overflowing) */
+#define INET_CHUNK ((size_t)1 << 30)
+
+uint16_t checksum_internet(const uint8_t *data, size_t len) {
+    uint64_t total = 0;
+
+    while (len >= 16) {
+        size_t chunk = len < INET_CHUNK ? len & ~(size_t)15 : INET_CHUNK;
+        uint64_t a = 0, b = 0, c = 0, d = 0;
+        for (size_t i = 0; i < chunk; i += 16) {
+            uint32_t w[4];
+            memcpy(w, data + i, 16);
+            a += w[0];
+            b += w[1];
+            c += w[2];
+            d += w[3];
+        }
+        total += fold_sum(a) + fold_sum(b) + fold_sum(c) + fold_sum(d);
+        data += chunk;
+        len -= chunk;
+    }
+    for (; len >= 2; data += 2, len -= 2) {
+        uint16_t w;
+        memcpy(&w, data, 2);
+        total += w;
+    }
+    if (len == 1) {
+        // Pad with a zero byte; in a word loaded in host order that is
+        // the high byte on little-endian machines
+        uint16_t w = 0;
+        memcpy(&w, data, 1);
+        total += w;
+    }
+
+    // Sums of host-order words equal the big-endian sum byte-swapped (RFC 1071)
+    uint16_t sum = ntohs(fold_sum(total));
+    return (uint16_t)~sum;
+}
+
+/* ============================================================================
+ * CRC TABLES (SLICING-BY-8)
+ * ============================================================================ */
+
+#define CRC32_POLY  0xEDB88320u     // IEEE, bit-reflected
+#define CRC32C_POLY 0x82F63B78u     // Castagnoli, bit-reflected
+
+static uint32_t crc32_table[8][256];
+static uint32_t crc32c_table[8][256];
+static pthread_once_t crc_tables_once = PTHREAD_ONCE_INIT;
+
+static void build_crc_table(uint32_t table[8][256], uint32_t poly) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (poly & (0u - (crc & 1)));
+        }
+        table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+        }
+    }
+}
+
+/* Run once through crc_tables_once; library users may checksum on any thread */
+static void build_crc_tables(void) {
+    build_crc_table(crc32_table, CRC32_POLY);
+    build_crc_table(crc32c_table, CRC32C_POLY);
+}
+
+/* Raw CRC register update (no pre/post inversion), 8 bytes per step */
+static uint32_t crc_slice8(uint32_t table[8][256], uint32_t crc,
+                           const uint8_t *data, size_t len) {
+    for (; len >= 8; data += 8, len -= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, data, 4);
+        memcpy(&hi, data + 4, 4);
+        lo ^= crc;
+        crc = table[7][lo & 0xFF] ^ table[6][(lo >> 8) & 0xFF] ^
+              table[5][(lo >> 16) & 0xFF] ^ table[4][lo >> 24] ^
+              table[3][hi & 0xFF] ^ table[2][(hi >> 8) & 0xFF] ^
+              table[1][(hi >> 16) & 0xFF] ^ table[0][hi >> 24];
+    }
+    for (; len > 0; data++, len--) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *data) & 0xFF];
+    }
+    return crc;
+}
+
+/* ============================================================================
+ * CRC32 (PCLMULQDQ FOLDING)
+ * ============================================================================ */
+
+#ifdef CHECKSUM_HAVE_X86
+
+/*
+ * Raw CRC32 register update over `len` bytes, len >= 64 and a multiple
+ * of 16. Constants are x^n mod P for the bit-reflected IEEE polynomial
+ * from the Intel paper: k1/k2 fold 512 bits, k3/k4 fold 128 bits, k5
+ * folds 64 to 32 bits, then Barrett reduction with P and mu.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t *buf, size_t len) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x1, x2, x3, x4, t1, t2, t3, t4;
+
+    // Four independent 128-bit lanes, 64 bytes per step
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    buf += 64;
+    len -= 64;
+
+    while (len >= 64) {
+        t1 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        t2 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        t3 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        t4 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, t1), _mm_loadu_si128((const __m128i *)(buf + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, t2), _mm_loadu_si128((const __m128i *)(buf + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, t3), _mm_loadu_si128((const __m128i *)(buf + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, t4), _mm_loadu_si128((const __m128i *)(buf + 0x30)));
+        buf += 64;
+        len -= 64;
+    }
+
+    // Fold the four lanes into one
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), t1);
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), t1);
+    t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), t1);
+
+    // Remaining 16-byte blocks
+    while (len >= 16) {
+        t1 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, t1), _mm_loadu_si128((const __m128i *)buf));
+        buf += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    // 64 -> 32 bits
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+
+    // Barrett reduction
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+#endif /* CHECKSUM_HAVE_X86 */
+
+uint32_t checksum_crc32(uint32_t crc, const uint8_t *data, size_t len) {
+    pthread_once(&crc_tables_once, build_crc_tables);
+    crc = ~crc;
+
+#ifdef CHECKSUM_HAVE_X86
+    if (len >= 64 && __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+        size_t bulk = len & ~(size_t)15;
+        crc = crc32_pclmul(crc, data, bulk);
+        data += bulk;
+        len -= bulk;
+    }
+#endif
+
+    return ~crc_slice8(crc32_table, crc, data, len);
+}
+
+/* ============================================================================
+ * CRC32C (SSE4.2)
+ * ============================================================================ */
+
+#ifdef CHECKSUM_HAVE_X86
+
+/* Bytes per stream per round; streams are merged once per 3 blocks */
+#define CRC32C_BLOCK 4096
+
+/*
+ * crc32c_shift[k][b]: the raw CRC register value x after CRC32C_BLOCK
+ * (k = 0) or 2 * CRC32C_BLOCK (k = 1) zero bytes, for x = one byte b in
+ * each of the four byte positions. Because the register update is
+ * linear, shifting any value is four lookups XORed together.
+ */
+static uint32_t crc32c_shift[2][4][256];
+static pthread_once_t crc32c_shift_once = PTHREAD_ONCE_INIT;
+
+static uint32_t crc32c_apply_shift(uint32_t table[4][256], uint32_t crc) {
+    return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^
+           table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+}
+
+__attribute__((target("sse4.2")))
+static void build_crc32c_shift(void) {
+    // Shift each single-bit value by feeding zero bytes, then combine
+    uint32_t basis[32];
+    for (int bit = 0; bit < 32; bit++) {
+        uint64_t crc = 1u << bit;
+        for (int i = 0; i < CRC32C_BLOCK; i += 8) {
+            crc = _mm_crc32_u64(crc, 0);
+        }
+        basis[bit] = (uint32_t)crc;
+    }
+    for (int k = 0; k < 4; k++) {
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t shifted = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                if (b & (1u << bit)) {
+                    shifted ^= basis[8 * k + bit];
+                }
+            }
+            crc32c_shift[0][k][b] = shifted;
+        }
+    }
+    // Two blocks = the one-block shift applied twice
+    for (int k = 0; k < 4; k++) {
+        for (uint32_t b = 0; b < 256; b++) {
+            crc32c_shift[1][k][b] = crc32c_apply_shift(crc32c_shift[0],
+                                                       crc32c_shift[0][k][b]);
+        }
+    }
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *data, size_t len) {
+    uint64_t c0 = crc;
+
+    if (len >= 3 * CRC32C_BLOCK) {
+        pthread_once(&crc32c_shift_once, build_crc32c_shift);
+    }
+    while (len >= 3 * CRC32C_BLOCK) {
+        // Three independent dependency chains keep the crc32 unit busy
+        uint64_t c1 = 0, c2 = 0;
+        for (size_t i = 0; i < CRC32C_BLOCK; i += 8) {
+            uint64_t w0, w1, w2;
+            memcpy(&w0, data + i, 8);
+            memcpy(&w1, data + CRC32C_BLOCK + i, 8);
+            memcpy(&w2, data + 2 * CRC32C_BLOCK + i, 8);
+            c0 = _mm_crc32_u64(c0, w0);
+            c1 = _mm_crc32_u64(c1, w1);
+            c2 = _mm_crc32_u64(c2, w2);
+        }
+        c0 = crc32c_apply_shift(crc32c_shift[1], (uint32_t)c0) ^
+             crc32c_apply_shift(crc32c_shift[0], (uint32_t)c1) ^ (uint32_t)c2;
+        data += 3 * CRC32C_BLOCK;
+        len -= 3 * CRC32C_BLOCK;
+    }
+
+    for (; len >= 8; data += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, data, 8);
+        c0 = _mm_crc32_u64(c0, w);
+    }
+    for (; len > 0; data++, len--) {
+        c0 = _mm_crc32_u8((uint32_t)c0, *data);
+    }
+    return (uint32_t)c0;
+}
+
+#endif /* CHECKSUM_HAVE_X86 */
+
+uint32_t checksum_crc32c(uint32_t crc, const uint8_t *data, size_t len) {
+    crc = ~crc;
+#ifdef CHECKSUM_HAVE_X86
+    if (__builtin_cpu_supports("sse4.2")) {
+        return ~crc32c_sse42(crc, data, len);
+    }
+#endif
+    pthread_once(&crc_tables_once, build_crc_tables);
+    return ~crc_slice8(crc32c_table, crc, data, len);
+}
+
+/* ============================================================================
+ * ADLER-32 AND FLETCHER-16
+ *
+ * Both keep a running byte sum s1 and a sum of running sums s2. Over a
+ * block of 32 bytes b[0..31]:
+ *
+ *   s2 += 32 * s1 + sum((32 - i) * b[i])
+ *   s1 += sum(b[i])
+ *
+ * so blocks need no per-byte dependency. At most SUMS_MAX_BLOCKS blocks
+ * (zlib's NMAX = 5552 bytes) fit before s2 could overflow 32 bits with
+ * s1, s2 < 65521; the caller then reduces modulo its base.
+ * ============================================================================ */
+
+#define SUMS_BLOCK 32
+#define SUMS_MAX_BLOCKS (5552 / SUMS_BLOCK)
+
+static void weighted_sums_scalar(const uint8_t *data, size_t blocks,
+                                 uint32_t *s1, uint32_t *s2) {
+    uint32_t a = *s1, b = *s2;
+    for (size_t n = 0; n < blocks; n++, data += SUMS_BLOCK) {
+        // Four interleaved partial sums per block
+        uint32_t p[4] = { 0, 0, 0, 0 }, w[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < SUMS_BLOCK; i += 4) {
+            for (int k = 0; k < 4; k++) {
+                p[k] += data[i + k];
+                w[k] += (uint32_t)(SUMS_BLOCK - i - k) * data[i + k];
+            }
+        }
+        b += SUMS_BLOCK * a + w[0] + w[1] + w[2] + w[3];
+        a += p[0] + p[1] + p[2] + p[3];
+    }
+    *s1 = a;
+    *s2 = b;
+}
+
+#ifdef CHECKSUM_HAVE_X86
+
+__attribute__((target("ssse3")))
+static void weighted_sums_ssse3(const uint8_t *data, size_t blocks,
+                                uint32_t *s1, uint32_t *s2) {
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                       24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                                       8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+
+    // v_ps collects s1 at the start of each block (times 32 at the end)
+    __m128i v_ps = _mm_cvtsi32_si128((int)(*s1 * (uint32_t)blocks));
+    __m128i v_s2 = _mm_cvtsi32_si128((int)*s2);
+    __m128i v_s1 = zero;
+
+    for (size_t n = 0; n < blocks; n++, data += SUMS_BLOCK) {
+        __m128i bytes1 = _mm_loadu_si128((const __m128i *)data);
+        __m128i bytes2 = _mm_loadu_si128((const __m128i *)(data + 16));
+        v_ps = _mm_add_epi32(v_ps, v_s1);
+        v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+        v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+        v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+        v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+    }
+    v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+    // Horizontal sums of the four 32-bit lanes
+    v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(2, 3, 0, 1)));
+    v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(1, 0, 3, 2)));
+    v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(2, 3, 0, 1)));
+    v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(1, 0, 3, 2)));
+    *s1 += (uint32_t)_mm_cvtsi128_si32(v_s1);
+    *s2 = (uint32_t)_mm_cvtsi128_si32(v_s2);
+}
+
+#endif /* CHECKSUM_HAVE_X86 */
+
+/* Run the block kernel over data, reducing modulo `base` as needed */
+static void running_sums(const uint8_t *data, size_t len, uint32_t base,
+                         uint32_t *s1, uint32_t *s2) {
+    void (*kernel)(const uint8_t *, size_t, uint32_t *, uint32_t *) = weighted_sums_scalar;
+#ifdef CHECKSUM_HAVE_X86
+    if (__builtin_cpu_supports("ssse3")) {
+        kernel = weighted_sums_ssse3;
+    }
+#endif
+
+    size_t blocks = len / SUMS_BLOCK;
+    while (blocks > 0) {
+        size_t n = blocks < SUMS_MAX_BLOCKS ? blocks : SUMS_MAX_BLOCKS;
+        kernel(data, n, s1, s2);
+        *s1 %= base;
+        *s2 %= base;
+        data += n * SUMS_BLOCK;
+        blocks -= n;
+    }
+    for (size_t i = 0; i < len % SUMS_BLOCK; i++) {
+        *s1 += data[i];
+        *s2 += *s1;
+    }
+    *s1 %= base;
+    *s2 %= base;
+}
+
+uint32_t checksum_adler32(uint32_t adler, const uint8_t *data, size_t len) {
+    uint32_t s1 = adler & 0xFFFF, s2 = adler >> 16;
+    running_sums(data, len, 65521, &s1, &s2);
+    return (s2 << 16) | s1;
+}
+
+uint16_t checksum_fletcher16(const uint8_t *data, size_t len) {
+    uint32_t s1 = 0, s2 = 0;
+    running_sums(data, len, 255, &s1, &s2);
+    return (uint16_t)((s2 << 8) | s1);
+}
+
+/* ============================================================================
+ * FILE MODE
+ * ============================================================================ */
+
+static const char *const ALL_ALGORITHMS[] = {
+    "inet", "crc32", "crc32c", "adler32", "fletcher16"
+};
+
+ConversionResult checksum_file(const char *path, uint64_t offset,
+                               uint64_t length, const char *const *algorithms,
+                               int num_algorithms) {
+    if (num_algorithms == 0) {
+        algorithms = ALL_ALGORITHMS;
+        num_algorithms = (int)(sizeof(ALL_ALGORITHMS) / sizeof(ALL_ALGORITHMS[0]));
+    }
+
+    for (int i = 0; i < num_algorithms; i++) {
+        int known = 0;
+        for (size_t k = 0; k < sizeof(ALL_ALGORITHMS) / sizeof(ALL_ALGORITHMS[0]); k++) {
+            known |= strcmp(algorithms[i], ALL_ALGORITHMS[k]) == 0;
+        }
+        if (!known) {
+            printf("Unknown checksum: %s (inet, crc32, crc32c, adler32, fletcher16)\n",
+                   algorithms[i]);
+            return RESULT_INVALID_INPUT;
+        }
+    }
+
+    MappedFile file;
+    ConversionResult result = map_file_range(path, offset, length, &file);
+    if (result != RESULT_OK) {
+        return result;
+    }
+
+    printf("%s (%zu bytes from offset 0x%llx)\n", path, file.size,
+           (unsigned long long)file.offset);
+    for (int i = 0; i < num_algorithms; i++) {
+        const char *name = algorithms[i];
+        if (strcmp(name, "inet") == 0) {
+            printf("  Internet:     0x%04x\n", checksum_internet(file.data, file.size));
+        } else if (strcmp(name, "crc32") == 0) {
+            printf("  CRC32:        0x%08x\n", checksum_crc32(0, file.data, file.size));
+        } else if (strcmp(name, "crc32c") == 0) {
+            printf("  CRC32C:       0x%08x\n", checksum_crc32c(0, file.data, file.size));
+        } else if (strcmp(name, "adler32") == 0) {
+            printf("  Adler-32:     0x%08x\n", checksum_adler32(1, file.data, file.size));
+        } else {
+            printf("  Fletcher-16:  0x%04x\n", checksum_fletcher16(file.data, file.size));
+        }
+    }
+
+    unmap_file(&file);
+    return result;
+}
@@ -0,0 +1,47 @@
+/*
+ * Binary Data Converter - Checksums
+ *
+ * The checksums and CRCs met in protocol work, over buffers of any
+ * size. CRC and Adler functions take the running value so large inputs
+ * can be processed in pieces (start with 0 for CRCs, 1 for Adler-32),
+ * matching zlib's crc32()/adler32() conventions.
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+
+/*
+ * RFC 1071 Internet checksum (IPv4/TCP/UDP/ICMP). Returns the value to
+ * place in the header field, as a host-order number (store with htons).
+ * An odd trailing byte is padded with zero. Data that already contains
+ * a valid checksum sums to 0.
+ */
+uint16_t checksum_internet(const uint8_t *data, size_t len);
+
+/* CRC-32 (IEEE 802.3, zlib, PNG, gzip) */
+uint32_t checksum_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+/* CRC-32C (Castagnoli; iSCSI, SCTP, ext4) */
+uint32_t checksum_crc32c(uint32_t crc, const uint8_t *data, size_t len);
+
+/* Adler-32 (zlib stream trailer) */
+uint32_t checksum_adler32(uint32_t adler, const uint8_t *data, size_t len);
+
+/* Fletcher-16 (sum2 << 8 | sum1, both modulo 255) */
+uint16_t checksum_fletcher16(const uint8_t *data, size_t len);
+
+/*
+ * Print the selected checksums ("inet", "crc32", "crc32c", "adler32",
+ * "fletcher16"; all when num_algorithms is 0) of `length` bytes of
+ * `path` from `offset` (0 = to end of file).
+ */
+ConversionResult checksum_file(const char *path, uint64_t offset,
+                               uint64_t length, const char *const *algorithms,
+                               int num_algorithms);
+
+#endif /* CHECKSUM_H */
@@ -0,0 +1,147 @@
+/*
+ * Binary Data Converter - Shared Declarations
+ *
+ * Types, limits and function prototypes shared by the reference solution
+ * (03_c_solution.c) and the extra converter modes that live in their own
+ * source files.
+ */
+
+#ifndef CONVERTER_H
+#define CONVERTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BINARY_STR_MAX 33
+#define HEX_STR_MAX 9
+#define OCTAL_STR_MAX 12
+#define IP_STR_MAX 16
+
+typedef enum {
+    RESULT_OK = 0,
+    RESULT_INVALID_INPUT = 1,
+    RESULT_OVERFLOW = 2,
+    RESULT_FORMAT_ERROR = 3
+} ConversionResult;
+
+typedef enum {
+    OUTPUT_DECIMAL = 1 << 0,
+    OUTPUT_BINARY = 1 << 1,
+    OUTPUT_HEX = 1 << 2,
+    OUTPUT_OCTAL = 1 << 3,
+    OUTPUT_ALL = OUTPUT_DECIMAL | OUTPUT_BINARY | OUTPUT_HEX | OUTPUT_OCTAL
+} OutputFormat;
+
+/* ============================================================================
+ * BIT FIELD DESCRIPTORS
+ * ============================================================================ */
+
+/*
+ * Mask with the low num_bits bits set, valid for 0..32.
+ * Shifting a 64-bit constant keeps num_bits == 32 well defined, unlike
+ * (1U << 32) - 1, and involves no branch.
+ */
+#define FIELD_MASK(num_bits) \
+    ((uint32_t)(0xFFFFFFFFULL >> (32 - (num_bits))))
+
+/* Extract a field whose position is known at compile time */
+#define FIELD_GET(value, start_bit, num_bits) \
+    (((uint32_t)(value) >> (start_bit)) & FIELD_MASK(num_bits))
+
+/*
+ * One protocol header field. Headers are viewed as an array of 32-bit
+ * words in host byte order (i.e. after ntohl), word 0 first, exactly as
+ * they are drawn in the RFC diagrams.
+ */
+typedef struct {
+    const char *name;
+    uint8_t word;       // Index of the 32-bit word holding the field
+    uint8_t start_bit;  // Position of the field's LSB within that word
+    uint8_t num_bits;   // Field width, 1..32
+} BitFieldDesc;
+
+/* A named table of fields describing one header layout */
+typedef struct {
+    const char *name;
+    const BitFieldDesc *fields;
+    size_t num_fields;
+    size_t num_words;   // Header size in 32-bit words (record stride)
+} FieldLayout;
+
+/* IPv4 header (RFC 791), fixed part */
+#define IPV4_VERSION          { "version",         0, 28,  4 }
+#define IPV4_IHL              { "ihl",             0, 24,  4 }
+#define IPV4_DSCP             { "dscp",            0, 18,  6 }
+#define IPV4_ECN              { "ecn",             0, 16,  2 }
+#define IPV4_TOTAL_LENGTH     { "total_length",    0,  0, 16 }
+#define IPV4_IDENTIFICATION   { "identification",  1, 16, 16 }
+#define IPV4_FLAGS            { "flags",           1, 13,  3 }
+#define IPV4_FRAGMENT_OFFSET  { "fragment_offset", 1,  0, 13 }
+#define IPV4_TTL              { "ttl",             2, 24,  8 }
+#define IPV4_PROTOCOL         { "protocol",        2, 16,  8 }
+#define IPV4_CHECKSUM         { "checksum",        2,  0, 16 }
+#define IPV4_SOURCE           { "source",          3,  0, 32 }
+#define IPV4_DESTINATION      { "destination",     4,  0, 32 }
+
+/* TCP header (RFC 9293), fixed part */
+#define TCP_SOURCE_PORT       { "source_port",     0, 16, 16 }
+#define TCP_DEST_PORT         { "dest_port",       0,  0, 16 }
+#define TCP_SEQUENCE          { "sequence",        1,  0, 32 }
+#define TCP_ACKNOWLEDGMENT    { "acknowledgment",  2,  0, 32 }
+#define TCP_DATA_OFFSET       { "data_offset",     3, 28,  4 }
+#define TCP_FLAGS             { "flags",           3, 16,  8 }
+#define TCP_WINDOW            { "window",          3,  0, 16 }
+#define TCP_CHECKSUM          { "checksum",        4, 16, 16 }
+#define TCP_URGENT_POINTER    { "urgent_pointer",  4,  0, 16 }
+
+/* UDP header (RFC 768) */
+#define UDP_SOURCE_PORT       { "source_port",     0, 16, 16 }
+#define UDP_DEST_PORT         { "dest_port",       0,  0, 16 }
+#define UDP_LENGTH            { "length",          1, 16, 16 }
+#define UDP_CHECKSUM          { "checksum",        1,  0, 16 }
+
+extern const FieldLayout FIELD_LAYOUTS[];
+extern const size_t NUM_FIELD_LAYOUTS;
+
+/* ============================================================================
+ * FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+/* Base conversion */
+ConversionResult format_binary(uint32_t value, char *buffer, size_t buffer_size);
+ConversionResult format_hex(uint32_t value, char *buffer, size_t buffer_size);
+ConversionResult format_octal(uint32_t value, char *buffer, size_t buffer_size);
+uint32_t parse_binary(const char *str);
+uint32_t parse_hex(const char *str);
+uint32_t parse_octal(const char *str);
+uint32_t parse_auto(const char *str);
+ConversionResult parse_auto_checked(const char *str, uint32_t *value);
+
+/* Endianness */
+int detect_endianness(void);
+uint32_t swap_bytes_32(uint32_t value);
+uint16_t swap_bytes_16(uint16_t value);
+
+/* Network data */
+uint32_t parse_ip_string(const char *ip_str);
+ConversionResult parse_ipv4_span(const char *str, size_t len, uint32_t *ip_host);
+void format_ip_address(uint32_t ip_binary, char *buffer, size_t buffer_size);
+const char* get_port_name(uint16_t port);
+
+/* Bit-level operations */
+uint32_t extract_field(uint32_t value, int start_bit, int num_bits);
+void set_field(uint32_t *value, int start_bit, int num_bits,
+               uint32_t field_value);
+
+/* Bit field descriptors */
+const FieldLayout *find_field_layout(const char *name);
+const BitFieldDesc *find_field(const char *qualified_name);
+uint32_t extract_desc(const uint32_t *header_words, const BitFieldDesc *field);
+void extract_field_batch(const uint32_t *restrict records, size_t count,
+                         size_t stride, const BitFieldDesc *field,
+                         uint32_t *restrict out);
+void extract_field_batch_be(const uint8_t *restrict records, size_t count,
+                            size_t stride_bytes, const BitFieldDesc *field,
+                            uint32_t *restrict out);
+
+#endif /* CONVERTER_H */
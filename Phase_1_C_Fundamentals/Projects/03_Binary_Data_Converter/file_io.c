@@ -0,0 +1,204 @@
+/*
+ * Binary Data Converter - File Helpers
+ *
+ * See file_io.h.
+ */
+
+#define _DEFAULT_SOURCE  // madvise(), MAP_* flags, getline()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "file_io.h"
+
+/* ============================================================================
+ * MEMORY-MAPPED INPUT
+ * ============================================================================ */
+
+ConversionResult map_file_range(const char *path, uint64_t offset,
+                                uint64_t length, MappedFile *out) {
+    memset(out, 0, sizeof(*out));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", path);
+        perror("open");
+        return RESULT_INVALID_INPUT;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Error: '%s' is not a regular file\n", path);
+        close(fd);
+        return RESULT_INVALID_INPUT;
+    }
+
+    uint64_t file_size = (uint64_t)st.st_size;
+    if (offset > file_size) {
+        offset = file_size;
+    }
+    if (length == 0 || length > file_size - offset) {
+        length = file_size - offset;
+    }
+
+    out->offset = offset;
+    out->size = (size_t)length;
+    if (length == 0) {
+        // mmap() rejects empty mappings; an empty range is still valid
+        close(fd);
+        return RESULT_OK;
+    }
+
+    // mmap() offsets must be page aligned, so map from the page boundary
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t aligned = offset & ~(page - 1);
+    out->map_size = (size_t)(length + (offset - aligned));
+    out->map_base = mmap(NULL, out->map_size, PROT_READ, MAP_PRIVATE, fd,
+                         (off_t)aligned);
+    close(fd);
+
+    if (out->map_base == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map file '%s'\n", path);
+        perror("mmap");
+        out->map_base = NULL;
+        return RESULT_INVALID_INPUT;
+    }
+
+    madvise(out->map_base, out->map_size, MADV_SEQUENTIAL);
+    out->data = (const uint8_t *)out->map_base + (offset - aligned);
+    return RESULT_OK;
+}
+
+void unmap_file(MappedFile *file) {
+    if (file->map_base != NULL) {
+        munmap(file->map_base, file->map_size);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+/* ============================================================================
+ * LINES AND FIELDS
+ * ============================================================================ */
+
+ConversionResult for_each_line(const char *path, LineHandler handler, void *ctx) {
+    if (path != NULL) {
+        MappedFile file;
+        if (map_file_range(path, 0, 0, &file) != RESULT_OK) {
+            return RESULT_INVALID_INPUT;
+        }
+        const char *text = (const char *)file.data;
+        size_t pos = 0;
+        while (pos < file.size) {
+            const char *nl = memchr(text + pos, '\n', file.size - pos);
+            size_t end = nl ? (size_t)(nl - text) : file.size;
+            handler(ctx, text + pos, end - pos);
+            pos = end + 1;
+        }
+        unmap_file(&file);
+    } else {
+        char *line = NULL;
+        size_t cap = 0;
+        ssize_t len;
+        while ((len = getline(&line, &cap, stdin)) > 0) {
+            size_t n = (size_t)len;
+            if (line[n - 1] == '\n') {
+                n--;
+            }
+            handler(ctx, line, n);
+        }
+        free(line);
+    }
+    return RESULT_OK;
+}
+
+void find_column(const char *line, size_t len, int column, size_t *start, size_t *end) {
+    size_t s = 0, e = 0;
+    for (int field = 0; field < column; field++) {
+        s = e;
+        while (s < len && (line[s] == ' ' || line[s] == '\t')) {
+            s++;
+        }
+        e = s;
+        while (e < len && line[e] != ' ' && line[e] != '\t') {
+            e++;
+        }
+    }
+    *start = s;
+    *end = e;
+}
+
+/* ============================================================================
+ * BUFFERED OUTPUT
+ * ============================================================================ */
+
+OutBuf *outbuf_open(int fd) {
+    OutBuf *out = malloc(sizeof(*out));
+    if (out == NULL) {
+        return NULL;
+    }
+    out->fd = fd;
+    out->used = 0;
+    out->failed = 0;
+    return out;
+}
+
+void outbuf_flush(OutBuf *out) {
+    size_t done = 0;
+    while (done < out->used && !out->failed) {
+        ssize_t n = write(out->fd, out->data + done, out->used - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            out->failed = 1;  // e.g. EPIPE from "| head"
+            break;
+        }
+        done += (size_t)n;
+    }
+    out->used = 0;
+}
+
+void outbuf_write(OutBuf *out, const void *data, size_t n) {
+    const char *src = data;
+    while (n > 0) {
+        size_t room = OUTBUF_SIZE - out->used;
+        if (room == 0) {
+            outbuf_flush(out);
+            room = OUTBUF_SIZE;
+        }
+        size_t chunk = n < room ? n : room;
+        memcpy(out->data + out->used, src, chunk);
+        out->used += chunk;
+        src += chunk;
+        n -= chunk;
+    }
+}
+
+ConversionResult outbuf_close(OutBuf *out) {
+    outbuf_flush(out);
+    ConversionResult result = out->failed ? RESULT_FORMAT_ERROR : RESULT_OK;
+    free(out);
+    return result;
+}
+
+int parse_size_arg(const char *str, uint64_t *value) {
+    if (str == NULL || str[0] == '\0' || str[0] == '-') {
+        return 0;
+    }
+
+    char *endptr;
+    errno = 0;
+    unsigned long long v = strtoull(str, &endptr, 0);
+    if (errno != 0 || *endptr != '\0') {
+        return 0;
+    }
+
+    *value = (uint64_t)v;
+    return 1;
+}
@@ -0,0 +1,85 @@
+/*
+ * Binary Data Converter - File Helpers
+ *
+ * Memory-mapped input and large buffered output for the file modes
+ * (hexdump, decoding, checksums, ...). Mapping a file lets the kernels
+ * walk the bytes directly instead of copying them through stdio.
+ */
+
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+
+/* A read-only view of (part of) a file */
+typedef struct {
+    const uint8_t *data;    // First byte of the requested range
+    size_t size;            // Bytes in the requested range
+    uint64_t offset;        // File offset of data[0]
+    void *map_base;         // Page-aligned address returned by mmap
+    size_t map_size;
+} MappedFile;
+
+/*
+ * Map `length` bytes of `path` starting at `offset`. A length of 0 means
+ * "to the end of the file"; ranges past the end are clipped. Errors are
+ * reported on stderr.
+ */
+ConversionResult map_file_range(const char *path, uint64_t offset,
+                                uint64_t length, MappedFile *out);
+void unmap_file(MappedFile *file);
+
+#define OUTBUF_SIZE (1 << 20)
+
+/* Output accumulated in a large buffer and flushed with write(2) */
+typedef struct {
+    int fd;
+    size_t used;
+    int failed;             // Set once a write fails; later writes are dropped
+    char data[OUTBUF_SIZE];
+} OutBuf;
+
+OutBuf *outbuf_open(int fd);
+ConversionResult outbuf_close(OutBuf *out);
+void outbuf_flush(OutBuf *out);
+
+/* Make room for at least `n` bytes and return where to write them */
+static inline char *outbuf_reserve(OutBuf *out, size_t n) {
+    if (out->used + n > OUTBUF_SIZE) {
+        outbuf_flush(out);
+    }
+    return out->data + out->used;
+}
+
+static inline void outbuf_commit(OutBuf *out, size_t n) {
+    out->used += n;
+}
+
+void outbuf_write(OutBuf *out, const void *data, size_t n);
+
+/* Line-oriented modes report the first few bad lines; the rest are only counted */
+#define MAX_REPORTED_LINES 10
+
+/* Called with each line of the input, without its '\n' */
+typedef void (*LineHandler)(void *ctx, const char *line, size_t len);
+
+/*
+ * Call handler(ctx, ...) for every line of `path` (mapped, not copied),
+ * or of stdin if path is NULL. Returns RESULT_INVALID_INPUT if the file
+ * cannot be mapped.
+ */
+ConversionResult for_each_line(const char *path, LineHandler handler, void *ctx);
+
+/*
+ * Field `column` (1-based) of a line whose fields are separated by
+ * spaces and tabs, as [*start, *end); empty if there are fewer fields.
+ */
+void find_column(const char *line, size_t len, int column, size_t *start, size_t *end);
+
+/* Parse a byte count or offset: decimal, 0x hex or 0 octal, 64-bit */
+int parse_size_arg(const char *str, uint64_t *value);
+
+#endif /* FILE_IO_H */
@@ -5,13 +5,22 @@
  * the binary converter implementation.
  *
  * Usage: ./generate_test_data > test_vectors.txt
+ *        ./generate_test_data --exhaustive [options]   (see run_exhaustive)
  */
 
+#define _GNU_SOURCE  // sysconf(), clock_gettime()
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 
+#include "converter.h"
+
 /* Helper function to print binary representation */
 void print_binary(uint32_t value) {
     for (int i = 31; i >= 0; i--) {
@@ -30,7 +39,304 @@ void print_all_bases(uint32_t value) {
     printf("  Octal:        0%011o\n", value);
 }
 
-int main(void) {
+/* ============================================================================
+ * EXHAUSTIVE ROUND-TRIP VALIDATION
+ *
+ * Checks every 32-bit value against the reference solution's functions:
+ *
+ *   format_binary / format_hex / format_octal  vs. reference strings
+ *   parse_binary / parse_hex / parse_octal / parse_auto(_checked) round trips
+ *   format_ip_address / parse_ip_string / parse_ipv4_span for every IPv4
+ *
+ * Reference strings are spliced together from tables that libc
+ * (snprintf) filled once at startup - e.g. hex is table[v >> 16] followed
+ * by table[v & 0xFFFF] - so every value is compared with libc's output
+ * without paying for a snprintf() call per value. A direct libc cross
+ * check (snprintf, strtoul, inet_ntop, inet_pton) also runs on every
+ * `libc_every`-th value; --libc-every 1 runs it on all of them.
+ *
+ * The range is split into chunks handed out to one thread per core.
+ * Each thread formats into its own stack buffers and records its own
+ * failures, so the hot loop shares nothing but the chunk counter.
+ * ============================================================================ */
+
+#define CHUNK_SIZE (1u << 20)
+#define MAX_REPORTED_FAILURES 8
+
+/* Reference tables, filled by snprintf() before the threads start */
+static char hex16_table[65536][4];      // "%04x" of 16 bits
+static char oct_hi_table[16384][5];     // "%05o" of bits 31..18
+static char oct_lo_table[262144][6];    // "%06o" of bits 17..0
+static char bin8_table[256][8];         // 8 binary digits of a byte
+static char octet_table[256][4];        // "%u" of a byte
+static unsigned char octet_len[256];
+
+typedef struct {
+    uint32_t value;
+    const char *check;
+} Failure;
+
+typedef struct {
+    pthread_t thread;
+    uint64_t checked;
+    uint64_t failures;
+    Failure reported[MAX_REPORTED_FAILURES];
+} WorkerState;
+
+static struct {
+    uint64_t first;             // First value to check
+    uint64_t end;               // One past the last value
+    uint64_t next_chunk;        // Shared chunk counter (atomic)
+    uint32_t libc_every;
+} job;
+
+static void build_reference_tables(void) {
+    char tmp[16];
+    for (unsigned i = 0; i < 65536; i++) {
+        snprintf(tmp, sizeof(tmp), "%04x", i);
+        memcpy(hex16_table[i], tmp, 4);
+    }
+    for (unsigned i = 0; i < 16384; i++) {
+        snprintf(tmp, sizeof(tmp), "%05o", i);
+        memcpy(oct_hi_table[i], tmp, 5);
+    }
+    for (unsigned i = 0; i < 262144; i++) {
+        snprintf(tmp, sizeof(tmp), "%06o", i);
+        memcpy(oct_lo_table[i], tmp, 6);
+    }
+    for (unsigned i = 0; i < 256; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            bin8_table[i][7 - bit] = (char)('0' + ((i >> bit) & 1));
+        }
+        octet_len[i] = (unsigned char)snprintf(octet_table[i], sizeof(octet_table[i]), "%u", i);
+    }
+}
+
+static void record_failure(WorkerState *w, uint32_t value, const char *check) {
+    if (w->failures < MAX_REPORTED_FAILURES) {
+        w->reported[w->failures].value = value;
+        w->reported[w->failures].check = check;
+    }
+    w->failures++;
+}
+
+/* Dotted quad for a host-order address from the octet table */
+static size_t reference_ip(uint32_t v, char *dst) {
+    size_t n = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        unsigned octet = (v >> shift) & 0xFF;
+        memcpy(dst + n, octet_table[octet], octet_len[octet]);
+        n += octet_len[octet];
+        dst[n++] = shift ? '.' : '\0';
+    }
+    return n - 1;
+}
+
+static void check_value(WorkerState *w, uint32_t v) {
+    char bin[BINARY_STR_MAX], hex[HEX_STR_MAX], oct[OCTAL_STR_MAX];
+    char ref_bin[BINARY_STR_MAX], ref_hex[2 + HEX_STR_MAX], ref_oct[OCTAL_STR_MAX];
+    char ip[IP_STR_MAX], ref_ip[IP_STR_MAX];
+
+    // Reference strings
+    memcpy(ref_bin, bin8_table[v >> 24], 8);
+    memcpy(ref_bin + 8, bin8_table[(v >> 16) & 0xFF], 8);
+    memcpy(ref_bin + 16, bin8_table[(v >> 8) & 0xFF], 8);
+    memcpy(ref_bin + 24, bin8_table[v & 0xFF], 8);
+    ref_bin[32] = '\0';
+    ref_hex[0] = '0';
+    ref_hex[1] = 'x';
+    memcpy(ref_hex + 2, hex16_table[v >> 16], 4);
+    memcpy(ref_hex + 6, hex16_table[v & 0xFFFF], 4);
+    ref_hex[10] = '\0';
+    memcpy(ref_oct, oct_hi_table[v >> 18], 5);
+    memcpy(ref_oct + 5, oct_lo_table[v & 0x3FFFF], 6);
+    ref_oct[11] = '\0';
+    size_t ref_ip_len = reference_ip(v, ref_ip);
+
+    // Formatting
+    format_binary(v, bin, sizeof(bin));
+    format_hex(v, hex, sizeof(hex));
+    format_octal(v, oct, sizeof(oct));
+    if (memcmp(bin, ref_bin, BINARY_STR_MAX) != 0) record_failure(w, v, "format_binary");
+    if (memcmp(hex, ref_hex + 2, HEX_STR_MAX) != 0) record_failure(w, v, "format_hex");
+    if (memcmp(oct, ref_oct, OCTAL_STR_MAX) != 0) record_failure(w, v, "format_octal");
+
+    // Parsing back
+    uint32_t parsed;
+    if (parse_binary(ref_bin) != v) record_failure(w, v, "parse_binary");
+    if (parse_hex(ref_hex + 2) != v) record_failure(w, v, "parse_hex");
+    if (parse_octal(ref_oct) != v) record_failure(w, v, "parse_octal");
+    if (parse_auto(ref_hex) != v) record_failure(w, v, "parse_auto(0x)");
+    if (parse_auto_checked(ref_hex, &parsed) != RESULT_OK || parsed != v) {
+        record_failure(w, v, "parse_auto_checked(0x)");
+    }
+
+    // IPv4: formatting takes and parsing returns network byte order
+    format_ip_address(htonl(v), ip, sizeof(ip));
+    if (strcmp(ip, ref_ip) != 0) record_failure(w, v, "format_ip_address");
+    if (parse_ip_string(ref_ip) != htonl(v)) record_failure(w, v, "parse_ip_string");
+    if (parse_ipv4_span(ref_ip, ref_ip_len, &parsed) != RESULT_OK || parsed != v) {
+        record_failure(w, v, "parse_ipv4_span");
+    }
+}
+
+/* Direct comparison with libc for sampled values */
+static void check_value_libc(WorkerState *w, uint32_t v) {
+    char buf[64], mine[64];
+
+    format_hex(v, mine, sizeof(mine));
+    snprintf(buf, sizeof(buf), "%08x", v);
+    if (strcmp(mine, buf) != 0) record_failure(w, v, "format_hex vs snprintf");
+
+    format_octal(v, mine, sizeof(mine));
+    snprintf(buf, sizeof(buf), "%011o", v);
+    if (strcmp(mine, buf) != 0) record_failure(w, v, "format_octal vs snprintf");
+
+    format_binary(v, mine, sizeof(mine));
+    if (strtoul(mine, NULL, 2) != v) record_failure(w, v, "format_binary vs strtoul");
+
+    snprintf(buf, sizeof(buf), "%u", v);
+    uint32_t parsed;
+    if (parse_auto(buf) != (uint32_t)strtoul(buf, NULL, 10) ||
+        parse_auto_checked(buf, &parsed) != RESULT_OK || parsed != v) {
+        record_failure(w, v, "parse_auto(decimal) vs strtoul");
+    }
+
+    struct in_addr addr;
+    addr.s_addr = htonl(v);
+    format_ip_address(addr.s_addr, mine, sizeof(mine));
+    if (inet_ntop(AF_INET, &addr, buf, sizeof(buf)) == NULL || strcmp(mine, buf) != 0) {
+        record_failure(w, v, "format_ip_address vs inet_ntop");
+    }
+    if (inet_pton(AF_INET, buf, &addr) != 1 || parse_ip_string(buf) != addr.s_addr) {
+        record_failure(w, v, "parse_ip_string vs inet_pton");
+    }
+}
+
+static void *exhaustive_worker(void *arg) {
+    WorkerState *w = arg;
+
+    for (;;) {
+        uint64_t chunk = __atomic_fetch_add(&job.next_chunk, 1, __ATOMIC_RELAXED);
+        uint64_t start = job.first + chunk * CHUNK_SIZE;
+        if (start >= job.end) {
+            break;
+        }
+        uint64_t stop = start + CHUNK_SIZE < job.end ? start + CHUNK_SIZE : job.end;
+
+        for (uint64_t v = start; v < stop; v++) {
+            check_value(w, (uint32_t)v);
+            if (v % job.libc_every == 0) {
+                check_value_libc(w, (uint32_t)v);
+            }
+        }
+        w->checked += stop - start;
+    }
+    return NULL;
+}
+
+/*
+ * ./generate_test_data --exhaustive [--threads N] [--from X] [--to Y]
+ *                                   [--libc-every N]
+ * Checks X..Y inclusive (default: all 2^32 values). Exit status is 0
+ * only if every check passed. Throughput is about 4 M values/s per
+ * core (about 18 core-minutes for the full range), nearly all of it
+ * spent in the dozen converter calls each value goes through.
+ */
+int run_exhaustive(int argc, char *argv[]) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t from = 0, to = 0xFFFFFFFFULL;
+    unsigned long libc_every = 64;
+
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        unsigned long long value = strtoull(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--threads") == 0) {
+            threads = (long)value;
+        } else if (strcmp(argv[i], "--from") == 0) {
+            from = value;
+        } else if (strcmp(argv[i], "--to") == 0) {
+            to = value;
+        } else if (strcmp(argv[i], "--libc-every") == 0) {
+            libc_every = (unsigned long)value;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+        i++;
+    }
+    if (threads < 1) threads = 1;
+    if (libc_every < 1) libc_every = 1;
+    if (to > 0xFFFFFFFFULL || from > to) {
+        fprintf(stderr, "Invalid range\n");
+        return 1;
+    }
+
+    build_reference_tables();
+    job.first = from;
+    job.end = to + 1;
+    job.next_chunk = 0;
+    job.libc_every = (uint32_t)libc_every;
+
+    printf("Exhaustive round-trip check of 0x%08llx..0x%08llx on %ld threads\n",
+           (unsigned long long)from, (unsigned long long)to, threads);
+    fflush(stdout);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    WorkerState *workers = calloc((size_t)threads, sizeof(*workers));
+    if (workers == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (long i = 0; i < threads; i++) {
+        if (pthread_create(&workers[i].thread, NULL, exhaustive_worker, &workers[i]) != 0) {
+            fprintf(stderr, "Cannot start thread %ld\n", i);
+            // Hand out no more chunks, and wait for the threads already running
+            uint64_t chunks = (job.end - job.first + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            __atomic_store_n(&job.next_chunk, chunks, __ATOMIC_RELAXED);
+            for (long k = 0; k < i; k++) {
+                pthread_join(workers[k].thread, NULL);
+            }
+            free(workers);
+            return 1;
+        }
+    }
+
+    uint64_t checked = 0, failures = 0;
+    for (long i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        checked += workers[i].checked;
+        failures += workers[i].failures;
+        uint64_t shown = workers[i].failures < MAX_REPORTED_FAILURES
+                             ? workers[i].failures : MAX_REPORTED_FAILURES;
+        for (uint64_t f = 0; f < shown; f++) {
+            printf("  FAIL %-32s value 0x%08x\n",
+                   workers[i].reported[f].check, workers[i].reported[f].value);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double seconds = (double)(t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    printf("Checked %llu values in %.2f s (%.1f M values/s), %llu failures\n",
+           (unsigned long long)checked, seconds, checked / seconds / 1e6,
+           (unsigned long long)failures);
+    printf("Verification: %s\n", failures == 0 ? "PASS" : "FAIL");
+
+    free(workers);
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--exhaustive") == 0) {
+        return run_exhaustive(argc, argv);
+    }
+
     printf("===============================================================================\n");
     printf("BINARY CONVERTER - TEST VECTORS\n");
     printf("===============================================================================\n\n");
@@ -267,9 +573,13 @@ int main(void) {
  * Compilation and Usage:
  *
  * To generate test vectors:
- *   gcc -Wall -g generate_test_data.c -o generate_test_data
+ *   make generate_test_data
  *   ./generate_test_data > test_vectors.txt
  *
+ * To check every 32-bit value against the reference solution:
+ *   ./generate_test_data --exhaustive
+ *   ./generate_test_data --exhaustive --from 0 --to 0xFFFFFF --threads 4
+ *
  * This creates a comprehensive test report showing:
  * - Expected outputs for various inputs
  * - Boundary conditions
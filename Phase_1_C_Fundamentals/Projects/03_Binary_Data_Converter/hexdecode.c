@@ -0,0 +1,411 @@
+/*
+ * Binary Data Converter - Hex Decoding Mode
+ *
+ * Decoding runs in two stages:
+ *
+ *   1. Classify 16 input characters at once (SSSE3): compute each
+ *      character's nibble value, a hex-digit mask and a whitespace mask.
+ *      Anything in neither mask is an error, located with a bit scan.
+ *      Whitespace is squeezed out with a pshufb compaction table and the
+ *      nibble values are appended to a staging buffer.
+ *   2. Pack staged nibbles pairwise into bytes: pmaddubsw computes
+ *      hi * 16 + lo for 8 pairs at once and packuswb narrows to bytes.
+ *
+ * The scalar path does the same work one character at a time and
+ * handles CPUs without SSSE3 and the tail of each span.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hexdecode.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEXDECODE_HAVE_SSSE3 1
+#endif
+
+/* Nibbles staged before packing; the slack absorbs one 16-byte block */
+#define NIBBLE_BUF_SIZE 4096
+
+typedef struct {
+    OutBuf *out;
+    uint64_t written;
+    size_t num_nibbles;
+    uint8_t nibbles[NIBBLE_BUF_SIZE + 32];
+} NibbleSink;
+
+/* Nibble value of a hex digit, or -1 */
+static int hex_value(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;  // Fold to lower case
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static int is_hex_space(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* ============================================================================
+ * NIBBLE PACKING
+ * ============================================================================ */
+
+#ifdef HEXDECODE_HAVE_SSSE3
+
+/* Pack 8 nibble pairs per step; returns the number of bytes produced */
+__attribute__((target("ssse3")))
+static size_t pack_pairs_ssse3(const uint8_t *src, uint8_t *dst, size_t num_bytes) {
+    size_t i = 0;
+    for (; i + 8 <= num_bytes; i += 8) {
+        __m128i n = _mm_loadu_si128((const __m128i *)(src + i * 2));
+        // Bytes of 0x0110 are {0x10, 0x01}: hi * 16 + lo per pair
+        __m128i pairs = _mm_maddubs_epi16(n, _mm_set1_epi16(0x0110));
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(pairs, pairs));
+    }
+    return i;
+}
+
+#endif /* HEXDECODE_HAVE_SSSE3 */
+
+/* Pack all complete nibble pairs; an odd nibble stays staged */
+static void sink_pack(NibbleSink *s) {
+    size_t num_bytes = s->num_nibbles / 2;
+    uint8_t *dst = (uint8_t *)outbuf_reserve(s->out, num_bytes);
+    const uint8_t *src = s->nibbles;
+    size_t i = 0;
+
+#ifdef HEXDECODE_HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3")) {
+        i = pack_pairs_ssse3(src, dst, num_bytes);
+    }
+#endif
+
+    for (; i < num_bytes; i++) {
+        dst[i] = (uint8_t)((src[i * 2] << 4) | src[i * 2 + 1]);
+    }
+
+    outbuf_commit(s->out, num_bytes);
+    s->written += num_bytes;
+
+    size_t leftover = s->num_nibbles - num_bytes * 2;
+    if (leftover) {
+        s->nibbles[0] = s->nibbles[num_bytes * 2];
+    }
+    s->num_nibbles = leftover;
+}
+
+/* ============================================================================
+ * SPAN DECODERS
+ * ============================================================================ */
+
+/*
+ * Decode text[start, end), which may only contain hex digits and
+ * whitespace. Returns `end` on success or the offset of the first bad
+ * character.
+ */
+static size_t decode_span_scalar(NibbleSink *s, const char *text,
+                                 size_t start, size_t end) {
+    for (size_t i = start; i < end; i++) {
+        unsigned char c = (unsigned char)text[i];
+        int v = hex_value(c);
+        if (v >= 0) {
+            s->nibbles[s->num_nibbles++] = (uint8_t)v;
+            if (s->num_nibbles >= NIBBLE_BUF_SIZE) {
+                sink_pack(s);
+            }
+        } else if (!is_hex_space(c)) {
+            return i;
+        }
+    }
+    return end;
+}
+
+#ifdef HEXDECODE_HAVE_SSSE3
+
+/* For each 8-bit keep mask, the indices of its set bits (0x80 = unused) */
+static uint8_t COMPACT_TABLE[256][8];
+static pthread_once_t compact_table_once = PTHREAD_ONCE_INIT;
+
+static void build_compact_table(void) {
+    for (int mask = 0; mask < 256; mask++) {
+        int n = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            if (mask & (1 << bit)) {
+                COMPACT_TABLE[mask][n++] = (uint8_t)bit;
+            }
+        }
+        while (n < 8) {
+            COMPACT_TABLE[mask][n++] = 0x80;
+        }
+    }
+}
+
+__attribute__((target("ssse3,popcnt")))
+static size_t decode_span_ssse3(NibbleSink *s, const char *text,
+                                size_t start, size_t end) {
+    size_t i = start;
+
+    for (; i + 16 <= end; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+
+        // Signed compares: bytes >= 0x80 are negative and match nothing
+        __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                         _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                         _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+        __m128i is_space = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+
+        unsigned digit_mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha));
+        unsigned space_mask = (unsigned)_mm_movemask_epi8(is_space);
+        unsigned bad_mask = ~(digit_mask | space_mask) & 0xFFFF;
+        if (bad_mask) {
+            return i + (size_t)__builtin_ctz(bad_mask);
+        }
+
+        __m128i values = _mm_or_si128(
+            _mm_and_si128(is_digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+            _mm_and_si128(is_alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+
+        uint8_t *dst = s->nibbles + s->num_nibbles;
+        if (space_mask == 0) {
+            _mm_storeu_si128((__m128i *)dst, values);
+            s->num_nibbles += 16;
+        } else {
+            // Squeeze out whitespace, 8 characters per shuffle
+            unsigned lo_keep = digit_mask & 0xFF;
+            unsigned hi_keep = digit_mask >> 8;
+            __m128i lo_shuf = _mm_loadl_epi64((const __m128i *)COMPACT_TABLE[lo_keep]);
+            __m128i hi_shuf = _mm_loadl_epi64((const __m128i *)COMPACT_TABLE[hi_keep]);
+            _mm_storel_epi64((__m128i *)dst, _mm_shuffle_epi8(values, lo_shuf));
+            dst += __builtin_popcount(lo_keep);
+            _mm_storel_epi64((__m128i *)dst,
+                             _mm_shuffle_epi8(_mm_srli_si128(values, 8), hi_shuf));
+            s->num_nibbles += (size_t)__builtin_popcount(digit_mask);
+        }
+
+        if (s->num_nibbles >= NIBBLE_BUF_SIZE) {
+            sink_pack(s);
+        }
+    }
+
+    return decode_span_scalar(s, text, i, end);
+}
+
+#endif /* HEXDECODE_HAVE_SSSE3 */
+
+static size_t decode_span(NibbleSink *s, const char *text,
+                          size_t start, size_t end) {
+#ifdef HEXDECODE_HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("popcnt")) {
+        return decode_span_ssse3(s, text, start, end);
+    }
+#endif
+    return decode_span_scalar(s, text, start, end);
+}
+
+/* ============================================================================
+ * INPUT STYLES
+ * ============================================================================ */
+
+static ConversionResult set_error(HexDecodeError *err, const char *text,
+                                  size_t len, size_t offset,
+                                  const char *message) {
+    err->message = message;
+    err->offset = offset;
+    err->ch = offset < len ? (unsigned char)text[offset] : -1;
+
+    // Line and column are only needed for the report, so count them now
+    err->line = 1;
+    size_t line_start = 0;
+    for (size_t i = 0; i < offset && i < len; i++) {
+        if (text[i] == '\n') {
+            err->line++;
+            line_start = i + 1;
+        }
+    }
+    err->column = offset - line_start + 1;
+    return RESULT_INVALID_INPUT;
+}
+
+/* Offset of the last hex digit in text[start, end), for odd-length errors */
+static size_t last_digit_offset(const char *text, size_t start, size_t end) {
+    while (end > start && hex_value((unsigned char)text[end - 1]) < 0) {
+        end--;
+    }
+    return end > start ? end - 1 : start;
+}
+
+static ConversionResult decode_plain(NibbleSink *s, const char *text,
+                                     size_t len, HexDecodeError *err) {
+    size_t bad = decode_span(s, text, 0, len);
+    if (bad != len) {
+        return set_error(err, text, len, bad, "invalid hex character");
+    }
+    if (s->num_nibbles & 1) {
+        return set_error(err, text, len, last_digit_offset(text, 0, len),
+                         "odd number of hex digits");
+    }
+    sink_pack(s);
+    return RESULT_OK;
+}
+
+/*
+ * xxd lines: "<hex offset>: <hex groups>  <ascii>". The hex area ends at
+ * the first double space. Output starts at the first line's offset;
+ * later gaps are zero-filled like the holes `xxd -r` leaves.
+ */
+static ConversionResult decode_xxd(NibbleSink *s, const char *text,
+                                   size_t len, HexDecodeError *err) {
+    uint64_t base = 0;
+    int first_line = 1;
+    size_t pos = 0;
+
+    while (pos < len) {
+        const char *nl = memchr(text + pos, '\n', len - pos);
+        size_t line_end = nl ? (size_t)(nl - text) : len;
+        size_t next = nl ? line_end + 1 : len;
+
+        // Skip blank lines
+        size_t p = pos;
+        while (p < line_end && is_hex_space((unsigned char)text[p])) p++;
+        if (p == line_end) {
+            pos = next;
+            continue;
+        }
+
+        // Offset field
+        uint64_t line_offset = 0;
+        size_t digits = 0;
+        for (; p < line_end && text[p] != ':'; p++, digits++) {
+            int v = hex_value((unsigned char)text[p]);
+            if (v < 0 || digits >= 16) {
+                return set_error(err, text, len, p, "invalid xxd offset");
+            }
+            line_offset = (line_offset << 4) | (uint64_t)v;
+        }
+        if (p == line_end || digits == 0) {
+            return set_error(err, text, len, p, "missing ':' after xxd offset");
+        }
+        p++;  // Skip ':'
+
+        // Hex area runs to the double space before the ASCII gutter.
+        // Default xxd lines (full or padded) put it exactly 40 columns in.
+        size_t hex_end = p;
+        if (p + 42 <= line_end && text[p + 40] == ' ' && text[p + 41] == ' ') {
+            hex_end = p + 40;
+        }
+        while (hex_end < line_end &&
+               !(text[hex_end] == ' ' && hex_end + 1 < line_end && text[hex_end + 1] == ' ')) {
+            hex_end++;
+        }
+
+        if (first_line) {
+            base = line_offset;
+            first_line = 0;
+        }
+
+        // Lines always end on a whole byte, so staged nibbles are even
+        uint64_t expected = base + s->written + s->num_nibbles / 2;
+        if (line_offset < expected) {
+            return set_error(err, text, len, pos, "xxd offset goes backwards");
+        }
+        if (line_offset > expected) {
+            sink_pack(s);  // Flush staged bytes ahead of the hole
+        }
+        static const char zeros[4096];
+        for (uint64_t gap = line_offset - expected; gap > 0; ) {
+            size_t chunk = gap < sizeof(zeros) ? (size_t)gap : sizeof(zeros);
+            outbuf_write(s->out, zeros, chunk);
+            s->written += chunk;
+            gap -= chunk;
+        }
+
+        size_t bad = decode_span(s, text, p, hex_end);
+        if (bad != hex_end) {
+            return set_error(err, text, len, bad, "invalid hex character");
+        }
+        if (s->num_nibbles & 1) {
+            return set_error(err, text, len, last_digit_offset(text, p, hex_end),
+                             "odd number of hex digits on line");
+        }
+
+        pos = next;
+    }
+
+    sink_pack(s);
+    return RESULT_OK;
+}
+
+/* ============================================================================
+ * PUBLIC INTERFACE
+ * ============================================================================ */
+
+ConversionResult hex_decode_buffer(const char *text, size_t len,
+                                   HexInputStyle style, OutBuf *out,
+                                   uint64_t *bytes_written,
+                                   HexDecodeError *err) {
+#ifdef HEXDECODE_HAVE_SSSE3
+    // Callers may decode on several threads at once
+    pthread_once(&compact_table_once, build_compact_table);
+#endif
+
+    NibbleSink *sink = malloc(sizeof(*sink));
+    if (sink == NULL) {
+        return RESULT_OVERFLOW;
+    }
+    sink->out = out;
+    sink->written = 0;
+    sink->num_nibbles = 0;
+
+    ConversionResult result = (style == HEX_INPUT_XXD)
+        ? decode_xxd(sink, text, len, err)
+        : decode_plain(sink, text, len, err);
+
+    *bytes_written = sink->written;
+    free(sink);
+    return result;
+}
+
+ConversionResult hex_decode_file(const char *path, HexInputStyle style,
+                                 int out_fd) {
+    MappedFile file;
+    ConversionResult result = map_file_range(path, 0, 0, &file);
+    if (result != RESULT_OK) {
+        return result;
+    }
+
+    OutBuf *out = outbuf_open(out_fd);
+    if (out == NULL) {
+        unmap_file(&file);
+        return RESULT_OVERFLOW;
+    }
+
+    uint64_t written = 0;
+    HexDecodeError err;
+    result = hex_decode_buffer((const char *)file.data, file.size, style,
+                               out, &written, &err);
+
+    if (result == RESULT_INVALID_INPUT) {
+        fprintf(stderr, "Error: %s at offset %zu (line %zu, column %zu)",
+                err.message, err.offset, err.line, err.column);
+        if (err.ch >= 0x20 && err.ch <= 0x7e) {
+            fprintf(stderr, ": '%c'", err.ch);
+        } else if (err.ch >= 0) {
+            fprintf(stderr, ": byte 0x%02x", err.ch);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    ConversionResult close_result = outbuf_close(out);
+    unmap_file(&file);
+    return result != RESULT_OK ? result : close_result;
+}
@@ -0,0 +1,50 @@
+/*
+ * Binary Data Converter - Hex Decoding Mode
+ *
+ * The inverse of hexdump: turn hex text back into binary. Two input
+ * styles are accepted:
+ *
+ *   plain  "4500 003c 1c46..."  hex digits, any whitespace ignored
+ *   xxd    "00000010: 2061 6263 ...  abc"  offsets honoured, ASCII gutter skipped
+ *
+ * Anything else is rejected with the exact byte offset of the first bad
+ * character.
+ */
+
+#ifndef HEXDECODE_H
+#define HEXDECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+#include "file_io.h"
+
+typedef enum {
+    HEX_INPUT_PLAIN = 0,
+    HEX_INPUT_XXD = 1
+} HexInputStyle;
+
+typedef struct {
+    const char *message;
+    size_t offset;      // Byte offset of the problem in the input text
+    size_t line;        // 1-based line and column of that byte
+    size_t column;
+    int ch;             // Offending character, or -1 when not applicable
+} HexDecodeError;
+
+/*
+ * Decode `len` bytes of hex text, appending the binary to `out`.
+ * Returns RESULT_OK, or RESULT_INVALID_INPUT with `err` filled in.
+ * `bytes_written` receives the number of decoded bytes.
+ */
+ConversionResult hex_decode_buffer(const char *text, size_t len,
+                                   HexInputStyle style, OutBuf *out,
+                                   uint64_t *bytes_written,
+                                   HexDecodeError *err);
+
+/* Decode a whole file to `out_fd`, printing any error to stderr */
+ConversionResult hex_decode_file(const char *path, HexInputStyle style,
+                                 int out_fd);
+
+#endif /* HEXDECODE_H */
@@ -0,0 +1,179 @@
+/*
+ * Binary Data Converter - Hexdump Mode
+ *
+ * Output matches `xxd` (default settings) byte for byte:
+ *
+ *   00000000: 4865 6c6c 6f2c 2077 6f72 6c64 0a00 01ff  Hello, world....
+ *
+ * Full 16-byte lines are formatted by an SSSE3 kernel: pshufb maps each
+ * nibble to its ASCII digit through a 16-entry table, a second pshufb
+ * spreads the digits into "hhhh " groups, and signed compares build the
+ * printable-character mask for the ASCII gutter. Partial lines and CPUs
+ * without SSSE3 use the scalar formatter.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hexdump.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEXDUMP_HAVE_SSSE3 1
+#endif
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+/* Hex area: 8 groups of " hhhh" */
+#define HEX_AREA_WIDTH 40
+
+/* ============================================================================
+ * LINE FORMATTERS
+ * ============================================================================ */
+
+/* Write the "00000010:" prefix; returns characters written */
+static size_t format_offset(uint64_t offset, char *dst) {
+    // xxd prints at least 8 digits and widens for offsets past 4 GiB
+    int digits = 8;
+    while (digits < 16 && (offset >> (digits * 4)) != 0) {
+        digits++;
+    }
+    for (int i = digits - 1; i >= 0; i--) {
+        dst[i] = HEX_DIGITS[offset & 0xF];
+        offset >>= 4;
+    }
+    dst[digits] = ':';
+    return (size_t)digits + 1;
+}
+
+/* Format 1..16 bytes after the offset prefix; returns characters written */
+static size_t format_line_scalar(const uint8_t *src, size_t n, char *dst) {
+    char *p = dst;
+    for (size_t i = 0; i < n; i++) {
+        if ((i & 1) == 0) {
+            *p++ = ' ';
+        }
+        *p++ = HEX_DIGITS[src[i] >> 4];
+        *p++ = HEX_DIGITS[src[i] & 0xF];
+    }
+
+    // Pad a short last line so the ASCII gutter stays aligned
+    while (p < dst + HEX_AREA_WIDTH) {
+        *p++ = ' ';
+    }
+    *p++ = ' ';
+    *p++ = ' ';
+
+    for (size_t i = 0; i < n; i++) {
+        *p++ = (src[i] >= 0x20 && src[i] <= 0x7e) ? (char)src[i] : '.';
+    }
+    *p++ = '\n';
+    return (size_t)(p - dst);
+}
+
+#ifdef HEXDUMP_HAVE_SSSE3
+
+/* Format exactly 16 bytes; always writes 59 characters */
+__attribute__((target("ssse3")))
+static size_t format_line_ssse3(const uint8_t *src, char *dst) {
+    const __m128i lut = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+
+    // Spread 16 digits into " hhhh hhhh hhh" (-1 selects a zero byte)
+    const __m128i spread = _mm_setr_epi8(-1, 0, 1, 2, 3, -1, 4, 5,
+                                         6, 7, -1, 8, 9, 10, 11, -1);
+    const __m128i spaces = _mm_setr_epi8(' ', 0, 0, 0, 0, ' ', 0, 0,
+                                         0, 0, ' ', 0, 0, 0, 0, ' ');
+
+    __m128i v = _mm_loadu_si128((const __m128i *)src);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low_nibble);
+    __m128i lo = _mm_and_si128(v, low_nibble);
+    __m128i hi_chars = _mm_shuffle_epi8(lut, hi);
+    __m128i lo_chars = _mm_shuffle_epi8(lut, lo);
+
+    // Interleave to "hlhlhl..." for bytes 0-7 and 8-15
+    __m128i digits0 = _mm_unpacklo_epi8(hi_chars, lo_chars);
+    __m128i digits1 = _mm_unpackhi_epi8(hi_chars, lo_chars);
+
+    // Each half becomes 20 characters: 16 via the spread shuffle, plus
+    // the last group's 4 digits copied from the top of the register
+    __m128i grouped0 = _mm_or_si128(_mm_shuffle_epi8(digits0, spread), spaces);
+    __m128i grouped1 = _mm_or_si128(_mm_shuffle_epi8(digits1, spread), spaces);
+    int tail0 = _mm_cvtsi128_si32(_mm_srli_si128(digits0, 12));
+    int tail1 = _mm_cvtsi128_si32(_mm_srli_si128(digits1, 12));
+
+    _mm_storeu_si128((__m128i *)dst, grouped0);
+    memcpy(dst + 16, &tail0, 4);
+    _mm_storeu_si128((__m128i *)(dst + 20), grouped1);
+    memcpy(dst + 36, &tail1, 4);
+
+    // Printable is 0x20..0x7e; bytes >= 0x80 are negative as signed
+    // chars and fail the first compare
+    __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)),
+                                      _mm_cmplt_epi8(v, _mm_set1_epi8(0x7f)));
+    __m128i ascii = _mm_or_si128(_mm_and_si128(printable, v),
+                                 _mm_andnot_si128(printable, _mm_set1_epi8('.')));
+
+    dst[40] = ' ';
+    dst[41] = ' ';
+    _mm_storeu_si128((__m128i *)(dst + 42), ascii);
+    dst[58] = '\n';
+    return 59;
+}
+
+#endif /* HEXDUMP_HAVE_SSSE3 */
+
+/* ============================================================================
+ * DUMP DRIVERS
+ * ============================================================================ */
+
+void hexdump_buffer(const uint8_t *data, size_t size, uint64_t offset,
+                    OutBuf *out) {
+    size_t pos = 0;
+
+#ifdef HEXDUMP_HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3")) {
+        while (size - pos >= HEXDUMP_BYTES_PER_LINE) {
+            char *dst = outbuf_reserve(out, HEXDUMP_LINE_MAX);
+            size_t n = format_offset(offset + pos, dst);
+            n += format_line_ssse3(data + pos, dst + n);
+            outbuf_commit(out, n);
+            pos += HEXDUMP_BYTES_PER_LINE;
+        }
+    }
+#endif
+
+    while (pos < size) {
+        size_t chunk = size - pos;
+        if (chunk > HEXDUMP_BYTES_PER_LINE) {
+            chunk = HEXDUMP_BYTES_PER_LINE;
+        }
+        char *dst = outbuf_reserve(out, HEXDUMP_LINE_MAX);
+        size_t n = format_offset(offset + pos, dst);
+        n += format_line_scalar(data + pos, chunk, dst + n);
+        outbuf_commit(out, n);
+        pos += chunk;
+    }
+}
+
+ConversionResult hexdump_file(const char *path, uint64_t offset,
+                              uint64_t length, int out_fd) {
+    MappedFile file;
+    ConversionResult result = map_file_range(path, offset, length, &file);
+    if (result != RESULT_OK) {
+        return result;
+    }
+
+    OutBuf *out = outbuf_open(out_fd);
+    if (out == NULL) {
+        unmap_file(&file);
+        return RESULT_OVERFLOW;
+    }
+
+    hexdump_buffer(file.data, file.size, file.offset, out);
+
+    result = outbuf_close(out);
+    unmap_file(&file);
+    return result;
+}
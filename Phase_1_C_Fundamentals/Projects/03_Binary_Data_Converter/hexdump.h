@@ -0,0 +1,33 @@
+/*
+ * Binary Data Converter - Hexdump Mode
+ *
+ * xxd-compatible dumps ("00000010: 2061 6263 ...  abc...") of whole
+ * files or byte ranges, formatted 16 bytes at a time with SIMD.
+ */
+
+#ifndef HEXDUMP_H
+#define HEXDUMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+#include "file_io.h"
+
+#define HEXDUMP_BYTES_PER_LINE 16
+
+/* Longest line: 16-digit offset, ':', 40 hex/space, 2 spaces, 16 ASCII, '\n' */
+#define HEXDUMP_LINE_MAX 76
+
+/*
+ * Format `size` bytes as xxd lines. `offset` is the file offset printed
+ * for data[0].
+ */
+void hexdump_buffer(const uint8_t *data, size_t size, uint64_t offset,
+                    OutBuf *out);
+
+/* Dump `length` bytes of `path` from `offset` (0 = to end of file) */
+ConversionResult hexdump_file(const char *path, uint64_t offset,
+                              uint64_t length, int out_fd);
+
+#endif /* HEXDUMP_H */
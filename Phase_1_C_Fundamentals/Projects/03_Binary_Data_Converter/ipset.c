@@ -0,0 +1,1020 @@
+/*
+ * Binary Data Converter - IPv4 Address Sets
+ *
+ * See ipset.h for the container layout and file format.
+ *
+ * Sets are immutable once built: every operation produces a new set,
+ * so containers of a set opened with ipset_open can point straight into
+ * the mapping. Container operations go through a bitmap whenever either
+ * side is a bitmap or the result may outgrow an array; the result is
+ * converted back to an array if it ends up sparse.
+ */
+
+#define _DEFAULT_SOURCE  // getline()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ipset.h"
+#include "bitstats.h"
+
+#define BITMAP_BYTES (IPSET_BITMAP_WORDS * sizeof(uint64_t))
+
+/* Small containers are sorted directly, larger ones through a bitmap */
+#define INSERTION_SORT_MAX 32
+
+typedef enum {
+    OP_UNION,
+    OP_INTERSECT,
+    OP_DIFFERENCE
+} SetOp;
+
+/* On-disk header and directory entry (see ipset.h) */
+typedef struct {
+    char magic[8];
+    uint32_t num_containers;
+    uint32_t reserved;
+    uint64_t cardinality;
+} IpSetFileHeader;
+
+typedef struct {
+    uint16_t key;
+    uint16_t type;
+    uint32_t cardinality;
+    uint64_t data_offset;
+} IpSetFileEntry;
+
+static ConversionResult out_of_memory(void) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return RESULT_OVERFLOW;
+}
+
+/* ============================================================================
+ * CONTAINERS
+ * ============================================================================ */
+
+static size_t container_bytes(const IpSetContainer *c) {
+    return c->type == IPSET_BITMAP ? BITMAP_BYTES : c->cardinality * sizeof(uint16_t);
+}
+
+static int container_has(const IpSetContainer *c, uint16_t low) {
+    if (c->type == IPSET_BITMAP) {
+        const uint64_t *bits = c->data;
+        return (int)((bits[low >> 6] >> (low & 63)) & 1);
+    }
+
+    const uint16_t *values = c->data;
+    size_t lo = 0, hi = c->cardinality;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (values[mid] < low) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < c->cardinality && values[lo] == low;
+}
+
+/* Fresh bitmap with the container's values; NULL if out of memory */
+static uint64_t *bitmap_copy(const IpSetContainer *c) {
+    uint64_t *bits = calloc(IPSET_BITMAP_WORDS, sizeof(uint64_t));
+    if (bits == NULL) {
+        return NULL;
+    }
+    if (c->type == IPSET_BITMAP) {
+        memcpy(bits, c->data, BITMAP_BYTES);
+    } else {
+        const uint16_t *values = c->data;
+        for (uint32_t i = 0; i < c->cardinality; i++) {
+            bits[values[i] >> 6] |= 1ULL << (values[i] & 63);
+        }
+    }
+    return bits;
+}
+
+/* Set bits first..last (inclusive) */
+static void bitmap_set_range(uint64_t *bits, uint32_t first, uint32_t last) {
+    uint32_t first_word = first >> 6, last_word = last >> 6;
+    uint64_t first_mask = ~0ULL << (first & 63);
+    uint64_t last_mask = ~0ULL >> (63 - (last & 63));
+
+    if (first_word == last_word) {
+        bits[first_word] |= first_mask & last_mask;
+        return;
+    }
+    bits[first_word] |= first_mask;
+    for (uint32_t w = first_word + 1; w < last_word; w++) {
+        bits[w] = ~0ULL;
+    }
+    bits[last_word] |= last_mask;
+}
+
+/*
+ * Make a container from a bitmap, converting it to an array if it holds
+ * IPSET_ARRAY_MAX values or fewer. Takes ownership of `bits`. An empty
+ * result has cardinality 0 and no data. Returns 0 if out of memory.
+ */
+static int container_from_bitmap(IpSetContainer *c, uint16_t key, uint64_t *bits) {
+    uint64_t card = popcount_bytes((const uint8_t *)bits, BITMAP_BYTES);
+
+    c->key = key;
+    c->cardinality = (uint32_t)card;
+    if (card > IPSET_ARRAY_MAX) {
+        c->type = IPSET_BITMAP;
+        c->data = bits;
+        return 1;
+    }
+
+    c->type = IPSET_ARRAY;
+    c->data = NULL;
+    if (card == 0) {
+        free(bits);
+        return 1;
+    }
+
+    uint16_t *values = malloc(card * sizeof(uint16_t));
+    if (values == NULL) {
+        free(bits);
+        return 0;
+    }
+    size_t n = 0;
+    for (uint32_t w = 0; w < IPSET_BITMAP_WORDS; w++) {
+        for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+            values[n++] = (uint16_t)(w * 64 + (uint32_t)__builtin_ctzll(word));
+        }
+    }
+    free(bits);
+    c->data = values;
+    return 1;
+}
+
+static int container_clone(const IpSetContainer *src, IpSetContainer *dst) {
+    *dst = *src;
+    dst->data = malloc(container_bytes(src));
+    if (dst->data == NULL) {
+        return 0;
+    }
+    memcpy(dst->data, src->data, container_bytes(src));
+    return 1;
+}
+
+/* Keep the values of array `a` that are (keep = 1) or are not in `b` */
+static int container_filter(const IpSetContainer *a, const IpSetContainer *b,
+                            int keep, IpSetContainer *out) {
+    const uint16_t *values = a->data;
+    uint16_t *result = malloc(a->cardinality * sizeof(uint16_t));
+    if (result == NULL) {
+        return 0;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < a->cardinality; i++) {
+        if (container_has(b, values[i]) == keep) {
+            result[n++] = values[i];
+        }
+    }
+
+    out->key = a->key;
+    out->type = IPSET_ARRAY;
+    out->cardinality = n;
+    out->data = result;
+    if (n == 0) {
+        free(result);
+        out->data = NULL;
+    }
+    return 1;
+}
+
+/* Union of two arrays whose sizes add up to at most IPSET_ARRAY_MAX */
+static int container_merge_arrays(const IpSetContainer *a, const IpSetContainer *b,
+                                  IpSetContainer *out) {
+    const uint16_t *va = a->data, *vb = b->data;
+    uint16_t *result = malloc((a->cardinality + b->cardinality) * sizeof(uint16_t));
+    if (result == NULL) {
+        return 0;
+    }
+
+    uint32_t i = 0, j = 0, n = 0;
+    while (i < a->cardinality && j < b->cardinality) {
+        if (va[i] < vb[j]) {
+            result[n++] = va[i++];
+        } else if (vb[j] < va[i]) {
+            result[n++] = vb[j++];
+        } else {
+            result[n++] = va[i++];
+            j++;
+        }
+    }
+    while (i < a->cardinality) {
+        result[n++] = va[i++];
+    }
+    while (j < b->cardinality) {
+        result[n++] = vb[j++];
+    }
+
+    out->key = a->key;
+    out->type = IPSET_ARRAY;
+    out->cardinality = n;
+    out->data = result;
+    return 1;
+}
+
+/* Combine two containers with the same key; returns 0 if out of memory */
+static int container_op(const IpSetContainer *a, const IpSetContainer *b,
+                        SetOp op, IpSetContainer *out) {
+    if (op == OP_UNION && a->type == IPSET_ARRAY && b->type == IPSET_ARRAY &&
+        a->cardinality + b->cardinality <= IPSET_ARRAY_MAX) {
+        return container_merge_arrays(a, b, out);
+    }
+    if (op == OP_INTERSECT && a->type == IPSET_ARRAY) {
+        return container_filter(a, b, 1, out);
+    }
+    if (op == OP_INTERSECT && b->type == IPSET_ARRAY) {
+        return container_filter(b, a, 1, out);
+    }
+    if (op == OP_DIFFERENCE && a->type == IPSET_ARRAY) {
+        return container_filter(a, b, 0, out);
+    }
+
+    // At least one bitmap involved (or a union too big for an array)
+    uint64_t *bits = bitmap_copy(a);
+    if (bits == NULL) {
+        return 0;
+    }
+    if (b->type == IPSET_BITMAP) {
+        const uint64_t *other = b->data;
+        for (uint32_t w = 0; w < IPSET_BITMAP_WORDS; w++) {
+            switch (op) {
+                case OP_UNION:      bits[w] |= other[w]; break;
+                case OP_INTERSECT:  bits[w] &= other[w]; break;
+                case OP_DIFFERENCE: bits[w] &= ~other[w]; break;
+            }
+        }
+    } else {
+        // Intersection with an array was handled above
+        const uint16_t *values = b->data;
+        for (uint32_t i = 0; i < b->cardinality; i++) {
+            uint64_t bit = 1ULL << (values[i] & 63);
+            if (op == OP_UNION) {
+                bits[values[i] >> 6] |= bit;
+            } else {
+                bits[values[i] >> 6] &= ~bit;
+            }
+        }
+    }
+    return container_from_bitmap(out, a->key, bits);
+}
+
+/* ============================================================================
+ * SETS
+ * ============================================================================ */
+
+void ipset_init(IpSet *set) {
+    memset(set, 0, sizeof(*set));
+}
+
+void ipset_free(IpSet *set) {
+    // Containers of a mapped set point into the mapping
+    if (set->file.map_base == NULL) {
+        for (size_t i = 0; i < set->count; i++) {
+            free(set->containers[i].data);
+        }
+    }
+    free(set->containers);
+    unmap_file(&set->file);
+    ipset_init(set);
+}
+
+/* Append a container (keys must be added in increasing order). Empty
+ * containers are dropped. Returns 0 if out of memory. */
+static int ipset_push(IpSet *set, const IpSetContainer *c) {
+    if (c->cardinality == 0) {
+        return 1;
+    }
+    if (set->count == set->capacity) {
+        size_t capacity = set->capacity ? set->capacity * 2 : 64;
+        IpSetContainer *grown = realloc(set->containers, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return 0;
+        }
+        set->containers = grown;
+        set->capacity = capacity;
+    }
+    set->containers[set->count++] = *c;
+    return 1;
+}
+
+static const IpSetContainer *find_container(const IpSet *set, uint16_t key) {
+    size_t lo = 0, hi = set->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (set->containers[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < set->count && set->containers[lo].key == key) ? &set->containers[lo] : NULL;
+}
+
+int ipset_contains(const IpSet *set, uint32_t ip) {
+    const IpSetContainer *c = find_container(set, (uint16_t)(ip >> 16));
+    return c != NULL && container_has(c, (uint16_t)ip);
+}
+
+uint64_t ipset_cardinality(const IpSet *set) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        total += set->containers[i].cardinality;
+    }
+    return total;
+}
+
+static ConversionResult ipset_combine(const IpSet *a, const IpSet *b, SetOp op,
+                                      IpSet *out) {
+    ipset_init(out);
+
+    size_t i = 0, j = 0;
+    while (i < a->count || j < b->count) {
+        const IpSetContainer *ca = i < a->count ? &a->containers[i] : NULL;
+        const IpSetContainer *cb = j < b->count ? &b->containers[j] : NULL;
+        IpSetContainer c;
+        int ok;
+
+        if (cb == NULL || (ca != NULL && ca->key < cb->key)) {
+            i++;
+            if (op == OP_INTERSECT) {
+                continue;
+            }
+            ok = container_clone(ca, &c);
+        } else if (ca == NULL || cb->key < ca->key) {
+            j++;
+            if (op != OP_UNION) {
+                continue;
+            }
+            ok = container_clone(cb, &c);
+        } else {
+            i++;
+            j++;
+            ok = container_op(ca, cb, op, &c);
+        }
+
+        if (!ok || !ipset_push(out, &c)) {
+            if (ok) {
+                free(c.data);
+            }
+            ipset_free(out);
+            return out_of_memory();
+        }
+    }
+    return RESULT_OK;
+}
+
+ConversionResult ipset_union(const IpSet *a, const IpSet *b, IpSet *out) {
+    return ipset_combine(a, b, OP_UNION, out);
+}
+
+ConversionResult ipset_intersect(const IpSet *a, const IpSet *b, IpSet *out) {
+    return ipset_combine(a, b, OP_INTERSECT, out);
+}
+
+ConversionResult ipset_difference(const IpSet *a, const IpSet *b, IpSet *out) {
+    return ipset_combine(a, b, OP_DIFFERENCE, out);
+}
+
+/* ============================================================================
+ * BUILDING SETS
+ * ============================================================================ */
+
+/* Sorted, duplicate-free container from the low halves of one /16 */
+static int container_from_values(IpSetContainer *c, uint16_t key,
+                                 uint16_t *values, size_t n) {
+    if (n > INSERTION_SORT_MAX) {
+        uint64_t *bits = calloc(IPSET_BITMAP_WORDS, sizeof(uint64_t));
+        if (bits == NULL) {
+            return 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+            bits[values[i] >> 6] |= 1ULL << (values[i] & 63);
+        }
+        return container_from_bitmap(c, key, bits);
+    }
+
+    for (size_t i = 1; i < n; i++) {
+        uint16_t v = values[i];
+        size_t k = i;
+        while (k > 0 && values[k - 1] > v) {
+            values[k] = values[k - 1];
+            k--;
+        }
+        values[k] = v;
+    }
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (unique == 0 || values[unique - 1] != values[i]) {
+            values[unique++] = values[i];
+        }
+    }
+
+    c->key = key;
+    c->type = IPSET_ARRAY;
+    c->cardinality = (uint32_t)unique;
+    c->data = malloc(unique * sizeof(uint16_t));
+    if (c->data == NULL) {
+        return 0;
+    }
+    memcpy(c->data, values, unique * sizeof(uint16_t));
+    return 1;
+}
+
+ConversionResult ipset_from_addresses(const uint32_t *addrs, size_t count,
+                                      IpSet *out) {
+    ipset_init(out);
+
+    // Counting sort by /16, keeping only the low halves
+    size_t *start = calloc(65537, sizeof(size_t));
+    size_t *fill = malloc(65536 * sizeof(size_t));
+    uint16_t *low = malloc((count ? count : 1) * sizeof(uint16_t));
+    if (start == NULL || fill == NULL || low == NULL) {
+        free(start);
+        free(fill);
+        free(low);
+        return out_of_memory();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        start[(addrs[i] >> 16) + 1]++;
+    }
+    for (size_t key = 0; key < 65536; key++) {
+        start[key + 1] += start[key];
+    }
+    memcpy(fill, start, 65536 * sizeof(size_t));
+    for (size_t i = 0; i < count; i++) {
+        low[fill[addrs[i] >> 16]++] = (uint16_t)addrs[i];
+    }
+
+    ConversionResult result = RESULT_OK;
+    for (size_t key = 0; key < 65536; key++) {
+        size_t n = start[key + 1] - start[key];
+        if (n == 0) {
+            continue;
+        }
+        IpSetContainer c;
+        if (!container_from_values(&c, (uint16_t)key, low + start[key], n)) {
+            result = out_of_memory();
+            break;
+        }
+        if (!ipset_push(out, &c)) {
+            free(c.data);
+            result = out_of_memory();
+            break;
+        }
+    }
+
+    free(start);
+    free(fill);
+    free(low);
+    if (result != RESULT_OK) {
+        ipset_free(out);
+    }
+    return result;
+}
+
+/* Set holding every address in the given inclusive [first, last] ranges */
+static ConversionResult ipset_from_ranges(const uint32_t *ranges, size_t count,
+                                          IpSet *out) {
+    ipset_init(out);
+
+    uint64_t **bitmaps = calloc(65536, sizeof(uint64_t *));
+    if (bitmaps == NULL) {
+        return out_of_memory();
+    }
+
+    ConversionResult result = RESULT_OK;
+    for (size_t r = 0; r < count && result == RESULT_OK; r++) {
+        uint32_t first = ranges[2 * r], last = ranges[2 * r + 1];
+        for (uint32_t key = first >> 16; key <= last >> 16; key++) {
+            if (bitmaps[key] == NULL) {
+                bitmaps[key] = calloc(IPSET_BITMAP_WORDS, sizeof(uint64_t));
+                if (bitmaps[key] == NULL) {
+                    result = out_of_memory();
+                    break;
+                }
+            }
+            uint32_t lo = key == first >> 16 ? (first & 0xFFFF) : 0;
+            uint32_t hi = key == last >> 16 ? (last & 0xFFFF) : 0xFFFF;
+            bitmap_set_range(bitmaps[key], lo, hi);
+        }
+    }
+
+    for (uint32_t key = 0; key < 65536; key++) {
+        if (bitmaps[key] == NULL) {
+            continue;
+        }
+        IpSetContainer c = { 0, 0, 0, NULL };
+        if (result != RESULT_OK) {
+            free(bitmaps[key]);
+        } else if (!container_from_bitmap(&c, (uint16_t)key, bitmaps[key]) ||
+                   !ipset_push(out, &c)) {
+            free(c.data);
+            result = out_of_memory();
+        }
+    }
+
+    free(bitmaps);
+    if (result != RESULT_OK) {
+        ipset_free(out);
+    }
+    return result;
+}
+
+/* Growable array of uint32 */
+typedef struct {
+    uint32_t *data;
+    size_t count;
+    size_t capacity;
+} U32Vec;
+
+static int u32vec_push(U32Vec *v, uint32_t value) {
+    if (v->count == v->capacity) {
+        size_t capacity = v->capacity ? v->capacity * 2 : 1024;
+        uint32_t *grown = realloc(v->data, capacity * sizeof(uint32_t));
+        if (grown == NULL) {
+            return 0;
+        }
+        v->data = grown;
+        v->capacity = capacity;
+    }
+    v->data[v->count++] = value;
+    return 1;
+}
+
+/*
+ * Parse "a.b.c.d" or "a.b.c.d/len" into an inclusive range. Host bits
+ * below the prefix length are ignored, as ipset(8) does.
+ */
+static ConversionResult parse_cidr_span(const char *str, size_t len,
+                                        uint32_t *first, uint32_t *last) {
+    const char *slash = memchr(str, '/', len);
+    size_t addr_len = slash ? (size_t)(slash - str) : len;
+
+    uint32_t ip;
+    if (parse_ipv4_span(str, addr_len, &ip) != RESULT_OK) {
+        return RESULT_INVALID_INPUT;
+    }
+
+    unsigned prefix = 32;
+    if (slash != NULL) {
+        size_t digits = len - addr_len - 1;
+        if (digits == 0 || digits > 2) {
+            return RESULT_INVALID_INPUT;
+        }
+        prefix = 0;
+        for (size_t i = 0; i < digits; i++) {
+            char c = slash[1 + i];
+            if (c < '0' || c > '9') {
+                return RESULT_INVALID_INPUT;
+            }
+            prefix = prefix * 10 + (unsigned)(c - '0');
+        }
+        if (prefix > 32) {
+            return RESULT_INVALID_INPUT;
+        }
+    }
+
+    uint32_t host_mask = prefix == 0 ? 0xFFFFFFFFu : FIELD_MASK(32 - prefix);
+    *first = ip & ~host_mask;
+    *last = ip | host_mask;
+    return RESULT_OK;
+}
+
+/* Prefixes longer than this are expanded into single addresses */
+#define CIDR_EXPAND_MAX 256
+
+ConversionResult ipset_load_text(const char *path, IpSet *out) {
+    ipset_init(out);
+
+    MappedFile file;
+    ConversionResult result = map_file_range(path, 0, 0, &file);
+    if (result != RESULT_OK) {
+        return result;
+    }
+
+    U32Vec addrs = { NULL, 0, 0 };
+    U32Vec ranges = { NULL, 0, 0 };     // Pairs of first, last
+    const char *text = (const char *)file.data;
+    size_t pos = 0;
+    uint64_t line = 0;
+
+    while (pos < file.size && result == RESULT_OK) {
+        const char *nl = memchr(text + pos, '\n', file.size - pos);
+        size_t end = nl ? (size_t)(nl - text) : file.size;
+        size_t start = pos;
+        pos = end + 1;
+        line++;
+
+        // Trim surrounding whitespace (including the \r of CRLF files)
+        while (start < end && (text[start] == ' ' || text[start] == '\t')) {
+            start++;
+        }
+        while (end > start && (text[end - 1] == ' ' || text[end - 1] == '\t' ||
+                               text[end - 1] == '\r')) {
+            end--;
+        }
+        if (start == end || text[start] == '#') {
+            continue;
+        }
+
+        uint32_t first, last;
+        if (parse_cidr_span(text + start, end - start, &first, &last) != RESULT_OK) {
+            fprintf(stderr, "Error: %s:%llu: invalid address '%.*s'\n", path,
+                    (unsigned long long)line, (int)(end - start), text + start);
+            result = RESULT_INVALID_INPUT;
+            break;
+        }
+
+        int ok = 1;
+        if ((uint64_t)last - first < CIDR_EXPAND_MAX) {
+            for (uint64_t ip = first; ip <= last && ok; ip++) {
+                ok = u32vec_push(&addrs, (uint32_t)ip);
+            }
+        } else {
+            ok = u32vec_push(&ranges, first) && u32vec_push(&ranges, last);
+        }
+        if (!ok) {
+            result = out_of_memory();
+        }
+    }
+    unmap_file(&file);
+
+    if (result == RESULT_OK) {
+        result = ipset_from_addresses(addrs.data, addrs.count, out);
+    }
+    free(addrs.data);
+
+    if (result == RESULT_OK && ranges.count > 0) {
+        IpSet singles = *out, blocks;
+        result = ipset_from_ranges(ranges.data, ranges.count / 2, &blocks);
+        if (result == RESULT_OK) {
+            result = ipset_union(&singles, &blocks, out);
+            ipset_free(&blocks);
+        } else {
+            ipset_init(out);
+        }
+        ipset_free(&singles);
+    }
+    free(ranges.data);
+    return result;
+}
+
+/* ============================================================================
+ * SET FILES
+ * ============================================================================ */
+
+static uint64_t align8(uint64_t n) {
+    return (n + 7) & ~(uint64_t)7;
+}
+
+static uint64_t serialized_size(const IpSet *set) {
+    uint64_t size = sizeof(IpSetFileHeader) + set->count * sizeof(IpSetFileEntry);
+    for (size_t i = 0; i < set->count; i++) {
+        size += align8(container_bytes(&set->containers[i]));
+    }
+    return size;
+}
+
+ConversionResult ipset_save(const IpSet *set, const char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: Cannot create file '%s'\n", path);
+        perror("fopen");
+        return RESULT_INVALID_INPUT;
+    }
+
+    IpSetFileHeader header;
+    memcpy(header.magic, IPSET_MAGIC, sizeof(header.magic));
+    header.num_containers = (uint32_t)set->count;
+    header.reserved = 0;
+    header.cardinality = ipset_cardinality(set);
+    fwrite(&header, sizeof(header), 1, fp);
+
+    uint64_t offset = sizeof(header) + set->count * sizeof(IpSetFileEntry);
+    for (size_t i = 0; i < set->count; i++) {
+        const IpSetContainer *c = &set->containers[i];
+        IpSetFileEntry entry = { c->key, c->type, c->cardinality, offset };
+        fwrite(&entry, sizeof(entry), 1, fp);
+        offset += align8(container_bytes(c));
+    }
+
+    static const char padding[8] = { 0 };
+    for (size_t i = 0; i < set->count; i++) {
+        const IpSetContainer *c = &set->containers[i];
+        size_t bytes = container_bytes(c);
+        fwrite(c->data, 1, bytes, fp);
+        fwrite(padding, 1, align8(bytes) - bytes, fp);
+    }
+
+    if (ferror(fp) | fclose(fp)) {
+        fprintf(stderr, "Error: Cannot write file '%s'\n", path);
+        return RESULT_FORMAT_ERROR;
+    }
+    return RESULT_OK;
+}
+
+static ConversionResult corrupt_set(const char *path, const char *why, IpSet *set) {
+    fprintf(stderr, "Error: '%s' is not a valid set file (%s)\n", path, why);
+    ipset_free(set);
+    return RESULT_FORMAT_ERROR;
+}
+
+ConversionResult ipset_open(const char *path, IpSet *out) {
+    ipset_init(out);
+
+    ConversionResult result = map_file_range(path, 0, 0, &out->file);
+    if (result != RESULT_OK) {
+        return result;
+    }
+
+    const uint8_t *base = out->file.data;
+    uint64_t size = out->file.size;
+    IpSetFileHeader header;
+    if (size < sizeof(header)) {
+        return corrupt_set(path, "truncated header", out);
+    }
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, IPSET_MAGIC, sizeof(header.magic)) != 0) {
+        return corrupt_set(path, "bad magic", out);
+    }
+    if (header.num_containers > 65536 ||
+        size < sizeof(header) + (uint64_t)header.num_containers * sizeof(IpSetFileEntry)) {
+        return corrupt_set(path, "truncated directory", out);
+    }
+
+    out->containers = malloc((header.num_containers ? header.num_containers : 1) *
+                             sizeof(IpSetContainer));
+    if (out->containers == NULL) {
+        ipset_free(out);
+        return out_of_memory();
+    }
+    out->capacity = header.num_containers;
+
+    // Only the directory is read; container data stays in the page cache
+    uint64_t data_start = sizeof(header) + (uint64_t)header.num_containers * sizeof(IpSetFileEntry);
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < header.num_containers; i++) {
+        IpSetFileEntry entry;
+        memcpy(&entry, base + sizeof(header) + i * sizeof(entry), sizeof(entry));
+
+        IpSetContainer *c = &out->containers[i];
+        c->key = entry.key;
+        c->type = entry.type;
+        c->cardinality = entry.cardinality;
+        if (i > 0 && entry.key <= out->containers[i - 1].key) {
+            return corrupt_set(path, "keys out of order", out);
+        }
+        if (!((entry.type == IPSET_ARRAY && entry.cardinality >= 1 &&
+               entry.cardinality <= IPSET_ARRAY_MAX) ||
+              (entry.type == IPSET_BITMAP && entry.cardinality > IPSET_ARRAY_MAX &&
+               entry.cardinality <= 65536))) {
+            return corrupt_set(path, "bad container", out);
+        }
+        if (entry.data_offset % 8 != 0 || entry.data_offset < data_start ||
+            entry.data_offset > size || size - entry.data_offset < container_bytes(c)) {
+            return corrupt_set(path, "container out of bounds", out);
+        }
+        c->data = (void *)(base + entry.data_offset);
+        out->count++;
+        total += entry.cardinality;
+    }
+    if (total != header.cardinality) {
+        return corrupt_set(path, "cardinality mismatch", out);
+    }
+    return RESULT_OK;
+}
+
+ConversionResult ipset_load(const char *path, IpSet *out) {
+    char magic[sizeof(IPSET_MAGIC) - 1];
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        ipset_init(out);
+        fprintf(stderr, "Error: Cannot open file '%s'\n", path);
+        perror("fopen");
+        return RESULT_INVALID_INPUT;
+    }
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+
+    if (n == sizeof(magic) && memcmp(magic, IPSET_MAGIC, sizeof(magic)) == 0) {
+        return ipset_open(path, out);
+    }
+    return ipset_load_text(path, out);
+}
+
+/* ============================================================================
+ * OUTPUT AND COMMANDS
+ * ============================================================================ */
+
+/* "a.b.c.d\n" for a host-order address; returns characters written */
+static size_t format_ipv4_line(uint32_t ip, char *dst) {
+    char *p = dst;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        unsigned octet = (ip >> shift) & 0xFF;
+        if (octet >= 100) {
+            *p++ = (char)('0' + octet / 100);
+        }
+        if (octet >= 10) {
+            *p++ = (char)('0' + octet / 10 % 10);
+        }
+        *p++ = (char)('0' + octet % 10);
+        *p++ = shift ? '.' : '\n';
+    }
+    return (size_t)(p - dst);
+}
+
+ConversionResult ipset_dump(const IpSet *set, int out_fd) {
+    OutBuf *out = outbuf_open(out_fd);
+    if (out == NULL) {
+        return out_of_memory();
+    }
+
+    for (size_t i = 0; i < set->count; i++) {
+        const IpSetContainer *c = &set->containers[i];
+        uint32_t high = (uint32_t)c->key << 16;
+        if (c->type == IPSET_ARRAY) {
+            const uint16_t *values = c->data;
+            for (uint32_t k = 0; k < c->cardinality; k++) {
+                char *dst = outbuf_reserve(out, IP_STR_MAX);
+                outbuf_commit(out, format_ipv4_line(high | values[k], dst));
+            }
+        } else {
+            const uint64_t *bits = c->data;
+            for (uint32_t w = 0; w < IPSET_BITMAP_WORDS; w++) {
+                for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+                    uint32_t low = w * 64 + (uint32_t)__builtin_ctzll(word);
+                    char *dst = outbuf_reserve(out, IP_STR_MAX);
+                    outbuf_commit(out, format_ipv4_line(high | low, dst));
+                }
+            }
+        }
+    }
+    return outbuf_close(out);
+}
+
+static void print_set_summary(const IpSet *set) {
+    size_t bitmaps = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        bitmaps += set->containers[i].type == IPSET_BITMAP;
+    }
+    uint64_t card = ipset_cardinality(set);
+    uint64_t bytes = serialized_size(set);
+
+    printf("Addresses:  %llu\n", (unsigned long long)card);
+    printf("Containers: %zu (%zu arrays, %zu bitmaps)\n",
+           set->count, set->count - bitmaps, bitmaps);
+    printf("File size:  %llu bytes", (unsigned long long)bytes);
+    if (card > 0) {
+        printf(" (%.2f bytes/address)", (double)bytes / (double)card);
+    }
+    printf("\n");
+}
+
+/* Save `set` to `path`, or print its addresses if `path` is "-" */
+static int write_result(const IpSet *set, const char *path) {
+    if (strcmp(path, "-") == 0) {
+        return ipset_dump(set, STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+    }
+    if (ipset_save(set, path) != RESULT_OK) {
+        return 1;
+    }
+    printf("Wrote %s\n", path);
+    print_set_summary(set);
+    return 0;
+}
+
+static void print_ipset_usage(void) {
+    printf("Usage: converter --ipset <command> ...\n\n");
+    printf("  build <list.txt> <out.ips>          Text list (addresses, CIDRs) to set file\n");
+    printf("  info <set>                          Cardinality and storage summary\n");
+    printf("  count <set>                         Number of addresses\n");
+    printf("  contains <set> [ip...]              Membership (no ips: filter stdin)\n");
+    printf("  union|intersect|diff <a> <b> <out>  Set algebra; out '-' prints addresses\n");
+    printf("  dump <set>                          Print addresses in ascending order\n\n");
+    printf("<set> is a set file or a text list.\n");
+}
+
+/* Print the stdin lines whose address is in the set */
+static int filter_stdin(const IpSet *set) {
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    OutBuf *out = outbuf_open(STDOUT_FILENO);
+    if (out == NULL) {
+        return 1;
+    }
+
+    while ((len = getline(&line, &cap, stdin)) > 0) {
+        size_t n = (size_t)len;
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) {
+            n--;
+        }
+        uint32_t ip;
+        if (parse_ipv4_span(line, n, &ip) == RESULT_OK && ipset_contains(set, ip)) {
+            line[n] = '\n';
+            outbuf_write(out, line, n + 1);
+        }
+    }
+    free(line);
+    return outbuf_close(out) == RESULT_OK ? 0 : 1;
+}
+
+int run_ipset(int argc, char *argv[]) {
+    if (argc < 2) {
+        print_ipset_usage();
+        return 1;
+    }
+    const char *command = argv[0];
+
+    if (strcmp(command, "build") == 0 && argc == 3) {
+        IpSet set;
+        if (ipset_load_text(argv[1], &set) != RESULT_OK) {
+            return 1;
+        }
+        int status = write_result(&set, argv[2]);
+        ipset_free(&set);
+        return status;
+    }
+
+    int is_binary_op = strcmp(command, "union") == 0 ||
+                       strcmp(command, "intersect") == 0 ||
+                       strcmp(command, "diff") == 0;
+    if (is_binary_op && argc == 4) {
+        IpSet a, b, result;
+        if (ipset_load(argv[1], &a) != RESULT_OK) {
+            return 1;
+        }
+        if (ipset_load(argv[2], &b) != RESULT_OK) {
+            ipset_free(&a);
+            return 1;
+        }
+
+        ConversionResult status;
+        if (strcmp(command, "union") == 0) {
+            status = ipset_union(&a, &b, &result);
+        } else if (strcmp(command, "intersect") == 0) {
+            status = ipset_intersect(&a, &b, &result);
+        } else {
+            status = ipset_difference(&a, &b, &result);
+        }
+        ipset_free(&a);
+        ipset_free(&b);
+        if (status != RESULT_OK) {
+            return 1;
+        }
+        int exit_code = write_result(&result, argv[3]);
+        ipset_free(&result);
+        return exit_code;
+    }
+
+    int is_query = strcmp(command, "info") == 0 || strcmp(command, "count") == 0 ||
+                   strcmp(command, "dump") == 0 || strcmp(command, "contains") == 0;
+    if (!is_query || (argc != 2 && strcmp(command, "contains") != 0)) {
+        print_ipset_usage();
+        return 1;
+    }
+
+    IpSet set;
+    if (ipset_load(argv[1], &set) != RESULT_OK) {
+        return 1;
+    }
+
+    int exit_code = 0;
+    if (strcmp(command, "info") == 0) {
+        print_set_summary(&set);
+    } else if (strcmp(command, "count") == 0) {
+        printf("%llu\n", (unsigned long long)ipset_cardinality(&set));
+    } else if (strcmp(command, "dump") == 0) {
+        exit_code = ipset_dump(&set, STDOUT_FILENO) == RESULT_OK ? 0 : 1;
+    } else if (argc == 2) {
+        exit_code = filter_stdin(&set);
+    } else {
+        // Like grep: exit status 1 if any address is missing
+        for (int i = 2; i < argc; i++) {
+            uint32_t ip;
+            if (parse_ipv4_span(argv[i], strlen(argv[i]), &ip) != RESULT_OK) {
+                printf("Invalid IP address: %s\n", argv[i]);
+                exit_code = 1;
+            } else if (ipset_contains(&set, ip)) {
+                printf("%s: yes\n", argv[i]);
+            } else {
+                printf("%s: no\n", argv[i]);
+                exit_code = 1;
+            }
+        }
+    }
+
+    ipset_free(&set);
+    return exit_code;
+}
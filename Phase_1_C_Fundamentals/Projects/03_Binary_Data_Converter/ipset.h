@@ -0,0 +1,104 @@
+/*
+ * Binary Data Converter - IPv4 Address Sets
+ *
+ * Roaring bitmaps over the 32-bit address space. An address is split
+ * into its high 16 bits (the container key, i.e. its /16) and low 16
+ * bits (stored in that container). Sparse containers hold a sorted
+ * array of low halves; containers with more than IPSET_ARRAY_MAX
+ * addresses switch to a 65536-bit bitmap. A set of 20 million addresses
+ * typically needs 2-4 bytes per address instead of ~14 as text.
+ *
+ * File format (native little-endian, every offset from the start of
+ * the file, all data 8-byte aligned so it can be used in place after
+ * mmap):
+ *
+ *   header     char magic[8] "IPV4SET1", uint32 num_containers,
+ *              uint32 reserved (0), uint64 cardinality
+ *   directory  num_containers entries, sorted by key:
+ *              uint16 key, uint16 type, uint32 cardinality,
+ *              uint64 data_offset
+ *   data       arrays: cardinality uint16 values, padded to 8 bytes
+ *              bitmaps: 1024 uint64 words, bit i = low half i
+ *
+ * Opening a set file only checks the directory; container data is used
+ * straight from the mapping.
+ */
+
+#ifndef IPSET_H
+#define IPSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+#include "file_io.h"
+
+#define IPSET_MAGIC "IPV4SET1"
+
+/* Containers with more addresses than this are stored as bitmaps */
+#define IPSET_ARRAY_MAX 4096
+#define IPSET_BITMAP_WORDS 1024
+
+typedef enum {
+    IPSET_ARRAY = 1,
+    IPSET_BITMAP = 2
+} IpSetContainerType;
+
+/* All addresses of a set that share the same high 16 bits */
+typedef struct {
+    uint16_t key;
+    uint16_t type;          // IpSetContainerType
+    uint32_t cardinality;   // 1..65536; empty containers are never kept
+    void *data;             // uint16_t[cardinality] or uint64_t[1024]
+} IpSetContainer;
+
+typedef struct {
+    IpSetContainer *containers;     // Sorted by key
+    size_t count;
+    size_t capacity;
+    MappedFile file;                // Backing file when opened with ipset_open
+} IpSet;
+
+void ipset_init(IpSet *set);
+void ipset_free(IpSet *set);
+
+/*
+ * Build a set from host-order addresses (duplicates allowed, any order).
+ * The address array is left unchanged.
+ */
+ConversionResult ipset_from_addresses(const uint32_t *addrs, size_t count,
+                                      IpSet *out);
+
+/*
+ * Load a text list: one "a.b.c.d" or "a.b.c.d/len" per line; blank
+ * lines and lines starting with '#' are skipped. Errors name the line.
+ */
+ConversionResult ipset_load_text(const char *path, IpSet *out);
+
+/* Open a set file with mmap; the set stays valid until ipset_free */
+ConversionResult ipset_open(const char *path, IpSet *out);
+
+/* Open a set file, or load a text list if `path` is not one */
+ConversionResult ipset_load(const char *path, IpSet *out);
+
+ConversionResult ipset_save(const IpSet *set, const char *path);
+
+/* Queries; `ip` is in host byte order */
+int ipset_contains(const IpSet *set, uint32_t ip);
+uint64_t ipset_cardinality(const IpSet *set);
+
+/* Set algebra; `out` is initialized by the call */
+ConversionResult ipset_union(const IpSet *a, const IpSet *b, IpSet *out);
+ConversionResult ipset_intersect(const IpSet *a, const IpSet *b, IpSet *out);
+ConversionResult ipset_difference(const IpSet *a, const IpSet *b, IpSet *out);
+
+/* Write every address, one per line in ascending order */
+ConversionResult ipset_dump(const IpSet *set, int out_fd);
+
+/*
+ * `converter --ipset <command> ...`; argv[0] is the command name.
+ * Returns a process exit code.
+ */
+int run_ipset(int argc, char *argv[]);
+
+#endif /* IPSET_H */
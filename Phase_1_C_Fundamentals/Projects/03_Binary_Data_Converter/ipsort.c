@@ -0,0 +1,656 @@
+/*
+ * Binary Data Converter - IP List Sorting
+ *
+ * See ipsort.h. The radix sort uses 11-bit digits (3 passes for IPv4,
+ * 12 for IPv6); each pass is
+ *
+ *   count    every thread histograms the digit over its slice of the keys
+ *   offsets  bucket-major, thread-minor prefix sums, so thread t writes
+ *            its keys of bucket b right after those of threads < t
+ *   scatter  every thread moves its slice to the other buffer
+ *
+ * which keeps the sort stable, as LSD needs. A pass whose digit is the
+ * same for every key (the top bits of a log from one network, most of
+ * an IPv6 prefix) is skipped after the count.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ipsort.h"
+#include "file_io.h"
+
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1u << RADIX_BITS)
+#define RADIX_MASK (RADIX_BUCKETS - 1)
+
+#define MAX_SORT_THREADS 64
+
+/* Keys per thread below which more threads do not pay off */
+#define MIN_KEYS_PER_THREAD 65536
+
+/* stdin is parsed in pieces of about this size, each ending at a line end */
+#define STDIN_PIECE (16u << 20)
+
+/* ============================================================================
+ * IPV6 TEXT
+ * ============================================================================ */
+
+static int hex_digit(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+ConversionResult parse_ipv6_span(const char *str, size_t len, Ipv6Address *addr) {
+    uint16_t groups[8];
+    int count = 0;
+    int gap = -1;       // Index where the "::" run goes
+    size_t pos = 0;
+
+    if (len >= 2 && str[0] == ':' && str[1] == ':') {
+        gap = 0;
+        pos = 2;
+    }
+
+    while (pos < len) {
+        size_t start = pos;
+        unsigned value = 0;
+        int digits = 0;
+        int d;
+        while (pos < len && digits < 5 && (d = hex_digit((unsigned char)str[pos])) >= 0) {
+            value = value << 4 | (unsigned)d;
+            pos++;
+            digits++;
+        }
+
+        // Dotted IPv4 in place of the last two groups
+        if (pos < len && str[pos] == '.') {
+            uint32_t ipv4;
+            if (count > 6 || parse_ipv4_span(str + start, len - start, &ipv4) != RESULT_OK) {
+                return RESULT_INVALID_INPUT;
+            }
+            groups[count++] = (uint16_t)(ipv4 >> 16);
+            groups[count++] = (uint16_t)ipv4;
+            pos = len;
+            break;
+        }
+        if (digits == 0 || digits > 4 || count == 8) {
+            return RESULT_INVALID_INPUT;
+        }
+        groups[count++] = (uint16_t)value;
+
+        if (pos == len) {
+            break;
+        }
+        if (str[pos] != ':' || pos + 1 == len) {
+            return RESULT_INVALID_INPUT;  // Bad character or a trailing single ':'
+        }
+        pos++;
+        if (str[pos] == ':') {
+            if (gap >= 0) {
+                return RESULT_INVALID_INPUT;  // Only one "::" allowed
+            }
+            gap = count;
+            pos++;
+        }
+    }
+
+    if (gap < 0 ? count != 8 : count > 7) {
+        return RESULT_INVALID_INPUT;
+    }
+
+    // Expand the "::" run to zero groups
+    uint16_t full[8] = { 0 };
+    int tail = gap < 0 ? 0 : count - gap;
+    memcpy(full, groups, (size_t)(count - tail) * sizeof(uint16_t));
+    memcpy(full + 8 - tail, groups + count - tail, (size_t)tail * sizeof(uint16_t));
+
+    addr->hi = (uint64_t)full[0] << 48 | (uint64_t)full[1] << 32 |
+               (uint64_t)full[2] << 16 | full[3];
+    addr->lo = (uint64_t)full[4] << 48 | (uint64_t)full[5] << 32 |
+               (uint64_t)full[6] << 16 | full[7];
+    return RESULT_OK;
+}
+
+size_t format_ipv6(const Ipv6Address *addr, char *buffer) {
+    static const char HEX[] = "0123456789abcdef";
+
+    // IPv4-mapped addresses keep the dotted tail (RFC 5952 section 5)
+    if (addr->hi == 0 && (addr->lo >> 32) == 0xFFFF) {
+        char ipv4[IP_STR_MAX];
+        format_ip_address(htonl((uint32_t)addr->lo), ipv4, sizeof(ipv4));
+        return (size_t)snprintf(buffer, IPV6_STR_MAX, "::ffff:%s", ipv4);
+    }
+
+    uint16_t groups[8];
+    for (int i = 0; i < 4; i++) {
+        groups[i] = (uint16_t)(addr->hi >> (48 - 16 * i));
+        groups[4 + i] = (uint16_t)(addr->lo >> (48 - 16 * i));
+    }
+
+    // Longest run of two or more zero groups, leftmost on a tie
+    int best = -1, best_len = 1;
+    for (int i = 0; i < 8;) {
+        int j = i;
+        while (j < 8 && groups[j] == 0) {
+            j++;
+        }
+        if (j - i > best_len) {
+            best = i;
+            best_len = j - i;
+        }
+        i = j > i ? j : i + 1;
+    }
+
+    size_t len = 0;
+    for (int i = 0; i < 8; i++) {
+        if (i == best) {
+            buffer[len++] = ':';
+            if (i == 0) {
+                buffer[len++] = ':';
+            }
+            i += best_len - 1;
+            continue;
+        }
+        unsigned g = groups[i];
+        int shift = g >= 0x1000 ? 12 : g >= 0x100 ? 8 : g >= 0x10 ? 4 : 0;
+        for (; shift >= 0; shift -= 4) {
+            buffer[len++] = HEX[(g >> shift) & 0xF];
+        }
+        if (i < 7) {
+            buffer[len++] = ':';
+        }
+    }
+    return len;
+}
+
+/* ============================================================================
+ * PARALLEL RADIX SORT
+ * ============================================================================ */
+
+typedef struct {
+    const void *src;
+    void *dst;
+    size_t begin;
+    size_t end;
+    unsigned shift;
+    int wide;           // Ipv6Address keys instead of uint32_t
+    size_t *hist;       // RADIX_BUCKETS counts, then output positions
+} RadixTask;
+
+static inline unsigned ipv6_digit(const Ipv6Address *key, unsigned shift) {
+    uint64_t bits;
+    if (shift >= 64) {
+        bits = key->hi >> (shift - 64);
+    } else {
+        bits = key->lo >> shift;
+        if (shift > 64 - RADIX_BITS) {
+            bits |= key->hi << (64 - shift);  // Digit straddles the halves
+        }
+    }
+    return (unsigned)bits & RADIX_MASK;
+}
+
+static void *count_worker(void *arg) {
+    RadixTask *t = arg;
+    size_t *hist = t->hist;
+    memset(hist, 0, RADIX_BUCKETS * sizeof(size_t));
+    if (t->wide) {
+        const Ipv6Address *keys = t->src;
+        for (size_t i = t->begin; i < t->end; i++) {
+            hist[ipv6_digit(&keys[i], t->shift)]++;
+        }
+    } else {
+        const uint32_t *keys = t->src;
+        for (size_t i = t->begin; i < t->end; i++) {
+            hist[(keys[i] >> t->shift) & RADIX_MASK]++;
+        }
+    }
+    return NULL;
+}
+
+static void *scatter_worker(void *arg) {
+    RadixTask *t = arg;
+    size_t *next = t->hist;
+    if (t->wide) {
+        const Ipv6Address *keys = t->src;
+        Ipv6Address *dst = t->dst;
+        for (size_t i = t->begin; i < t->end; i++) {
+            dst[next[ipv6_digit(&keys[i], t->shift)]++] = keys[i];
+        }
+    } else {
+        const uint32_t *keys = t->src;
+        uint32_t *dst = t->dst;
+        for (size_t i = t->begin; i < t->end; i++) {
+            dst[next[(keys[i] >> t->shift) & RADIX_MASK]++] = keys[i];
+        }
+    }
+    return NULL;
+}
+
+/* Run fn on every task, one per thread; the calling thread takes task 0 */
+static void run_parallel(void *tasks, size_t task_size, int count, void *(*fn)(void *)) {
+    pthread_t threads[MAX_SORT_THREADS];
+    int started[MAX_SORT_THREADS] = { 0 };
+    for (int i = 1; i < count; i++) {
+        void *task = (char *)tasks + (size_t)i * task_size;
+        started[i] = pthread_create(&threads[i], NULL, fn, task) == 0;
+        if (!started[i]) {
+            fn(task);  // No thread available: do the work here
+        }
+    }
+    fn(tasks);
+    for (int i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+static int clamp_threads(int threads, size_t n) {
+    size_t useful = n / MIN_KEYS_PER_THREAD;
+    if (threads > MAX_SORT_THREADS) {
+        threads = MAX_SORT_THREADS;
+    }
+    if ((size_t)threads > useful) {
+        threads = (int)useful;
+    }
+    return threads < 1 ? 1 : threads;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_ipv6(const void *a, const void *b) {
+    const Ipv6Address *x = a, *y = b;
+    if (x->hi != y->hi) {
+        return x->hi < y->hi ? -1 : 1;
+    }
+    return (x->lo > y->lo) - (x->lo < y->lo);
+}
+
+static void radix_sort(void *keys, void *scratch, size_t n, int threads, int wide) {
+    size_t key_size = wide ? sizeof(Ipv6Address) : sizeof(uint32_t);
+    unsigned key_bits = wide ? 128 : 32;
+    threads = clamp_threads(threads, n);
+
+    RadixTask tasks[MAX_SORT_THREADS];
+    size_t *hist = malloc((size_t)threads * RADIX_BUCKETS * sizeof(size_t));
+    if (hist == NULL) {
+        qsort(keys, n, key_size, wide ? compare_ipv6 : compare_u32);
+        return;
+    }
+
+    void *src = keys, *dst = scratch;
+    for (unsigned shift = 0; shift < key_bits; shift += RADIX_BITS) {
+        for (int t = 0; t < threads; t++) {
+            tasks[t].src = src;
+            tasks[t].dst = dst;
+            tasks[t].begin = n * (size_t)t / (size_t)threads;
+            tasks[t].end = n * (size_t)(t + 1) / (size_t)threads;
+            tasks[t].shift = shift;
+            tasks[t].wide = wide;
+            tasks[t].hist = hist + (size_t)t * RADIX_BUCKETS;
+        }
+        run_parallel(tasks, sizeof(RadixTask), threads, count_worker);
+
+        // Output positions; a digit shared by every key needs no pass
+        size_t position = 0;
+        int trivial = 0;
+        for (unsigned b = 0; b < RADIX_BUCKETS && !trivial; b++) {
+            size_t bucket_start = position;
+            for (int t = 0; t < threads; t++) {
+                size_t count = tasks[t].hist[b];
+                tasks[t].hist[b] = position;
+                position += count;
+            }
+            trivial = position - bucket_start == n;
+        }
+        if (trivial) {
+            continue;
+        }
+
+        run_parallel(tasks, sizeof(RadixTask), threads, scatter_worker);
+        void *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != keys) {
+        memcpy(keys, src, n * key_size);
+    }
+    free(hist);
+}
+
+void radix_sort_u32(uint32_t *keys, uint32_t *scratch, size_t n, int threads) {
+    radix_sort(keys, scratch, n, threads, 0);
+}
+
+void radix_sort_ipv6(Ipv6Address *keys, Ipv6Address *scratch, size_t n, int threads) {
+    radix_sort(keys, scratch, n, threads, 1);
+}
+
+/* ============================================================================
+ * PARALLEL PARSING
+ * ============================================================================ */
+
+typedef struct {
+    const char *text;
+    size_t begin;           // Slice of the text; both on line starts
+    size_t end;
+    int column;
+    uint32_t *v4;
+    size_t n4, cap4;
+    Ipv6Address *v6;
+    size_t n6, cap6;
+    uint64_t lines;
+    uint64_t invalid;
+    uint64_t bad_line[MAX_REPORTED_LINES];     // Line numbers within the slice
+    size_t bad_offset[MAX_REPORTED_LINES];
+    int out_of_memory;
+} ParseTask;
+
+static int grow(void **array, size_t *capacity, size_t item_size) {
+    size_t new_capacity = *capacity ? *capacity * 2 : 4096;
+    void *bigger = realloc(*array, new_capacity * item_size);
+    if (bigger == NULL) {
+        return 0;
+    }
+    *array = bigger;
+    *capacity = new_capacity;
+    return 1;
+}
+
+static void parse_line(ParseTask *t, size_t offset, size_t len) {
+    const char *line = t->text + offset;
+    t->lines++;
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+
+    size_t first = 0;
+    while (first < len && (line[first] == ' ' || line[first] == '\t')) {
+        first++;
+    }
+    if (first == len) {
+        return;  // Blank line
+    }
+
+    size_t start, end;
+    find_column(line, len, t->column, &start, &end);
+
+    uint32_t ipv4;
+    Ipv6Address ipv6;
+    if (start < end && parse_ipv4_span(line + start, end - start, &ipv4) == RESULT_OK) {
+        if (t->n4 == t->cap4 && !grow((void **)&t->v4, &t->cap4, sizeof(uint32_t))) {
+            t->out_of_memory = 1;
+            return;
+        }
+        t->v4[t->n4++] = ipv4;
+    } else if (start < end && parse_ipv6_span(line + start, end - start, &ipv6) == RESULT_OK) {
+        if (t->n6 == t->cap6 && !grow((void **)&t->v6, &t->cap6, sizeof(Ipv6Address))) {
+            t->out_of_memory = 1;
+            return;
+        }
+        t->v6[t->n6++] = ipv6;
+    } else {
+        if (t->invalid < MAX_REPORTED_LINES) {
+            t->bad_line[t->invalid] = t->lines;
+            t->bad_offset[t->invalid] = offset;
+        }
+        t->invalid++;
+    }
+}
+
+static void *parse_worker(void *arg) {
+    ParseTask *t = arg;
+    size_t pos = t->begin;
+    while (pos < t->end && !t->out_of_memory) {
+        const char *nl = memchr(t->text + pos, '\n', t->end - pos);
+        size_t end = nl ? (size_t)(nl - t->text) : t->end;
+        parse_line(t, pos, end - pos);
+        pos = end + 1;
+    }
+    return NULL;
+}
+
+/**
+ * Parse text[0..size) (whole lines) on up to `threads` tasks, adding the
+ * keys to the tasks' arrays. Bad lines are reported here, while the text
+ * is still there; line numbers continue from *line_base.
+ */
+static void parse_piece(ParseTask *tasks, int threads, const char *text, size_t size,
+                        int column, uint64_t *line_base, uint64_t *invalid) {
+    if (size < (size_t)threads * MIN_KEYS_PER_THREAD) {
+        threads = 1;
+    }
+
+    // Slices start after a newline
+    size_t begin = 0;
+    for (int t = 0; t < threads; t++) {
+        size_t end = size;
+        if (t + 1 < threads) {
+            end = size * (size_t)(t + 1) / (size_t)threads;
+            if (end < begin) {
+                end = begin;
+            }
+            const char *nl = memchr(text + end, '\n', size - end);
+            end = nl ? (size_t)(nl - text) + 1 : size;
+        }
+        tasks[t].text = text;
+        tasks[t].begin = begin;
+        tasks[t].end = end;
+        tasks[t].column = column;
+        tasks[t].lines = 0;
+        tasks[t].invalid = 0;
+        begin = end;
+    }
+    run_parallel(tasks, sizeof(ParseTask), threads, parse_worker);
+
+    for (int t = 0; t < threads; t++) {
+        for (uint64_t k = 0; k < tasks[t].invalid && *invalid + k < MAX_REPORTED_LINES; k++) {
+            const char *line = text + tasks[t].bad_offset[k];
+            const char *nl = memchr(line, '\n', (size_t)(text + size - line));
+            int len = (int)((nl ? nl : text + size) - line);
+            fprintf(stderr, "Line %llu: no IP address in field %d: %.*s\n",
+                    (unsigned long long)(*line_base + tasks[t].bad_line[k]), column, len, line);
+        }
+        *invalid += tasks[t].invalid;
+        *line_base += tasks[t].lines;
+    }
+}
+
+/**
+ * Parse stdin a piece at a time, so memory use does not grow with the
+ * input; only the keys are kept. A line longer than the buffer grows it.
+ */
+static ConversionResult parse_stdin(ParseTask *tasks, int threads, int column,
+                                    uint64_t *line_base, uint64_t *invalid) {
+    size_t capacity = STDIN_PIECE, used = 0;
+    char *buffer = malloc(capacity);
+    if (buffer == NULL) {
+        return RESULT_OVERFLOW;
+    }
+
+    for (;;) {
+        ssize_t n = read(STDIN_FILENO, buffer + used, capacity - used);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n > 0) {
+            used += (size_t)n;
+            if (used < capacity) {
+                continue;
+            }
+        }
+
+        // Full buffer: parse up to the last newline. End of input: all of it
+        size_t end = used;
+        if (n > 0) {
+            while (end > 0 && buffer[end - 1] != '\n') {
+                end--;
+            }
+            if (end == 0) {
+                char *bigger = realloc(buffer, capacity * 2);
+                if (bigger == NULL) {
+                    free(buffer);
+                    return RESULT_OVERFLOW;
+                }
+                buffer = bigger;
+                capacity *= 2;
+                continue;
+            }
+        }
+        parse_piece(tasks, threads, buffer, end, column, line_base, invalid);
+        memmove(buffer, buffer + end, used - end);
+        used -= end;
+        if (n <= 0) {
+            break;
+        }
+    }
+    free(buffer);
+    return RESULT_OK;
+}
+
+/* ============================================================================
+ * SORT AND COUNT
+ * ============================================================================ */
+
+/* "%7llu " as uniq -c prints it; returns characters written */
+static size_t format_count(uint64_t count, char *dst) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + count % 10);
+        count /= 10;
+    } while (count != 0);
+
+    size_t len = 0;
+    for (size_t pad = n; pad < 7; pad++) {
+        dst[len++] = ' ';
+    }
+    while (n > 0) {
+        dst[len++] = digits[--n];
+    }
+    dst[len++] = ' ';
+    return len;
+}
+
+static void write_counts(OutBuf *out, const uint32_t *v4, size_t n4,
+                         const Ipv6Address *v6, size_t n6) {
+    for (size_t i = 0; i < n4;) {
+        size_t j = i + 1;
+        while (j < n4 && v4[j] == v4[i]) {
+            j++;
+        }
+        char *dst = outbuf_reserve(out, 21 + IP_STR_MAX + 1);
+        size_t len = format_count(j - i, dst);
+        format_ip_address(htonl(v4[i]), dst + len, IP_STR_MAX);
+        len += strlen(dst + len);
+        dst[len++] = '\n';
+        outbuf_commit(out, len);
+        i = j;
+    }
+    for (size_t i = 0; i < n6;) {
+        size_t j = i + 1;
+        while (j < n6 && v6[j].hi == v6[i].hi && v6[j].lo == v6[i].lo) {
+            j++;
+        }
+        char *dst = outbuf_reserve(out, 21 + IPV6_STR_MAX + 1);
+        size_t len = format_count(j - i, dst);
+        len += format_ipv6(&v6[i], dst + len);
+        dst[len++] = '\n';
+        outbuf_commit(out, len);
+        i = j;
+    }
+}
+
+ConversionResult ip_sort_count(const char *path, int column, int threads, int out_fd) {
+    int sort_threads = threads;
+    if (threads > MAX_SORT_THREADS) {
+        threads = MAX_SORT_THREADS;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    ParseTask tasks[MAX_SORT_THREADS];
+    memset(tasks, 0, sizeof(ParseTask) * (size_t)threads);
+
+    // Parse into per-task key arrays: a file in one piece, stdin in many
+    ConversionResult result = RESULT_OK;
+    uint64_t invalid = 0, line_base = 0;
+    if (path != NULL) {
+        MappedFile file = { 0 };
+        if (map_file_range(path, 0, 0, &file) != RESULT_OK) {
+            return RESULT_INVALID_INPUT;
+        }
+        parse_piece(tasks, threads, (const char *)file.data, file.size, column,
+                    &line_base, &invalid);
+        unmap_file(&file);
+    } else if (parse_stdin(tasks, threads, column, &line_base, &invalid) != RESULT_OK) {
+        fprintf(stderr, "Error: Out of memory reading stdin\n");
+        result = RESULT_OVERFLOW;
+    }
+
+    size_t n4 = 0, n6 = 0;
+    for (int t = 0; t < threads; t++) {
+        n4 += tasks[t].n4;
+        n6 += tasks[t].n6;
+        if (tasks[t].out_of_memory) {
+            result = RESULT_OVERFLOW;
+        }
+    }
+
+    // Gather the per-slice keys, with room for the radix scratch buffers
+    uint32_t *v4 = result == RESULT_OK ? malloc((n4 ? n4 : 1) * 2 * sizeof(uint32_t)) : NULL;
+    Ipv6Address *v6 = result == RESULT_OK ? malloc((n6 ? n6 : 1) * 2 * sizeof(Ipv6Address)) : NULL;
+    if (v4 == NULL || v6 == NULL) {
+        fprintf(stderr, "Error: Out of memory for %zu addresses\n", n4 + n6);
+        result = RESULT_OVERFLOW;
+    } else {
+        size_t k4 = 0, k6 = 0;
+        for (int t = 0; t < threads; t++) {
+            memcpy(v4 + k4, tasks[t].v4, tasks[t].n4 * sizeof(uint32_t));
+            memcpy(v6 + k6, tasks[t].v6, tasks[t].n6 * sizeof(Ipv6Address));
+            k4 += tasks[t].n4;
+            k6 += tasks[t].n6;
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        free(tasks[t].v4);
+        free(tasks[t].v6);
+    }
+
+    if (result == RESULT_OK) {
+        radix_sort_u32(v4, v4 + n4, n4, sort_threads);
+        radix_sort_ipv6(v6, v6 + n6, n6, sort_threads);
+
+        OutBuf *out = outbuf_open(out_fd);
+        if (out == NULL) {
+            result = RESULT_OVERFLOW;
+        } else {
+            write_counts(out, v4, n4, v6, n6);
+            result = outbuf_close(out);
+        }
+    }
+    free(v4);
+    free(v6);
+
+    if (invalid > 0) {
+        fprintf(stderr, "%llu line(s) without an IP address skipped\n",
+                (unsigned long long)invalid);
+        if (result == RESULT_OK) {
+            result = RESULT_INVALID_INPUT;
+        }
+    }
+    return result;
+}
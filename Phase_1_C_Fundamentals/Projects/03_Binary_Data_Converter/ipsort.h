@@ -0,0 +1,59 @@
+/*
+ * Binary Data Converter - IP List Sorting
+ *
+ * `sort | uniq -c` for IP address logs, done on integers instead of
+ * text. Lines are parsed in parallel (IPv4 with parse_ipv4_span, IPv6
+ * with parse_ipv6_span below) into 32-bit and 128-bit keys, the keys are
+ * sorted with a parallel LSD radix sort, and equal neighbours are
+ * counted in one final pass. IPv4 addresses are listed before IPv6.
+ *
+ * Files are mapped and stdin is parsed 16 MB at a time, so memory goes
+ * on the keys: 4 bytes per IPv4 line and 16 per IPv6 line. The peak is
+ * about four times that, when the parsing threads' key arrays (grown by
+ * doubling, so up to twice their contents) are gathered into one array
+ * with room for the radix scratch buffer.
+ */
+
+#ifndef IPSORT_H
+#define IPSORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+
+/* "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255" plus terminator */
+#define IPV6_STR_MAX 46
+
+/* An IPv6 address as a 128-bit number (hi = first 8 bytes on the wire) */
+typedef struct {
+    uint64_t hi;
+    uint64_t lo;
+} Ipv6Address;
+
+/*
+ * Parse RFC 4291 text: up to 8 hex groups, one "::" run of zero groups,
+ * and an optional dotted IPv4 tail ("::ffff:192.0.2.1").
+ */
+ConversionResult parse_ipv6_span(const char *str, size_t len, Ipv6Address *addr);
+
+/* RFC 5952 canonical text (no terminator added); returns the length */
+size_t format_ipv6(const Ipv6Address *addr, char *buffer);
+
+/*
+ * Sort `n` keys with `threads` workers; `scratch` must hold n keys. The
+ * result ends up in `keys`.
+ */
+void radix_sort_u32(uint32_t *keys, uint32_t *scratch, size_t n, int threads);
+void radix_sort_ipv6(Ipv6Address *keys, Ipv6Address *scratch, size_t n, int threads);
+
+/*
+ * Read the addresses in field `column` (1-based, whitespace-separated)
+ * of every line of `path` (NULL = stdin) and write each distinct address
+ * once, in order, preceded by its count as `uniq -c` does. Lines without
+ * an address are reported on stderr and skipped; returns
+ * RESULT_INVALID_INPUT if there were any.
+ */
+ConversionResult ip_sort_count(const char *path, int column, int threads, int out_fd);
+
+#endif /* IPSORT_H */
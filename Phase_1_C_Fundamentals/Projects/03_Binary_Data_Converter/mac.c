@@ -0,0 +1,584 @@
+/*
+ * Binary Data Converter - MAC Addresses
+ *
+ * See mac.h for the accepted styles and the OUI database format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mac.h"
+
+#define MAC_MASK 0xFFFFFFFFFFFFULL
+
+/* Registered block sizes, longest first */
+static const unsigned OUI_PREFIX_BITS[] = { 36, 28, 24 };
+
+/* On-disk database header and entry (see mac.h) */
+typedef struct {
+    char magic[8];
+    uint32_t num_entries;
+    uint32_t names_size;
+} OuiFileHeader;
+
+typedef struct {
+    uint64_t key;
+    uint32_t name_offset;
+    uint32_t name_length;
+} OuiEntry;
+
+static const char LOWER_DIGITS[] = "0123456789abcdef";
+static const char UPPER_DIGITS[] = "0123456789ABCDEF";
+
+/* ============================================================================
+ * PARSING AND FORMATTING
+ * ============================================================================ */
+
+static int hex_digit(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/* "001a2b3c4d5e" or "001a.2b3c.4d5e" */
+static ConversionResult parse_mac_compact(const char *str, size_t len, uint64_t *mac) {
+    int dotted = (len == 14);
+    if (!(len == 12 || (dotted && str[4] == '.' && str[9] == '.'))) {
+        return RESULT_INVALID_INPUT;
+    }
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (dotted && (i == 4 || i == 9)) {
+            continue;
+        }
+        int d = hex_digit((unsigned char)str[i]);
+        if (d < 0) {
+            return RESULT_INVALID_INPUT;
+        }
+        value = (value << 4) | (uint64_t)d;
+    }
+    *mac = value;
+    return RESULT_OK;
+}
+
+/* Six groups of one or two digits separated by ':' or '-' (not mixed) */
+static ConversionResult parse_mac_separated(const char *str, size_t len, uint64_t *mac) {
+    uint64_t value = 0;
+    char sep = 0;
+    size_t pos = 0;
+
+    for (int group = 0; group < 6; group++) {
+        if (group > 0) {
+            if (pos >= len) {
+                return RESULT_INVALID_INPUT;
+            }
+            if (group == 1) {
+                sep = str[pos];
+                if (sep != ':' && sep != '-') {
+                    return RESULT_INVALID_INPUT;
+                }
+            } else if (str[pos] != sep) {
+                return RESULT_INVALID_INPUT;
+            }
+            pos++;
+        }
+
+        unsigned byte = 0;
+        size_t digits = 0;
+        int d;
+        while (pos < len && digits < 3 && (d = hex_digit((unsigned char)str[pos])) >= 0) {
+            byte = (byte << 4) | (unsigned)d;
+            pos++;
+            digits++;
+        }
+        if (digits == 0 || digits > 2) {
+            return RESULT_INVALID_INPUT;
+        }
+        value = (value << 8) | byte;
+    }
+
+    if (pos != len) {
+        return RESULT_INVALID_INPUT;
+    }
+    *mac = value;
+    return RESULT_OK;
+}
+
+ConversionResult parse_mac_span(const char *str, size_t len, uint64_t *mac) {
+    if (parse_mac_compact(str, len, mac) == RESULT_OK) {
+        return RESULT_OK;
+    }
+    return parse_mac_separated(str, len, mac);
+}
+
+size_t format_mac(uint64_t mac, MacStyle style, int uppercase, char *buffer) {
+    const char *digits = uppercase ? UPPER_DIGITS : LOWER_DIGITS;
+    char *p = buffer;
+
+    for (int nibble = 11; nibble >= 0; nibble--) {
+        *p++ = digits[(mac >> (nibble * 4)) & 0xF];
+        if (nibble == 0) {
+            break;
+        }
+        switch (style) {
+            case MAC_STYLE_COLON:
+                if (nibble % 2 == 0) *p++ = ':';
+                break;
+            case MAC_STYLE_DASH:
+                if (nibble % 2 == 0) *p++ = '-';
+                break;
+            case MAC_STYLE_DOT:
+                if (nibble % 4 == 0) *p++ = '.';
+                break;
+            case MAC_STYLE_BARE:
+                break;
+        }
+    }
+    return (size_t)(p - buffer);
+}
+
+int mac_style_from_name(const char *name) {
+    if (strcmp(name, "colon") == 0) return MAC_STYLE_COLON;
+    if (strcmp(name, "dash") == 0) return MAC_STYLE_DASH;
+    if (strcmp(name, "dot") == 0 || strcmp(name, "cisco") == 0) return MAC_STYLE_DOT;
+    if (strcmp(name, "bare") == 0) return MAC_STYLE_BARE;
+    return -1;
+}
+
+/* ============================================================================
+ * OUI DATABASE COMPILER
+ * ============================================================================ */
+
+typedef struct {
+    OuiEntry *entries;
+    size_t count;
+    size_t capacity;
+    char *names;
+    size_t names_size;
+    size_t names_capacity;
+} OuiBuilder;
+
+static int builder_add(OuiBuilder *b, uint64_t assignment, unsigned bits,
+                       const char *name, size_t name_len) {
+    if (b->count == b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 4096;
+        OuiEntry *entries = realloc(b->entries, capacity * sizeof(OuiEntry));
+        if (entries == NULL) {
+            return 0;
+        }
+        b->entries = entries;
+        b->capacity = capacity;
+    }
+    while (b->names_size + name_len > b->names_capacity) {
+        size_t capacity = b->names_capacity ? b->names_capacity * 2 : 65536;
+        char *names = realloc(b->names, capacity);
+        if (names == NULL) {
+            return 0;
+        }
+        b->names = names;
+        b->names_capacity = capacity;
+    }
+
+    OuiEntry *e = &b->entries[b->count++];
+    e->key = ((uint64_t)bits << 48) | (assignment << (48 - bits));
+    e->name_offset = (uint32_t)b->names_size;
+    e->name_length = (uint32_t)name_len;
+    memcpy(b->names + b->names_size, name, name_len);
+    b->names_size += name_len;
+    return 1;
+}
+
+static void trim_span(const char **str, size_t *len) {
+    while (*len > 0 && (**str == ' ' || **str == '\t')) {
+        (*str)++;
+        (*len)--;
+    }
+    while (*len > 0 && ((*str)[*len - 1] == ' ' || (*str)[*len - 1] == '\t' ||
+                        (*str)[*len - 1] == '\r')) {
+        (*len)--;
+    }
+}
+
+/* Parse `len` hex digits; returns 0 if any is not a hex digit */
+static int parse_hex_run(const char *str, size_t len, uint64_t *value) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < len; i++) {
+        int d = hex_digit((unsigned char)str[i]);
+        if (d < 0) {
+            return 0;
+        }
+        v = (v << 4) | (uint64_t)d;
+    }
+    *value = v;
+    return 1;
+}
+
+/*
+ * oui.txt line: "00-22-72   (hex)\t\tAmerican Micro-Fuel Device Corp."
+ * Returns 1 if the line was an entry, 0 if not, -1 if out of memory.
+ */
+static int parse_oui_txt_line(OuiBuilder *b, const char *line, size_t len) {
+    trim_span(&line, &len);
+    if (len < 8 || line[2] != '-' || line[5] != '-') {
+        return 0;
+    }
+    const char *marker = NULL;
+    for (size_t i = 8; i + 5 <= len && marker == NULL; i++) {
+        if (memcmp(line + i, "(hex)", 5) == 0) {
+            marker = line + i;
+        }
+    }
+    if (marker == NULL) {
+        return 0;
+    }
+
+    char digits[6] = { line[0], line[1], line[3], line[4], line[6], line[7] };
+    uint64_t assignment;
+    if (!parse_hex_run(digits, 6, &assignment)) {
+        return 0;
+    }
+
+    const char *name = marker + 5;
+    size_t name_len = len - (size_t)(name - line);
+    trim_span(&name, &name_len);
+    return builder_add(b, assignment, 24, name, name_len) ? 1 : -1;
+}
+
+/*
+ * CSV field `index` (0-based) of a line; handles quoted fields with ""
+ * escapes by copying them into `scratch`. Returns 0 if missing.
+ */
+static int csv_field(const char *line, size_t len, int index, char *scratch,
+                     size_t scratch_size, const char **field, size_t *field_len) {
+    size_t pos = 0;
+    for (int current = 0; pos <= len; current++) {
+        if (pos < len && line[pos] == '"') {
+            size_t n = 0;
+            pos++;
+            while (pos < len) {
+                if (line[pos] == '"') {
+                    if (pos + 1 < len && line[pos + 1] == '"') {
+                        pos++;
+                    } else {
+                        break;
+                    }
+                }
+                if (n < scratch_size) {
+                    scratch[n++] = line[pos];
+                }
+                pos++;
+            }
+            pos++;  // Closing quote
+            if (current == index) {
+                *field = scratch;
+                *field_len = n;
+                return 1;
+            }
+        } else {
+            const char *comma = memchr(line + pos, ',', len - pos);
+            size_t end = comma ? (size_t)(comma - line) : len;
+            if (current == index) {
+                *field = line + pos;
+                *field_len = end - pos;
+                return 1;
+            }
+            pos = end;
+        }
+        if (pos >= len) {
+            return 0;
+        }
+        pos++;  // Comma
+    }
+    return 0;
+}
+
+/* Registry CSV line: "MA-L,002272,American Micro-Fuel Device Corp.,..." */
+static int parse_oui_csv_line(OuiBuilder *b, const char *line, size_t len) {
+    char scratch[512];
+    const char *registry, *assignment_text, *name;
+    size_t registry_len, assignment_len, name_len;
+
+    if (!csv_field(line, len, 0, scratch, sizeof(scratch), &registry, &registry_len) ||
+        !(registry_len == 4 && (memcmp(registry, "MA-", 3) == 0)) ||
+        !csv_field(line, len, 1, scratch, sizeof(scratch), &assignment_text, &assignment_len)) {
+        return 0;
+    }
+
+    // MA-L is a 24-bit prefix, MA-M 28 bits, MA-S 36 bits
+    uint64_t assignment;
+    unsigned bits = (unsigned)assignment_len * 4;
+    if ((bits != 24 && bits != 28 && bits != 36) ||
+        !parse_hex_run(assignment_text, assignment_len, &assignment) ||
+        !csv_field(line, len, 2, scratch, sizeof(scratch), &name, &name_len)) {
+        return 0;
+    }
+    trim_span(&name, &name_len);
+    return builder_add(b, assignment, bits, name, name_len) ? 1 : -1;
+}
+
+static const OuiEntry *sort_base;
+
+static int compare_entries(const void *a, const void *b) {
+    uint64_t ia = *(const uint64_t *)a, ib = *(const uint64_t *)b;
+    uint64_t ka = sort_base[ia].key, kb = sort_base[ib].key;
+    if (ka != kb) {
+        return ka < kb ? -1 : 1;
+    }
+    return ia < ib ? -1 : (ia > ib);  // Earlier input wins on duplicates
+}
+
+ConversionResult oui_compile(const char *const *inputs, int num_inputs,
+                             const char *output) {
+    OuiBuilder b;
+    memset(&b, 0, sizeof(b));
+    ConversionResult result = RESULT_OK;
+
+    for (int f = 0; f < num_inputs && result == RESULT_OK; f++) {
+        MappedFile file;
+        result = map_file_range(inputs[f], 0, 0, &file);
+        if (result != RESULT_OK) {
+            break;
+        }
+
+        const char *text = (const char *)file.data;
+        size_t pos = 0, found = 0;
+        while (pos < file.size) {
+            const char *nl = memchr(text + pos, '\n', file.size - pos);
+            size_t end = nl ? (size_t)(nl - text) : file.size;
+            int status = parse_oui_txt_line(&b, text + pos, end - pos);
+            if (status == 0) {
+                status = parse_oui_csv_line(&b, text + pos, end - pos);
+            }
+            if (status < 0) {
+                fprintf(stderr, "Error: Out of memory\n");
+                result = RESULT_OVERFLOW;
+                break;
+            }
+            found += (size_t)status;
+            pos = end + 1;
+        }
+        unmap_file(&file);
+
+        if (result == RESULT_OK && found == 0) {
+            fprintf(stderr, "Error: No OUI entries found in '%s'\n", inputs[f]);
+            result = RESULT_INVALID_INPUT;
+        }
+    }
+
+    // Sort by key through an index so duplicates keep input order
+    uint64_t *order = NULL;
+    if (result == RESULT_OK) {
+        order = malloc((b.count ? b.count : 1) * sizeof(uint64_t));
+        if (order == NULL) {
+            fprintf(stderr, "Error: Out of memory\n");
+            result = RESULT_OVERFLOW;
+        }
+    }
+
+    FILE *fp = NULL;
+    if (result == RESULT_OK) {
+        for (size_t i = 0; i < b.count; i++) {
+            order[i] = i;
+        }
+        sort_base = b.entries;
+        qsort(order, b.count, sizeof(uint64_t), compare_entries);
+
+        fp = fopen(output, "wb");
+        if (fp == NULL) {
+            fprintf(stderr, "Error: Cannot create file '%s'\n", output);
+            perror("fopen");
+            result = RESULT_INVALID_INPUT;
+        }
+    }
+
+    if (result == RESULT_OK) {
+        size_t unique = 0;
+        for (size_t i = 0; i < b.count; i++) {
+            if (i == 0 || b.entries[order[i]].key != b.entries[order[i - 1]].key) {
+                order[unique++] = order[i];
+            }
+        }
+
+        OuiFileHeader header;
+        memcpy(header.magic, OUI_MAGIC, sizeof(header.magic));
+        header.num_entries = (uint32_t)unique;
+        header.names_size = (uint32_t)b.names_size;
+        fwrite(&header, sizeof(header), 1, fp);
+        for (size_t i = 0; i < unique; i++) {
+            fwrite(&b.entries[order[i]], sizeof(OuiEntry), 1, fp);
+        }
+        fwrite(b.names, 1, b.names_size, fp);
+
+        if (ferror(fp) | fclose(fp)) {
+            fprintf(stderr, "Error: Cannot write file '%s'\n", output);
+            result = RESULT_FORMAT_ERROR;
+        } else {
+            printf("Compiled %zu OUI blocks (%zu bytes of names) into %s\n",
+                   unique, b.names_size, output);
+        }
+    }
+
+    free(order);
+    free(b.entries);
+    free(b.names);
+    return result;
+}
+
+/* ============================================================================
+ * OUI LOOKUP
+ * ============================================================================ */
+
+ConversionResult oui_open(const char *path, OuiDatabase *db) {
+    memset(db, 0, sizeof(*db));
+    ConversionResult result = map_file_range(path, 0, 0, &db->file);
+    if (result != RESULT_OK) {
+        return result;
+    }
+
+    OuiFileHeader header;
+    if (db->file.size < sizeof(header)) {
+        result = RESULT_FORMAT_ERROR;
+    } else {
+        memcpy(&header, db->file.data, sizeof(header));
+        uint64_t needed = sizeof(header) + (uint64_t)header.num_entries * sizeof(OuiEntry) +
+                          header.names_size;
+        if (memcmp(header.magic, OUI_MAGIC, sizeof(header.magic)) != 0 ||
+            needed > db->file.size) {
+            result = RESULT_FORMAT_ERROR;
+        }
+    }
+    if (result != RESULT_OK) {
+        fprintf(stderr, "Error: '%s' is not an OUI database (see --oui-compile)\n", path);
+        oui_close(db);
+        return result;
+    }
+
+    db->entries = db->file.data + sizeof(header);
+    db->num_entries = header.num_entries;
+    db->names = (const char *)db->entries + (size_t)header.num_entries * sizeof(OuiEntry);
+    db->names_size = header.names_size;
+    return RESULT_OK;
+}
+
+void oui_close(OuiDatabase *db) {
+    unmap_file(&db->file);
+    memset(db, 0, sizeof(*db));
+}
+
+size_t oui_lookup(const OuiDatabase *db, uint64_t mac, const char **name) {
+    // Entries start 16 bytes into a page-aligned mapping
+    const OuiEntry *entries = (const OuiEntry *)(const void *)db->entries;
+    mac &= MAC_MASK;
+
+    for (size_t i = 0; i < sizeof(OUI_PREFIX_BITS) / sizeof(OUI_PREFIX_BITS[0]); i++) {
+        unsigned bits = OUI_PREFIX_BITS[i];
+        uint64_t key = ((uint64_t)bits << 48) | (mac & (MAC_MASK << (48 - bits)) & MAC_MASK);
+
+        size_t lo = 0, hi = db->num_entries;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (entries[mid].key < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo < db->num_entries && entries[lo].key == key) {
+            const OuiEntry *e = &entries[lo];
+            if ((uint64_t)e->name_offset + e->name_length > db->names_size) {
+                return 0;  // Corrupt entry
+            }
+            *name = db->names + e->name_offset;
+            return e->name_length;
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * BATCH CONVERSION
+ * ============================================================================ */
+
+typedef struct {
+    int column;
+    MacStyle style;
+    int uppercase;
+    const OuiDatabase *db;
+    OutBuf *out;
+    uint64_t line;
+    uint64_t invalid;
+} LineConverter;
+
+static void convert_line(void *ctx, const char *line, size_t len) {
+    LineConverter *lc = ctx;
+    lc->line++;
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+
+    size_t first = 0;
+    while (first < len && (line[first] == ' ' || line[first] == '\t')) {
+        first++;
+    }
+    if (first == len) {
+        return;  // Blank line
+    }
+
+    size_t start, end;
+    find_column(line, len, lc->column, &start, &end);
+
+    uint64_t mac;
+    if (start == end || parse_mac_span(line + start, end - start, &mac) != RESULT_OK) {
+        if (lc->invalid++ < MAX_REPORTED_LINES) {
+            fprintf(stderr, "Line %llu: no MAC address in field %d: %.*s\n",
+                    (unsigned long long)lc->line, lc->column, (int)len, line);
+        }
+        return;
+    }
+
+    char formatted[MAC_STR_MAX];
+    size_t n = format_mac(mac, lc->style, lc->uppercase, formatted);
+    outbuf_write(lc->out, line, start);
+    outbuf_write(lc->out, formatted, n);
+    outbuf_write(lc->out, line + end, len - end);
+    if (lc->db != NULL) {
+        const char *vendor;
+        size_t vendor_len = oui_lookup(lc->db, mac, &vendor);
+        outbuf_write(lc->out, "\t", 1);
+        if (vendor_len > 0) {
+            outbuf_write(lc->out, vendor, vendor_len);
+        } else {
+            outbuf_write(lc->out, "unknown", 7);
+        }
+    }
+    outbuf_write(lc->out, "\n", 1);
+}
+
+ConversionResult mac_convert_lines(const char *path, int column, MacStyle style,
+                                   int uppercase, const OuiDatabase *db,
+                                   int out_fd) {
+    LineConverter lc = { column, style, uppercase, db, NULL, 0, 0 };
+    lc.out = outbuf_open(out_fd);
+    if (lc.out == NULL) {
+        return RESULT_OVERFLOW;
+    }
+
+    ConversionResult result = for_each_line(path, convert_line, &lc);
+    ConversionResult written = outbuf_close(lc.out);
+    if (result != RESULT_OK) {
+        return result;
+    }
+    result = written;
+    if (lc.invalid > 0) {
+        fprintf(stderr, "%llu line(s) without a MAC address skipped\n",
+                (unsigned long long)lc.invalid);
+        if (result == RESULT_OK) {
+            result = RESULT_INVALID_INPUT;
+        }
+    }
+    return result;
+}
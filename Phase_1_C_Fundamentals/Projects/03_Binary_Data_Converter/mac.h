@@ -0,0 +1,97 @@
+/*
+ * Binary Data Converter - MAC Addresses
+ *
+ * Parsing and formatting of 48-bit MAC addresses in the styles network
+ * gear prints them:
+ *
+ *   colon   00:1a:2b:3c:4d:5e   (Linux, most switches)
+ *   dash    00-1a-2b-3c-4d-5e   (Windows)
+ *   dot     001a.2b3c.4d5e      (Cisco)
+ *   bare    001a2b3c4d5e
+ *
+ * plus vendor lookup through a compiled OUI database. The database is
+ * built once from the IEEE registry files (oui.txt or the MA-L / MA-M /
+ * MA-S CSV files) and used in place after mmap:
+ *
+ *   header   char magic[8] "OUIDB001", uint32 num_entries,
+ *            uint32 names_size
+ *   entries  num_entries x { uint64 key, uint32 name_offset,
+ *            uint32 name_length }, sorted by key, where
+ *            key = prefix_bits << 48 | first address of the block
+ *   names    vendor names, referenced by offset (not NUL-terminated)
+ *
+ * A lookup tries the 36-, 28- and 24-bit prefixes of the address in
+ * turn (one binary search each), so the longest registered block wins.
+ */
+
+#ifndef MAC_H
+#define MAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+#include "file_io.h"
+
+/* "00:1a:2b:3c:4d:5e" plus terminator */
+#define MAC_STR_MAX 18
+
+#define OUI_MAGIC "OUIDB001"
+
+typedef enum {
+    MAC_STYLE_COLON,
+    MAC_STYLE_DASH,
+    MAC_STYLE_DOT,
+    MAC_STYLE_BARE
+} MacStyle;
+
+/*
+ * Parse any of the four styles (hex digits in either case; colon and
+ * dash groups may drop a leading zero, as "0:1a:2b:..." in some
+ * tools' output). The address is returned in the low 48 bits.
+ */
+ConversionResult parse_mac_span(const char *str, size_t len, uint64_t *mac);
+
+/* Format in the given style; returns the length (no terminator added) */
+size_t format_mac(uint64_t mac, MacStyle style, int uppercase, char *buffer);
+
+/* Style from its name ("colon", "dash", "dot"/"cisco", "bare"); -1 if unknown */
+int mac_style_from_name(const char *name);
+
+/* A compiled OUI database, mapped read-only */
+typedef struct {
+    MappedFile file;
+    const uint8_t *entries;
+    uint32_t num_entries;
+    const char *names;
+    uint32_t names_size;
+} OuiDatabase;
+
+/*
+ * Compile IEEE registry files (oui.txt, oui.csv, mam.csv, oui36.csv in
+ * any mix) into a database file.
+ */
+ConversionResult oui_compile(const char *const *inputs, int num_inputs,
+                             const char *output);
+
+ConversionResult oui_open(const char *path, OuiDatabase *db);
+void oui_close(OuiDatabase *db);
+
+/*
+ * Vendor of `mac`; returns the name length and sets *name, or returns 0
+ * if no registered block contains the address.
+ */
+size_t oui_lookup(const OuiDatabase *db, uint64_t mac, const char **name);
+
+/*
+ * Rewrite field `column` (1-based, whitespace-separated) of every line
+ * of `path` (NULL = stdin) in `style`, appending a tab and the vendor
+ * name when `db` is given. Lines whose field is not a MAC address are
+ * reported on stderr and skipped; returns RESULT_INVALID_INPUT if there
+ * were any.
+ */
+ConversionResult mac_convert_lines(const char *path, int column, MacStyle style,
+                                   int uppercase, const OuiDatabase *db,
+                                   int out_fd);
+
+#endif /* MAC_H */
@@ -0,0 +1,565 @@
+/*
+ * Binary Data Converter - CPython Extension
+ *
+ * Exposes the converter functions to Python in vectorized form: every
+ * function takes a whole batch of values and returns a whole batch of
+ * results, so a million conversions cost one Python call instead of a
+ * million. Numeric inputs may be any buffer of 32-bit unsigned integers
+ * (array('I'), numpy.uint32, ...) - used in place, without copying - or
+ * any sequence of ints. Numeric results are array.array objects.
+ *
+ *   >>> import pyconverter as pc
+ *   >>> pc.parse_ip(["10.0.0.1", "192.168.1.1"])
+ *   array('I', [167772161, 3232235777])
+ *   >>> pc.format_hex(pc.swap32([0x12345678]))
+ *   ['78563412']
+ *
+ * Built by `make pymodule` against libconverter.so.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "converter.h"
+
+static PyObject *array_type = NULL;   // array.array, looked up at import
+
+/* ============================================================================
+ * INPUT AND OUTPUT HELPERS
+ * ============================================================================ */
+
+/* A batch of uint32 values, borrowed from a buffer or copied from a list */
+typedef struct {
+    const uint32_t *data;
+    Py_ssize_t count;
+    Py_buffer view;
+    int has_view;
+    uint32_t *owned;
+} U32Input;
+
+static int is_u32_format(const Py_buffer *view) {
+    if (view->itemsize != 4 || view->format == NULL) {
+        return 0;
+    }
+    const char *f = view->format;
+    if (*f == '@' || *f == '=' || *f == '<') {
+        f++;  // Native byte order
+    }
+    return strcmp(f, "I") == 0 || strcmp(f, "L") == 0;
+}
+
+static int u32_input_get(PyObject *obj, U32Input *in) {
+    memset(in, 0, sizeof(*in));
+
+    // Fast path: a contiguous buffer of uint32 is used in place
+    if (PyObject_CheckBuffer(obj) && !PyBytes_Check(obj) && !PyByteArray_Check(obj)) {
+        if (PyObject_GetBuffer(obj, &in->view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) == 0) {
+            if (is_u32_format(&in->view)) {
+                in->has_view = 1;
+                in->data = in->view.buf;
+                in->count = in->view.len / 4;
+                return 0;
+            }
+            PyBuffer_Release(&in->view);
+        } else {
+            PyErr_Clear();
+        }
+    }
+
+    PyObject *seq = PySequence_Fast(obj, "expected a uint32 buffer or a sequence of ints");
+    if (seq == NULL) {
+        return -1;
+    }
+
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    in->owned = PyMem_Malloc((size_t)(n > 0 ? n : 1) * sizeof(uint32_t));
+    if (in->owned == NULL) {
+        Py_DECREF(seq);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    PyObject **items = PySequence_Fast_ITEMS(seq);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        unsigned long v = PyLong_AsUnsignedLong(items[i]);
+        if ((v == (unsigned long)-1 && PyErr_Occurred()) || v > 0xFFFFFFFFUL) {
+            PyErr_Clear();
+            PyErr_Format(PyExc_ValueError, "item %zd is not a 32-bit unsigned int", i);
+            PyMem_Free(in->owned);
+            in->owned = NULL;
+            Py_DECREF(seq);
+            return -1;
+        }
+        in->owned[i] = (uint32_t)v;
+    }
+    Py_DECREF(seq);
+
+    in->data = in->owned;
+    in->count = n;
+    return 0;
+}
+
+static void u32_input_release(U32Input *in) {
+    if (in->has_view) {
+        PyBuffer_Release(&in->view);
+    }
+    PyMem_Free(in->owned);
+}
+
+/* Wrap raw values in a new array.array of the given typecode */
+static PyObject *make_array(const char *typecode, const void *data, Py_ssize_t nbytes) {
+    PyObject *arr = PyObject_CallFunction(array_type, "s", typecode);
+    if (arr == NULL) {
+        return NULL;
+    }
+    PyObject *r = PyObject_CallMethod(arr, "frombytes", "y#", (const char *)data, nbytes);
+    if (r == NULL) {
+        Py_DECREF(arr);
+        return NULL;
+    }
+    Py_DECREF(r);
+    return arr;
+}
+
+/* Run `fn` over every value and collect the strings it produces */
+typedef void (*FormatFn)(uint32_t value, char *buffer, size_t size);
+
+static PyObject *format_batch(PyObject *values, FormatFn fn) {
+    U32Input in;
+    if (u32_input_get(values, &in) < 0) {
+        return NULL;
+    }
+
+    PyObject *list = PyList_New(in.count);
+    if (list != NULL) {
+        char buffer[BINARY_STR_MAX];
+        for (Py_ssize_t i = 0; i < in.count; i++) {
+            fn(in.data[i], buffer, sizeof(buffer));
+            PyObject *s = PyUnicode_FromString(buffer);
+            if (s == NULL) {
+                Py_CLEAR(list);
+                break;
+            }
+            PyList_SET_ITEM(list, i, s);
+        }
+    }
+
+    u32_input_release(&in);
+    return list;
+}
+
+static void fmt_binary(uint32_t v, char *b, size_t n) { format_binary(v, b, n); }
+static void fmt_hex(uint32_t v, char *b, size_t n) { format_hex(v, b, n); }
+static void fmt_octal(uint32_t v, char *b, size_t n) { format_octal(v, b, n); }
+static void fmt_ip(uint32_t v, char *b, size_t n) { format_ip_address(htonl(v), b, n); }
+
+/* ============================================================================
+ * MODULE FUNCTIONS
+ * ============================================================================ */
+
+static PyObject *py_format_binary(PyObject *self, PyObject *values) {
+    (void)self;
+    return format_batch(values, fmt_binary);
+}
+
+static PyObject *py_format_hex(PyObject *self, PyObject *values) {
+    (void)self;
+    return format_batch(values, fmt_hex);
+}
+
+static PyObject *py_format_octal(PyObject *self, PyObject *values) {
+    (void)self;
+    return format_batch(values, fmt_octal);
+}
+
+static PyObject *py_format_ip(PyObject *self, PyObject *values) {
+    (void)self;
+    return format_batch(values, fmt_ip);
+}
+
+static PyObject *py_parse_auto(PyObject *self, PyObject *strings) {
+    (void)self;
+    PyObject *seq = PySequence_Fast(strings, "expected a sequence of str");
+    if (seq == NULL) {
+        return NULL;
+    }
+
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    uint32_t *out = PyMem_Malloc((size_t)(n > 0 ? n : 1) * sizeof(uint32_t));
+    if (out == NULL) {
+        Py_DECREF(seq);
+        return PyErr_NoMemory();
+    }
+
+    PyObject *result = NULL;
+    PyObject **items = PySequence_Fast_ITEMS(seq);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        const char *s = PyUnicode_AsUTF8(items[i]);
+        if (s == NULL) {
+            goto done;
+        }
+        if (parse_auto_checked(s, &out[i]) != RESULT_OK) {
+            PyErr_Format(PyExc_ValueError, "item %zd is not a valid 32-bit value: %R",
+                         i, items[i]);
+            goto done;
+        }
+    }
+    result = make_array("I", out, n * (Py_ssize_t)sizeof(uint32_t));
+
+done:
+    PyMem_Free(out);
+    Py_DECREF(seq);
+    return result;
+}
+
+/*
+ * parse_ip(addresses) accepts either a sequence of str, or one bytes-like
+ * blob of newline-separated addresses (e.g. a whole file read as bytes),
+ * which avoids creating a Python string per address.
+ */
+static PyObject *py_parse_ip(PyObject *self, PyObject *arg) {
+    (void)self;
+
+    if (PyObject_CheckBuffer(arg) && !PyUnicode_Check(arg)) {
+        Py_buffer view;
+        if (PyObject_GetBuffer(arg, &view, PyBUF_SIMPLE) < 0) {
+            return NULL;
+        }
+
+        const char *text = view.buf;
+        size_t len = (size_t)view.len;
+        size_t cap = 1024, n = 0;
+        uint32_t *out = PyMem_Malloc(cap * sizeof(uint32_t));
+        PyObject *result = NULL;
+        if (out == NULL) {
+            PyErr_NoMemory();
+            goto blob_done;
+        }
+
+        size_t pos = 0;
+        while (pos < len) {
+            const char *nl = memchr(text + pos, '\n', len - pos);
+            size_t end = nl ? (size_t)(nl - text) : len;
+            size_t line_end = end;
+            if (line_end > pos && text[line_end - 1] == '\r') line_end--;
+
+            if (line_end > pos) {  // Blank lines are skipped
+                if (n == cap) {
+                    cap *= 2;
+                    uint32_t *grown = PyMem_Realloc(out, cap * sizeof(uint32_t));
+                    if (grown == NULL) {
+                        PyErr_NoMemory();
+                        goto blob_done;
+                    }
+                    out = grown;
+                }
+                if (parse_ipv4_span(text + pos, line_end - pos, &out[n]) != RESULT_OK) {
+                    // PyErr_Format() has no %.*s, so copy the bad line out
+                    char snippet[65];
+                    size_t snippet_len = line_end - pos < 64 ? line_end - pos : 64;
+                    memcpy(snippet, text + pos, snippet_len);
+                    snippet[snippet_len] = '\0';
+                    PyErr_Format(PyExc_ValueError, "invalid IPv4 address at offset %zu: %s",
+                                 pos, snippet);
+                    goto blob_done;
+                }
+                n++;
+            }
+            pos = end + 1;
+        }
+        result = make_array("I", out, (Py_ssize_t)(n * sizeof(uint32_t)));
+
+    blob_done:
+        PyMem_Free(out);
+        PyBuffer_Release(&view);
+        return result;
+    }
+
+    PyObject *seq = PySequence_Fast(arg, "expected a sequence of str or a bytes blob");
+    if (seq == NULL) {
+        return NULL;
+    }
+
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    uint32_t *out = PyMem_Malloc((size_t)(n > 0 ? n : 1) * sizeof(uint32_t));
+    if (out == NULL) {
+        Py_DECREF(seq);
+        return PyErr_NoMemory();
+    }
+
+    PyObject *result = NULL;
+    PyObject **items = PySequence_Fast_ITEMS(seq);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        Py_ssize_t len;
+        const char *s = PyUnicode_AsUTF8AndSize(items[i], &len);
+        if (s == NULL) {
+            goto done;
+        }
+        if (parse_ipv4_span(s, (size_t)len, &out[i]) != RESULT_OK) {
+            PyErr_Format(PyExc_ValueError, "item %zd is not a valid IPv4 address: %R",
+                         i, items[i]);
+            goto done;
+        }
+    }
+    result = make_array("I", out, n * (Py_ssize_t)sizeof(uint32_t));
+
+done:
+    PyMem_Free(out);
+    Py_DECREF(seq);
+    return result;
+}
+
+static PyObject *py_swap32(PyObject *self, PyObject *values) {
+    (void)self;
+    U32Input in;
+    if (u32_input_get(values, &in) < 0) {
+        return NULL;
+    }
+
+    PyObject *result = NULL;
+    uint32_t *out = PyMem_Malloc((size_t)(in.count > 0 ? in.count : 1) * sizeof(uint32_t));
+    if (out == NULL) {
+        PyErr_NoMemory();
+    } else {
+        for (Py_ssize_t i = 0; i < in.count; i++) {
+            out[i] = swap_bytes_32(in.data[i]);
+        }
+        result = make_array("I", out, in.count * (Py_ssize_t)sizeof(uint32_t));
+        PyMem_Free(out);
+    }
+
+    u32_input_release(&in);
+    return result;
+}
+
+static PyObject *py_swap16(PyObject *self, PyObject *values) {
+    (void)self;
+    U32Input in;
+    if (u32_input_get(values, &in) < 0) {
+        return NULL;
+    }
+
+    PyObject *result = NULL;
+    uint16_t *out = PyMem_Malloc((size_t)(in.count > 0 ? in.count : 1) * sizeof(uint16_t));
+    if (out == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (Py_ssize_t i = 0; i < in.count; i++) {
+        if (in.data[i] > 0xFFFF) {
+            PyErr_Format(PyExc_ValueError, "item %zd does not fit in 16 bits", i);
+            goto done;
+        }
+        out[i] = swap_bytes_16((uint16_t)in.data[i]);
+    }
+    result = make_array("H", out, in.count * (Py_ssize_t)sizeof(uint16_t));
+
+done:
+    PyMem_Free(out);
+    u32_input_release(&in);
+    return result;
+}
+
+/* Run extract_field_batch() and wrap the result */
+static PyObject *extract_batch(const U32Input *in, Py_ssize_t count, size_t stride,
+                               const BitFieldDesc *field) {
+    uint32_t *out = PyMem_Malloc((size_t)(count > 0 ? count : 1) * sizeof(uint32_t));
+    if (out == NULL) {
+        return PyErr_NoMemory();
+    }
+    extract_field_batch(in->data, (size_t)count, stride, field, out);
+    PyObject *result = make_array("I", out, count * (Py_ssize_t)sizeof(uint32_t));
+    PyMem_Free(out);
+    return result;
+}
+
+static PyObject *py_extract_field(PyObject *self, PyObject *args) {
+    (void)self;
+    PyObject *values;
+    int start_bit, num_bits;
+    if (!PyArg_ParseTuple(args, "Oii:extract_field", &values, &start_bit, &num_bits)) {
+        return NULL;
+    }
+    if (start_bit < 0 || num_bits < 1 || start_bit + num_bits > 32) {
+        PyErr_SetString(PyExc_ValueError, "field must lie within bits 0-31");
+        return NULL;
+    }
+
+    U32Input in;
+    if (u32_input_get(values, &in) < 0) {
+        return NULL;
+    }
+    BitFieldDesc field = { NULL, 0, (uint8_t)start_bit, (uint8_t)num_bits };
+    PyObject *result = extract_batch(&in, in.count, 1, &field);
+    u32_input_release(&in);
+    return result;
+}
+
+static PyObject *py_set_field(PyObject *self, PyObject *args) {
+    (void)self;
+    PyObject *values;
+    int start_bit, num_bits;
+    unsigned long field_value;
+    if (!PyArg_ParseTuple(args, "Oiik:set_field", &values, &start_bit, &num_bits,
+                          &field_value)) {
+        return NULL;
+    }
+    if (start_bit < 0 || num_bits < 1 || start_bit + num_bits > 32) {
+        PyErr_SetString(PyExc_ValueError, "field must lie within bits 0-31");
+        return NULL;
+    }
+
+    U32Input in;
+    if (u32_input_get(values, &in) < 0) {
+        return NULL;
+    }
+
+    PyObject *result = NULL;
+    uint32_t *out = PyMem_Malloc((size_t)(in.count > 0 ? in.count : 1) * sizeof(uint32_t));
+    if (out == NULL) {
+        PyErr_NoMemory();
+    } else {
+        for (Py_ssize_t i = 0; i < in.count; i++) {
+            out[i] = in.data[i];
+            set_field(&out[i], start_bit, num_bits, (uint32_t)field_value);
+        }
+        result = make_array("I", out, in.count * (Py_ssize_t)sizeof(uint32_t));
+        PyMem_Free(out);
+    }
+
+    u32_input_release(&in);
+    return result;
+}
+
+/*
+ * extract_named(records, "ipv4.dscp", stride=0): one field from headers
+ * stored back to back as host-order words. The stride defaults to the
+ * layout's header size.
+ */
+static PyObject *py_extract_named(PyObject *self, PyObject *args) {
+    (void)self;
+    PyObject *records;
+    const char *name;
+    Py_ssize_t stride = 0;
+    if (!PyArg_ParseTuple(args, "Os|n:extract_named", &records, &name, &stride)) {
+        return NULL;
+    }
+
+    const BitFieldDesc *field = find_field(name);
+    if (field == NULL) {
+        return PyErr_Format(PyExc_KeyError, "unknown field: %s", name);
+    }
+    if (stride == 0) {
+        char layout_name[32];
+        snprintf(layout_name, sizeof(layout_name), "%.*s",
+                 (int)(strchr(name, '.') - name), name);
+        stride = (Py_ssize_t)find_field_layout(layout_name)->num_words;
+    }
+    if (stride <= field->word) {
+        return PyErr_Format(PyExc_ValueError, "stride %zd is too small for %s", stride, name);
+    }
+
+    U32Input in;
+    if (u32_input_get(records, &in) < 0) {
+        return NULL;
+    }
+    PyObject *result = extract_batch(&in, in.count / stride, (size_t)stride, field);
+    u32_input_release(&in);
+    return result;
+}
+
+/*
+ * extract_named_be(data, "ipv4.ttl", stride_bytes): the same for raw
+ * network-order headers, e.g. fixed-size records cut from a capture.
+ */
+static PyObject *py_extract_named_be(PyObject *self, PyObject *args) {
+    (void)self;
+    Py_buffer view;
+    const char *name;
+    Py_ssize_t stride;
+    if (!PyArg_ParseTuple(args, "y*sn:extract_named_be", &view, &name, &stride)) {
+        return NULL;
+    }
+
+    PyObject *result = NULL;
+    const BitFieldDesc *field = find_field(name);
+    if (field == NULL) {
+        PyErr_Format(PyExc_KeyError, "unknown field: %s", name);
+        goto done;
+    }
+    if (stride < (Py_ssize_t)(field->word + 1) * 4) {
+        PyErr_Format(PyExc_ValueError, "stride %zd is too small for %s", stride, name);
+        goto done;
+    }
+
+    Py_ssize_t count = view.len / stride;
+    uint32_t *out = PyMem_Malloc((size_t)(count > 0 ? count : 1) * sizeof(uint32_t));
+    if (out == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    extract_field_batch_be(view.buf, (size_t)count, (size_t)stride, field, out);
+    result = make_array("I", out, count * (Py_ssize_t)sizeof(uint32_t));
+    PyMem_Free(out);
+
+done:
+    PyBuffer_Release(&view);
+    return result;
+}
+
+/* ============================================================================
+ * MODULE DEFINITION
+ * ============================================================================ */
+
+static PyMethodDef pyconverter_methods[] = {
+    {"format_binary", py_format_binary, METH_O,
+     "format_binary(values) -> list of 32-character binary strings"},
+    {"format_hex", py_format_hex, METH_O,
+     "format_hex(values) -> list of 8-digit hex strings"},
+    {"format_octal", py_format_octal, METH_O,
+     "format_octal(values) -> list of 11-digit octal strings"},
+    {"format_ip", py_format_ip, METH_O,
+     "format_ip(values) -> list of dotted quads for host-order integers"},
+    {"parse_auto", py_parse_auto, METH_O,
+     "parse_auto(strings) -> array('I'); accepts 0x, 0b, 0 (octal) and decimal"},
+    {"parse_ip", py_parse_ip, METH_O,
+     "parse_ip(addresses) -> array('I') of host-order integers.\n"
+     "Takes a sequence of str or one bytes blob of newline-separated addresses."},
+    {"swap32", py_swap32, METH_O, "swap32(values) -> array('I') with bytes reversed"},
+    {"swap16", py_swap16, METH_O, "swap16(values) -> array('H') with bytes reversed"},
+    {"extract_field", py_extract_field, METH_VARARGS,
+     "extract_field(values, start_bit, num_bits) -> array('I')"},
+    {"set_field", py_set_field, METH_VARARGS,
+     "set_field(values, start_bit, num_bits, field_value) -> array('I')"},
+    {"extract_named", py_extract_named, METH_VARARGS,
+     "extract_named(records, 'ipv4.dscp', stride=0) -> array('I')"},
+    {"extract_named_be", py_extract_named_be, METH_VARARGS,
+     "extract_named_be(data, 'ipv4.dscp', stride_bytes) -> array('I')"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef pyconverter_module = {
+    PyModuleDef_HEAD_INIT,
+    "pyconverter",
+    "Vectorized binary/network conversions backed by libconverter.",
+    -1,
+    pyconverter_methods,
+    NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_pyconverter(void) {
+    PyObject *array_module = PyImport_ImportModule("array");
+    if (array_module == NULL) {
+        return NULL;
+    }
+    array_type = PyObject_GetAttrString(array_module, "array");
+    Py_DECREF(array_module);
+    if (array_type == NULL) {
+        return NULL;
+    }
+
+    return PyModule_Create(&pyconverter_module);
+}
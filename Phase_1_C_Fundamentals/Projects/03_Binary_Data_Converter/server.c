@@ -0,0 +1,435 @@
+/*
+ * Binary Data Converter - Server Mode
+ *
+ * A single-threaded epoll loop. Each read() may carry many requests;
+ * every complete line in the input buffer is answered before the next
+ * read, and all responses from one read go out in a single write().
+ * A client that stops reading has its input paused once its pending
+ * output passes OUTPUT_HIGH_WATER, so one slow client cannot grow the
+ * server without bound.
+ */
+
+#define _GNU_SOURCE  // accept4(), SOCK_NONBLOCK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "converter.h"
+#include "server.h"
+
+#define CONN_IN_SIZE 65536
+#define OUTPUT_HIGH_WATER (1 << 20)
+#define MAX_EVENTS 64
+#define MAX_ARGS 20
+
+typedef struct {
+    int fd;
+    int closing;            // Close once pending output is flushed
+    uint32_t events;        // Events currently registered with epoll
+    size_t in_len;
+    char *out;
+    size_t out_len;         // Bytes queued in out
+    size_t out_pos;         // Bytes of out already written
+    size_t out_cap;
+    char in[CONN_IN_SIZE];
+} Connection;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+/* ============================================================================
+ * REQUEST HANDLING
+ * ============================================================================ */
+
+static size_t respond(char *response, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(response, SERVER_MAX_RESPONSE - 1, fmt, args);
+    va_end(args);
+
+    if (n < 0) {
+        n = 0;
+    } else if (n > SERVER_MAX_RESPONSE - 2) {
+        n = SERVER_MAX_RESPONSE - 2;  // Truncated; keep room for '\n'
+    }
+    response[n++] = '\n';
+    return (size_t)n;
+}
+
+static size_t respond_bad_value(char *response, const char *arg) {
+    return respond(response, "ERR invalid value: %.64s", arg);
+}
+
+size_t server_handle_request(char *line, char *response, int *close_after) {
+    char *argv[MAX_ARGS];
+    int argc = 0;
+
+    // Split on spaces and tabs in place
+    char *p = line;
+    while (*p != '\0' && argc < MAX_ARGS) {
+        while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+        if (*p == '\0') break;
+        argv[argc++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r') p++;
+        if (*p != '\0') *p++ = '\0';
+    }
+
+    if (argc == 0) {
+        return respond(response, "ERR empty request");
+    }
+
+    const char *cmd = argv[0];
+    uint32_t value;
+
+    if (strcmp(cmd, "ping") == 0) {
+        return respond(response, "OK pong");
+    }
+    if (strcmp(cmd, "quit") == 0) {
+        *close_after = 1;
+        return respond(response, "OK bye");
+    }
+
+    if (strcmp(cmd, "ip2int") == 0) {
+        if (argc != 2) return respond(response, "ERR usage: ip2int <a.b.c.d>");
+        if (parse_ipv4_span(argv[1], strlen(argv[1]), &value) != RESULT_OK) {
+            return respond(response, "ERR invalid IPv4 address: %.64s", argv[1]);
+        }
+        return respond(response, "OK %u 0x%08x", value, value);
+    }
+
+    if (strcmp(cmd, "field") == 0) {
+        if (argc >= 3 && strchr(argv[1], '.') != NULL) {
+            const BitFieldDesc *field = find_field(argv[1]);
+            if (field == NULL) {
+                return respond(response, "ERR unknown field: %.64s", argv[1]);
+            }
+            uint32_t words[MAX_ARGS] = {0};
+            int num_words = argc - 2;
+            for (int i = 0; i < num_words; i++) {
+                if (parse_auto_checked(argv[i + 2], &words[i]) != RESULT_OK) {
+                    return respond_bad_value(response, argv[i + 2]);
+                }
+            }
+            if (field->word >= num_words) {
+                return respond(response, "ERR %s needs word %u", argv[1], field->word);
+            }
+            return respond(response, "OK %u", extract_desc(words, field));
+        }
+
+        uint32_t start, bits;
+        if (argc != 4) {
+            return respond(response, "ERR usage: field <value> <start> <bits>");
+        }
+        if (parse_auto_checked(argv[1], &value) != RESULT_OK) {
+            return respond_bad_value(response, argv[1]);
+        }
+        if (parse_auto_checked(argv[2], &start) != RESULT_OK ||
+            parse_auto_checked(argv[3], &bits) != RESULT_OK ||
+            start > 31 || bits < 1 || start + bits > 32) {
+            return respond(response, "ERR field must lie within bits 0-31");
+        }
+        return respond(response, "OK %u", extract_field(value, (int)start, (int)bits));
+    }
+
+    // Everything else takes exactly one numeric argument
+    if (argc != 2) {
+        return respond(response, "ERR usage: %.16s <value>", cmd);
+    }
+    if (parse_auto_checked(argv[1], &value) != RESULT_OK) {
+        return respond_bad_value(response, argv[1]);
+    }
+
+    char bin[BINARY_STR_MAX];
+    char hex[HEX_STR_MAX];
+    char oct[OCTAL_STR_MAX];
+
+    if (strcmp(cmd, "dec") == 0) {
+        return respond(response, "OK %u", value);
+    } else if (strcmp(cmd, "bin") == 0) {
+        format_binary(value, bin, sizeof(bin));
+        return respond(response, "OK %s", bin);
+    } else if (strcmp(cmd, "hex") == 0) {
+        format_hex(value, hex, sizeof(hex));
+        return respond(response, "OK 0x%s", hex);
+    } else if (strcmp(cmd, "oct") == 0) {
+        format_octal(value, oct, sizeof(oct));
+        return respond(response, "OK 0%s", oct);
+    } else if (strcmp(cmd, "all") == 0) {
+        format_binary(value, bin, sizeof(bin));
+        format_hex(value, hex, sizeof(hex));
+        format_octal(value, oct, sizeof(oct));
+        return respond(response, "OK %u %s 0x%s 0%s", value, bin, hex, oct);
+    } else if (strcmp(cmd, "int2ip") == 0) {
+        char ip[IP_STR_MAX];
+        format_ip_address(htonl(value), ip, sizeof(ip));
+        return respond(response, "OK %s", ip);
+    } else if (strcmp(cmd, "swap32") == 0) {
+        return respond(response, "OK 0x%08x", swap_bytes_32(value));
+    } else if (strcmp(cmd, "swap16") == 0) {
+        if (value > 0xFFFF) {
+            return respond(response, "ERR value does not fit in 16 bits");
+        }
+        return respond(response, "OK 0x%04x", swap_bytes_16((uint16_t)value));
+    }
+
+    return respond(response, "ERR unknown command: %.32s", cmd);
+}
+
+/* ============================================================================
+ * CONNECTION HANDLING
+ * ============================================================================ */
+
+static void update_events(int epfd, Connection *conn) {
+    uint32_t events = 0;
+    if (!conn->closing && conn->out_len - conn->out_pos < OUTPUT_HIGH_WATER) {
+        events |= EPOLLIN;
+    }
+    if (conn->out_pos < conn->out_len) {
+        events |= EPOLLOUT;
+    }
+
+    if (events != conn->events) {
+        struct epoll_event ev = { .events = events, .data.ptr = conn };
+        epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+        conn->events = events;
+    }
+}
+
+static void close_connection(int epfd, Connection *conn) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    free(conn->out);
+    free(conn);
+}
+
+/* Returns 0 on success, -1 if the connection is broken */
+static int flush_output(Connection *conn) {
+    while (conn->out_pos < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + conn->out_pos,
+                         conn->out_len - conn->out_pos, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        conn->out_pos += (size_t)n;
+    }
+    conn->out_pos = conn->out_len = 0;
+    return 0;
+}
+
+/* Make room for one more response at the end of the output queue */
+static int reserve_output(Connection *conn) {
+    if (conn->out_pos > 0 && conn->out_pos == conn->out_len) {
+        conn->out_pos = conn->out_len = 0;
+    }
+    if (conn->out_len + SERVER_MAX_RESPONSE <= conn->out_cap) {
+        return 0;
+    }
+    size_t cap = conn->out_cap ? conn->out_cap * 2 : CONN_IN_SIZE;
+    char *out = realloc(conn->out, cap);
+    if (out == NULL) {
+        return -1;
+    }
+    conn->out = out;
+    conn->out_cap = cap;
+    return 0;
+}
+
+/* Answer every complete line in the input buffer */
+static int process_input(Connection *conn) {
+    char *start = conn->in;
+    char *end = conn->in + conn->in_len;
+
+    while (!conn->closing) {
+        char *nl = memchr(start, '\n', (size_t)(end - start));
+        if (nl == NULL) break;
+        *nl = '\0';
+
+        if (reserve_output(conn) < 0) return -1;
+        conn->out_len += server_handle_request(start, conn->out + conn->out_len,
+                                               &conn->closing);
+        start = nl + 1;
+    }
+
+    // Keep any partial line for the next read
+    conn->in_len = (size_t)(end - start);
+    memmove(conn->in, start, conn->in_len);
+
+    if (conn->in_len >= SERVER_MAX_LINE) {
+        if (reserve_output(conn) < 0) return -1;
+        conn->out_len += respond(conn->out + conn->out_len, "ERR request too long");
+        conn->closing = 1;
+    }
+    return 0;
+}
+
+/* Returns -1 when the connection should be closed now */
+static int handle_readable(Connection *conn) {
+    ssize_t n = read(conn->fd, conn->in + conn->in_len, CONN_IN_SIZE - conn->in_len);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+    if (n == 0) {
+        // Peer finished sending: answer a final unterminated line, then
+        // close once everything owed has been flushed
+        if (conn->in_len > 0 && !conn->closing) {
+            conn->in[conn->in_len++] = '\n';
+            if (process_input(conn) < 0) return -1;
+        }
+        conn->closing = 1;
+        return 0;
+    }
+
+    conn->in_len += (size_t)n;
+    return process_input(conn);
+}
+
+static void accept_clients(int epfd, int listen_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("accept4");
+            }
+            return;
+        }
+
+        Connection *conn = calloc(1, sizeof(*conn));
+        if (conn == NULL) {
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl");
+            close(fd);
+            free(conn);
+        }
+    }
+}
+
+/* ============================================================================
+ * SERVER LOOP
+ * ============================================================================ */
+
+static int open_listen_socket(const char *socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    // Remove a stale socket from an earlier run, but nothing else
+    struct stat st;
+    if (lstat(socket_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "Error: Cannot listen on '%s': path exists and is not a socket\n",
+                    socket_path);
+            close(fd);
+            return -1;
+        }
+        unlink(socket_path);
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "Error: Cannot listen on '%s'\n", socket_path);
+        perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int run_server(const char *socket_path) {
+    int listen_fd = open_listen_socket(socket_path);
+    if (listen_fd < 0) {
+        return 1;
+    }
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        close(listen_fd);
+        unlink(socket_path);
+        return 1;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev);
+
+    // No SA_RESTART, so epoll_wait() returns EINTR and the loop can stop
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Converter server listening on %s\n", socket_path);
+    fflush(stdout);
+
+    struct epoll_event events[MAX_EVENTS];
+    while (!stop_requested) {
+        int n = epoll_wait(epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            Connection *conn = events[i].data.ptr;
+            if (conn == NULL) {
+                accept_clients(epfd, listen_fd);
+                continue;
+            }
+
+            int broken = 0;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                broken = handle_readable(conn) < 0;
+            }
+            if (!broken) {
+                broken = flush_output(conn) < 0;
+            }
+
+            if (broken || (conn->closing && conn->out_pos == conn->out_len)) {
+                close_connection(epfd, conn);
+            } else {
+                update_events(epfd, conn);
+            }
+        }
+    }
+
+    // Connections still open are reclaimed by process exit
+    close(epfd);
+    close(listen_fd);
+    unlink(socket_path);
+    printf("Converter server stopped\n");
+    return 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * Binary Data Converter - Server Mode
+ *
+ * Keeps the converter resident behind a Unix domain socket so scripts
+ * can send many conversions over one connection instead of paying a
+ * fork/exec per value. The protocol is one request per line:
+ *
+ *   request:   <command> <arg>...\n
+ *   response:  OK <result>\n   or   ERR <message>\n
+ *
+ * Commands:
+ *   dec|bin|hex|oct <value>        Base conversion (value in any base)
+ *   all <value>                    "<dec> <bin> 0x<hex> 0<oct>"
+ *   ip2int <a.b.c.d>               "<decimal> 0x<hex>" (host byte order)
+ *   int2ip <value>                 Dotted quad for a host-order integer
+ *   swap32|swap16 <value>          Byte swap
+ *   field <value> <start> <bits>   extract_field()
+ *   field <layout.name> <word>...  Descriptor lookup, e.g. ipv4.dscp
+ *   ping                           "OK pong"
+ *   quit                           Close the connection
+ *
+ * Requests may be pipelined: responses come back in request order.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+
+/* Longest accepted request line, including the newline */
+#define SERVER_MAX_LINE 4096
+
+/* Longest response line, including the newline */
+#define SERVER_MAX_RESPONSE 128
+
+/*
+ * Answer one request. `line` is NUL-terminated, without its newline, and
+ * is modified in place while tokenizing. Writes the response (with
+ * newline) to `response` and returns its length; sets *close_after when
+ * the client asked to disconnect.
+ */
+size_t server_handle_request(char *line, char *response, int *close_after);
+
+/* Serve on `socket_path` until SIGINT/SIGTERM; returns a process exit code */
+int run_server(const char *socket_path);
+
+#endif /* SERVER_H */
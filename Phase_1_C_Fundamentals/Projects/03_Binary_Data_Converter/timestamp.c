@@ -0,0 +1,538 @@
+/*
+ * Binary Data Converter - Timestamps
+ *
+ * See timestamp.h for the formats. Dates use Howard Hinnant's
+ * days_from_civil / civil_from_days algorithms: a handful of integer
+ * divisions by constants, no loops over years or months, valid for the
+ * whole int64 range of days. Two-digit fields are written from a
+ * "00".."99" table, and batch conversion caches the formatted date, as
+ * consecutive log lines almost always fall on the same day.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timestamp.h"
+#include "file_io.h"
+
+#define NANOS_PER_SECOND 1000000000u
+#define SECONDS_PER_DAY 86400
+
+/* Units per second and nanoseconds per unit of the epoch formats */
+static const uint64_t UNITS_PER_SECOND[] = { 1, 1, 1000, 1000000, 1000000000 };
+static const uint32_t NANOS_PER_UNIT[] = { NANOS_PER_SECOND, NANOS_PER_SECOND, 1000000, 1000, 1 };
+
+/* Days in each month of a non-leap year */
+static const uint8_t DAYS_IN_MONTH[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+/* "00" "01" ... "99" */
+static const char DIGIT_PAIRS[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* ============================================================================
+ * CALENDAR ARITHMETIC
+ * ============================================================================ */
+
+int64_t days_from_civil(int64_t year, unsigned month, unsigned day) {
+    // Count years from March so the leap day is the last day of the year
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    uint64_t yoe = (uint64_t)(year - era * 400);                        // [0, 399]
+    uint64_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;               // [0, 146096]
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+void civil_from_days(int64_t days, int64_t *year, unsigned *month, unsigned *day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint64_t doe = (uint64_t)(days - era * 146097);
+    uint64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint64_t mp = (5 * doy + 2) / 153;
+    *day = (unsigned)(doy - (153 * mp + 2) / 5 + 1);
+    *month = (unsigned)(mp < 10 ? mp + 3 : mp - 9);
+    *year = (int64_t)yoe + era * 400 + (*month <= 2);
+}
+
+static int is_leap_year(int64_t year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+/* Floor division, for instants before 1970 */
+static int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+/* ============================================================================
+ * PARSING
+ * ============================================================================ */
+
+int time_format_from_name(const char *name, int *frac_digits) {
+    static const struct {
+        const char *name;
+        TimeFormat format;
+        int frac_digits;
+    } NAMES[] = {
+        { "auto", TIME_EPOCH_AUTO, 0 }, { "s", TIME_EPOCH_S, 0 },
+        { "ms", TIME_EPOCH_MS, 0 },     { "us", TIME_EPOCH_US, 0 },
+        { "ns", TIME_EPOCH_NS, 0 },     { "iso", TIME_ISO, 0 },
+        { "iso3", TIME_ISO, 3 },        { "iso6", TIME_ISO, 6 },
+        { "iso9", TIME_ISO, 9 },        { "ntp", TIME_NTP, 0 },
+        { "ptp", TIME_PTP, 0 },
+    };
+    for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+        if (strcmp(name, NAMES[i].name) == 0) {
+            if (frac_digits != NULL) {
+                *frac_digits = NAMES[i].frac_digits;
+            }
+            return (int)NAMES[i].format;
+        }
+    }
+    return -1;
+}
+
+/* Value of `count` decimal digits at str, or -1 */
+static int parse_digits(const char *str, size_t count) {
+    int value = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned d = (unsigned char)str[i] - '0';
+        if (d > 9) {
+            return -1;
+        }
+        value = value * 10 + (int)d;
+    }
+    return value;
+}
+
+/* Value of `count` hex digits at str (count <= 16) */
+static int parse_hex_digits(const char *str, size_t count, uint64_t *value) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned char c = (unsigned char)str[i];
+        unsigned d;
+        if (c >= '0' && c <= '9') {
+            d = c - '0';
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            d = (c | 0x20) - 'a' + 10;
+        } else {
+            return 0;
+        }
+        v = v << 4 | d;
+    }
+    *value = v;
+    return 1;
+}
+
+/*
+ * Fractional digits at str (stopping at the first non-digit) as
+ * nanoseconds, where `scale_digits` digits make up a whole nanosecond
+ * (9 for a fraction of a second, 6 of a millisecond, ...). Digits past
+ * that are dropped. Returns the digits consumed.
+ */
+static size_t parse_fraction(const char *str, size_t len, int scale_digits, uint32_t *nanos) {
+    static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000,
+                                      10000000, 100000000, 1000000000 };
+    uint32_t value = 0;
+    size_t i = 0, kept = 0;
+    for (; i < len && str[i] >= '0' && str[i] <= '9'; i++) {
+        if (kept < (size_t)scale_digits) {
+            value = value * 10 + (uint32_t)(str[i] - '0');
+            kept++;
+        }
+    }
+    *nanos = value * POW10[scale_digits - kept];
+    return i;
+}
+
+static ConversionResult parse_epoch(const char *str, size_t len, TimeFormat unit,
+                                    Timestamp *ts) {
+    size_t pos = 0;
+    int negative = len > 0 && str[0] == '-';
+    pos += (size_t)negative;
+
+    uint64_t value = 0;
+    size_t int_digits = 0;
+    for (; pos < len && str[pos] >= '0' && str[pos] <= '9'; pos++, int_digits++) {
+        if (value > (UINT64_C(1) << 63) / 10) {
+            return RESULT_OVERFLOW;
+        }
+        value = value * 10 + (uint64_t)(str[pos] - '0');
+    }
+    if (int_digits == 0 || value > (uint64_t)INT64_MAX) {
+        return int_digits == 0 ? RESULT_INVALID_INPUT : RESULT_OVERFLOW;
+    }
+
+    if (unit == TIME_EPOCH_AUTO) {
+        // 11 digits of seconds reach the year 5138
+        unit = int_digits <= 11 ? TIME_EPOCH_S :
+               int_digits <= 14 ? TIME_EPOCH_MS :
+               int_digits <= 17 ? TIME_EPOCH_US : TIME_EPOCH_NS;
+    }
+
+    uint64_t per_second = UNITS_PER_SECOND[unit];
+    uint32_t frac_nanos = 0;
+    if (pos < len && str[pos] == '.') {
+        static const int UNIT_FRACTION_DIGITS[] = { 9, 9, 6, 3, 0 };
+        size_t n = parse_fraction(str + pos + 1, len - pos - 1,
+                                  UNIT_FRACTION_DIGITS[unit], &frac_nanos);
+        if (n == 0) {
+            return RESULT_INVALID_INPUT;
+        }
+        pos += 1 + n;
+    }
+    if (pos != len) {
+        return RESULT_INVALID_INPUT;
+    }
+
+    int64_t seconds = (int64_t)(value / per_second);
+    uint32_t nanos = (uint32_t)(value % per_second) * NANOS_PER_UNIT[unit] + frac_nanos;
+    if (negative) {
+        seconds = -seconds - (nanos > 0);
+        nanos = nanos > 0 ? NANOS_PER_SECOND - nanos : 0;
+    }
+    ts->seconds = seconds;
+    ts->nanos = nanos;
+    return RESULT_OK;
+}
+
+static ConversionResult parse_iso(const char *str, size_t len, Timestamp *ts) {
+    if (len < 10 || str[4] != '-' || str[7] != '-') {
+        return RESULT_INVALID_INPUT;
+    }
+    int year = parse_digits(str, 4);
+    int month = parse_digits(str + 5, 2);
+    int day = parse_digits(str + 8, 2);
+    int hour = 0, minute = 0, second = 0;
+    uint32_t nanos = 0;
+    int offset = 0;  // Seconds east of UTC
+
+    size_t pos = 10;
+    if (pos < len) {
+        if (len < 19 || (str[10] != 'T' && str[10] != 't' && str[10] != ' ') ||
+            str[13] != ':' || str[16] != ':') {
+            return RESULT_INVALID_INPUT;
+        }
+        hour = parse_digits(str + 11, 2);
+        minute = parse_digits(str + 14, 2);
+        second = parse_digits(str + 17, 2);
+        pos = 19;
+
+        if (pos < len && (str[pos] == '.' || str[pos] == ',')) {
+            size_t n = parse_fraction(str + pos + 1, len - pos - 1, 9, &nanos);
+            if (n == 0) {
+                return RESULT_INVALID_INPUT;
+            }
+            pos += 1 + n;
+        }
+
+        if (pos < len && (str[pos] == 'Z' || str[pos] == 'z')) {
+            pos++;
+        } else if (pos < len && (str[pos] == '+' || str[pos] == '-')) {
+            // +HH:MM, +HHMM or +HH
+            int sign = str[pos] == '-' ? -1 : 1;
+            const char *zone = str + pos + 1;
+            size_t zone_len = len - pos - 1;
+            int off_hours = -1, off_minutes = 0;
+            if (zone_len == 2 || zone_len == 4) {
+                off_hours = parse_digits(zone, 2);
+                off_minutes = zone_len == 4 ? parse_digits(zone + 2, 2) : 0;
+            } else if (zone_len == 5 && zone[2] == ':') {
+                off_hours = parse_digits(zone, 2);
+                off_minutes = parse_digits(zone + 3, 2);
+            }
+            if (off_hours < 0 || off_hours > 23 || off_minutes < 0 || off_minutes > 59) {
+                return RESULT_INVALID_INPUT;
+            }
+            pos = len;
+            offset = sign * (off_hours * 3600 + off_minutes * 60);
+        }
+        if (pos != len) {
+            return RESULT_INVALID_INPUT;
+        }
+    }
+
+    // Second 60 is a leap second; it is counted as the next second
+    if (year < 0 || month < 1 || month > 12 || day < 1 ||
+        day > DAYS_IN_MONTH[month - 1] + (month == 2 && is_leap_year(year)) ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60) {
+        return RESULT_INVALID_INPUT;
+    }
+
+    ts->seconds = days_from_civil(year, (unsigned)month, (unsigned)day) * SECONDS_PER_DAY +
+                  hour * 3600 + minute * 60 + second - offset;
+    ts->nanos = nanos;
+    return RESULT_OK;
+}
+
+/* "hhhhhhhh.ffffffff" or 16 hex digits, optional 0x; `high` digits before the dot */
+static int split_hex_pair(const char *str, size_t len, size_t high, size_t low,
+                          uint64_t *hi_value, uint64_t *lo_value) {
+    if (len >= 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        str += 2;
+        len -= 2;
+    }
+    if (len == high + low) {
+        return parse_hex_digits(str, high, hi_value) &&
+               parse_hex_digits(str + high, low, lo_value);
+    }
+    if (len == high + 1 + low && str[high] == '.') {
+        return parse_hex_digits(str, high, hi_value) &&
+               parse_hex_digits(str + high + 1, low, lo_value);
+    }
+    return 0;
+}
+
+static ConversionResult parse_ntp(const char *str, size_t len, Timestamp *ts) {
+    uint64_t seconds, fraction;
+    if (!split_hex_pair(str, len, 8, 8, &seconds, &fraction)) {
+        return RESULT_INVALID_INPUT;
+    }
+    // RFC 4330: with the top bit clear the value is in era 1 (2036-2104)
+    if (!(seconds & 0x80000000u)) {
+        seconds += UINT64_C(1) << 32;
+    }
+    ts->seconds = (int64_t)seconds - NTP_UNIX_OFFSET;
+    ts->nanos = (uint32_t)((fraction * NANOS_PER_SECOND + (UINT64_C(1) << 31)) >> 32);
+    if (ts->nanos >= NANOS_PER_SECOND) {
+        // Fractions from 0xfffffffe round up to the next second
+        ts->nanos -= NANOS_PER_SECOND;
+        ts->seconds++;
+    }
+    return RESULT_OK;
+}
+
+static ConversionResult parse_ptp(const char *str, size_t len, Timestamp *ts) {
+    uint64_t seconds, nanos;
+    if (!split_hex_pair(str, len, 12, 8, &seconds, &nanos) || nanos >= NANOS_PER_SECOND) {
+        return RESULT_INVALID_INPUT;
+    }
+    ts->seconds = (int64_t)seconds - PTP_UTC_OFFSET;
+    ts->nanos = (uint32_t)nanos;
+    return RESULT_OK;
+}
+
+ConversionResult parse_timestamp(const char *str, size_t len, TimeFormat format,
+                                 Timestamp *ts) {
+    switch (format) {
+    case TIME_ISO:
+        return parse_iso(str, len, ts);
+    case TIME_NTP:
+        return parse_ntp(str, len, ts);
+    case TIME_PTP:
+        return parse_ptp(str, len, ts);
+    default:
+        return parse_epoch(str, len, format, ts);
+    }
+}
+
+/* ============================================================================
+ * FORMATTING
+ * ============================================================================ */
+
+/* The formatted "YYYY-MM-DD" of the last day seen (batch mode) */
+typedef struct {
+    int64_t days;
+    char date[10];
+} DateCache;
+
+static void put_pair(char *dst, unsigned value) {
+    memcpy(dst, DIGIT_PAIRS + 2 * value, 2);
+}
+
+static size_t format_iso(const Timestamp *ts, int frac_digits, char *dst, DateCache *cache) {
+    int64_t days = floor_div(ts->seconds, SECONDS_PER_DAY);
+    unsigned second_of_day = (unsigned)(ts->seconds - days * SECONDS_PER_DAY);
+
+    if (cache == NULL || cache->days != days) {
+        int64_t year;
+        unsigned month, day;
+        civil_from_days(days, &year, &month, &day);
+        if (year < 0 || year > 9999) {
+            return 0;
+        }
+        char *date = cache != NULL ? cache->date : dst;
+        put_pair(date, (unsigned)(year / 100));
+        put_pair(date + 2, (unsigned)(year % 100));
+        date[4] = '-';
+        put_pair(date + 5, month);
+        date[7] = '-';
+        put_pair(date + 8, day);
+        if (cache != NULL) {
+            cache->days = days;
+        }
+    }
+    if (cache != NULL) {
+        memcpy(dst, cache->date, 10);
+    }
+
+    dst[10] = 'T';
+    put_pair(dst + 11, second_of_day / 3600);
+    dst[13] = ':';
+    put_pair(dst + 14, second_of_day / 60 % 60);
+    dst[16] = ':';
+    put_pair(dst + 17, second_of_day % 60);
+    size_t len = 19;
+
+    if (frac_digits > 0) {
+        // Nine digits, then keep the requested precision (truncated)
+        char digits[9];
+        uint32_t nanos = ts->nanos;
+        for (int i = 8; i >= 0; i--) {
+            digits[i] = (char)('0' + nanos % 10);
+            nanos /= 10;
+        }
+        dst[len++] = '.';
+        memcpy(dst + len, digits, (size_t)frac_digits);
+        len += (size_t)frac_digits;
+    }
+    dst[len++] = 'Z';
+    return len;
+}
+
+static size_t format_signed(int64_t value, char *dst) {
+    char digits[20];
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    size_t len = 0;
+    if (value < 0) {
+        dst[len++] = '-';
+    }
+    while (n > 0) {
+        dst[len++] = digits[--n];
+    }
+    return len;
+}
+
+static size_t format_epoch(const Timestamp *ts, TimeFormat unit, char *dst) {
+    int64_t whole;
+    int64_t units = (int64_t)(ts->nanos / NANOS_PER_UNIT[unit]);
+    if (__builtin_mul_overflow(ts->seconds, (int64_t)UNITS_PER_SECOND[unit], &whole) ||
+        __builtin_add_overflow(whole, units, &whole)) {
+        return 0;
+    }
+    return format_signed(whole, dst);
+}
+
+static size_t format_any(const Timestamp *ts, TimeFormat format, int frac_digits,
+                         char *buffer, DateCache *cache) {
+    switch (format) {
+    case TIME_ISO:
+        return format_iso(ts, frac_digits, buffer, cache);
+    case TIME_NTP: {
+        // Era 0 and the era-1 window that parse_ntp() reads back
+        int64_t seconds = ts->seconds + NTP_UNIX_OFFSET;
+        if (seconds < 0x80000000LL || seconds >= (INT64_C(3) << 31)) {
+            return 0;
+        }
+        uint32_t fraction = (uint32_t)((((uint64_t)ts->nanos << 32) + NANOS_PER_SECOND / 2) /
+                                       NANOS_PER_SECOND);
+        return (size_t)snprintf(buffer, TIME_STR_MAX, "%08x.%08x",
+                                (uint32_t)seconds, fraction);
+    }
+    case TIME_PTP: {
+        int64_t seconds = ts->seconds + PTP_UTC_OFFSET;
+        if (seconds < 0 || seconds >= (INT64_C(1) << 48)) {
+            return 0;
+        }
+        return (size_t)snprintf(buffer, TIME_STR_MAX, "%012llx.%08x",
+                                (unsigned long long)seconds, ts->nanos);
+    }
+    case TIME_EPOCH_AUTO:
+        return format_epoch(ts, TIME_EPOCH_S, buffer);
+    default:
+        return format_epoch(ts, format, buffer);
+    }
+}
+
+size_t format_timestamp(const Timestamp *ts, TimeFormat format, int frac_digits,
+                        char *buffer) {
+    return format_any(ts, format, frac_digits, buffer, NULL);
+}
+
+/* ============================================================================
+ * BATCH CONVERSION
+ * ============================================================================ */
+
+typedef struct {
+    int column;
+    TimeFormat from;
+    TimeFormat to;
+    int frac_digits;
+    DateCache cache;
+    OutBuf *out;
+    uint64_t line;
+    uint64_t invalid;
+} LineConverter;
+
+static void convert_line(void *ctx, const char *line, size_t len) {
+    LineConverter *lc = ctx;
+    lc->line++;
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+
+    size_t first = 0;
+    while (first < len && (line[first] == ' ' || line[first] == '\t')) {
+        first++;
+    }
+    if (first == len) {
+        return;  // Blank line
+    }
+
+    size_t start, end;
+    find_column(line, len, lc->column, &start, &end);
+
+    Timestamp ts;
+    char formatted[TIME_STR_MAX];
+    size_t n = 0;
+    if (start < end && parse_timestamp(line + start, end - start, lc->from, &ts) == RESULT_OK) {
+        n = format_any(&ts, lc->to, lc->frac_digits, formatted, &lc->cache);
+    }
+    if (n == 0) {
+        if (lc->invalid++ < MAX_REPORTED_LINES) {
+            fprintf(stderr, "Line %llu: no convertible timestamp in field %d: %.*s\n",
+                    (unsigned long long)lc->line, lc->column, (int)len, line);
+        }
+        return;
+    }
+
+    outbuf_write(lc->out, line, start);
+    outbuf_write(lc->out, formatted, n);
+    outbuf_write(lc->out, line + end, len - end);
+    outbuf_write(lc->out, "\n", 1);
+}
+
+ConversionResult timestamp_convert_lines(const char *path, int column,
+                                         TimeFormat from, TimeFormat to,
+                                         int frac_digits, int out_fd) {
+    LineConverter lc = { column, from, to, frac_digits, { INT64_MIN, { 0 } }, NULL, 0, 0 };
+    lc.out = outbuf_open(out_fd);
+    if (lc.out == NULL) {
+        return RESULT_OVERFLOW;
+    }
+
+    ConversionResult result = for_each_line(path, convert_line, &lc);
+    ConversionResult written = outbuf_close(lc.out);
+    if (result != RESULT_OK) {
+        return result;
+    }
+    result = written;
+    if (lc.invalid > 0) {
+        fprintf(stderr, "%llu line(s) without a timestamp skipped\n",
+                (unsigned long long)lc.invalid);
+        if (result == RESULT_OK) {
+            result = RESULT_INVALID_INPUT;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,89 @@
+/*
+ * Binary Data Converter - Timestamps
+ *
+ * Conversions between the time formats found in logs and packet
+ * headers:
+ *
+ *   epoch    seconds, milliseconds, microseconds or nanoseconds since
+ *            1970-01-01 UTC, optionally with a decimal fraction
+ *            ("1700000000.25")
+ *   iso      ISO-8601 / RFC 3339, "2023-11-14T22:13:20.25Z"; a numeric
+ *            offset ("+01:00") is applied, no offset means UTC
+ *   ntp      NTP 64-bit timestamp (RFC 5905): 32-bit seconds since 1900
+ *            and a 32-bit binary fraction, written "e8fe6f80.40000000"
+ *   ptp      IEEE 1588 timestamp: 48-bit seconds and 32-bit nanoseconds
+ *            on the TAI scale, written "00006553f125.0ee6b280"
+ *
+ * Calendar conversion is plain integer arithmetic on day numbers (no
+ * gmtime/timegm), so it is the same on every platform and fast enough
+ * for batch conversion of whole log files.
+ */
+
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+
+/* Longest formatted value: "-1677-09-21T00:12:43.145224192Z" style ISO */
+#define TIME_STR_MAX 40
+
+/* Seconds between 1900-01-01 (NTP era 0) and 1970-01-01 */
+#define NTP_UNIX_OFFSET 2208988800LL
+
+/* TAI - UTC since 2017-01-01; PTP time runs on TAI */
+#define PTP_UTC_OFFSET 37
+
+/* A UTC instant: seconds since 1970 (leap seconds not counted) + ns */
+typedef struct {
+    int64_t seconds;
+    uint32_t nanos;
+} Timestamp;
+
+typedef enum {
+    TIME_EPOCH_AUTO,    // Parsing only: unit guessed from the digit count
+    TIME_EPOCH_S,
+    TIME_EPOCH_MS,
+    TIME_EPOCH_US,
+    TIME_EPOCH_NS,
+    TIME_ISO,
+    TIME_NTP,
+    TIME_PTP
+} TimeFormat;
+
+/* Days since 1970-01-01 of a proleptic Gregorian date, and back */
+int64_t days_from_civil(int64_t year, unsigned month, unsigned day);
+void civil_from_days(int64_t days, int64_t *year, unsigned *month, unsigned *day);
+
+/*
+ * Format name ("auto", "s", "ms", "us", "ns", "iso", "iso3", "iso6",
+ * "iso9", "ntp", "ptp") to format; "isoN" also sets *frac_digits.
+ * Returns -1 for an unknown name.
+ */
+int time_format_from_name(const char *name, int *frac_digits);
+
+ConversionResult parse_timestamp(const char *str, size_t len, TimeFormat format,
+                                 Timestamp *ts);
+
+/*
+ * Format into `buffer` (TIME_STR_MAX bytes; no terminator added) and
+ * return the length, or 0 if the value cannot be shown in that format
+ * (a year outside 0000-9999, a negative NTP/PTP time, ...). frac_digits
+ * (0, 3, 6 or 9) applies to ISO output; epoch formats print whole units.
+ */
+size_t format_timestamp(const Timestamp *ts, TimeFormat format, int frac_digits,
+                        char *buffer);
+
+/*
+ * Rewrite field `column` (1-based, whitespace-separated) of every line
+ * of `path` (NULL = stdin) from one format to another. Lines whose
+ * field does not parse are reported on stderr and skipped; returns
+ * RESULT_INVALID_INPUT if there were any.
+ */
+ConversionResult timestamp_convert_lines(const char *path, int column,
+                                         TimeFormat from, TimeFormat to,
+                                         int frac_digits, int out_fd);
+
+#endif /* TIMESTAMP_H */
@@ -0,0 +1,368 @@
+/*
+ * Binary Data Converter - Varints
+ *
+ * See varint.h for the encodings. The bulk decoder has two tiers: an
+ * AVX2 + BMI2 block decoder for the bulk of a stream and the scalar
+ * decoder, which finishes the tail and reports malformed input.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "varint.h"
+#include "file_io.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VARINT_HAVE_X86 1
+#endif
+
+/* ============================================================================
+ * SINGLE VALUES
+ * ============================================================================ */
+
+size_t varint_encode(uint64_t value, uint8_t *out) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+size_t sleb128_encode(int64_t value, uint8_t *out) {
+    size_t n = 0;
+    for (;;) {
+        uint8_t byte = (uint8_t)(value & 0x7F);
+        value >>= 7;  // Arithmetic shift keeps the sign
+        // Done once the rest is pure sign extension of bit 6
+        if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+            out[n++] = byte;
+            return n;
+        }
+        out[n++] = byte | 0x80;
+    }
+}
+
+ConversionResult varint_decode(const uint8_t *data, size_t len,
+                               uint64_t *value, size_t *consumed) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < len && i < VARINT_MAX_BYTES; i++) {
+        uint8_t byte = data[i];
+        if (i == VARINT_MAX_BYTES - 1 && byte > 1) {
+            return RESULT_OVERFLOW;  // Only bit 63 is left for the 10th byte
+        }
+        v |= (uint64_t)(byte & 0x7F) << (7 * i);
+        if (!(byte & 0x80)) {
+            *value = v;
+            *consumed = i + 1;
+            return RESULT_OK;
+        }
+    }
+    return len < VARINT_MAX_BYTES ? RESULT_INVALID_INPUT : RESULT_OVERFLOW;
+}
+
+ConversionResult sleb128_decode(const uint8_t *data, size_t len,
+                                int64_t *value, size_t *consumed) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < len && i < VARINT_MAX_BYTES; i++) {
+        uint8_t byte = data[i];
+        unsigned shift = 7 * (unsigned)i;
+        v |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            if (i == VARINT_MAX_BYTES - 1) {
+                // Bits above 63 must all repeat the sign bit
+                if ((byte & 0x7F) != 0 && (byte & 0x7F) != 0x7F) {
+                    return RESULT_OVERFLOW;
+                }
+            } else if (byte & 0x40) {
+                v |= ~0ULL << (shift + 7);
+            }
+            *value = (int64_t)v;
+            *consumed = i + 1;
+            return RESULT_OK;
+        }
+    }
+    return len < VARINT_MAX_BYTES ? RESULT_INVALID_INPUT : RESULT_OVERFLOW;
+}
+
+/* ============================================================================
+ * BULK DECODING
+ * ============================================================================ */
+
+/* Continue decoding from *pos / *count; stops at a truncated or bad value */
+static ConversionResult decode_scalar(const uint8_t *data, size_t len,
+                                      uint64_t *values, size_t max_values,
+                                      size_t *count_io, size_t *pos_io) {
+    ConversionResult result = RESULT_OK;
+    size_t count = *count_io, pos = *pos_io;
+
+    while (count < max_values && pos < len) {
+        if (data[pos] < 0x80) {
+            values[count++] = data[pos++];
+            continue;
+        }
+        size_t used;
+        ConversionResult r = varint_decode(data + pos, len - pos, &values[count], &used);
+        if (r != RESULT_OK) {
+            if (r == RESULT_OVERFLOW) {
+                result = r;
+            }
+            break;  // A value cut off at the end is left for the caller
+        }
+        count++;
+        pos += used;
+    }
+
+    *count_io = count;
+    *pos_io = pos;
+    return result;
+}
+
+#ifdef VARINT_HAVE_X86
+
+#define PAYLOAD_BITS 0x7F7F7F7F7F7F7F7FULL
+
+/*
+ * Decode whole 64-byte blocks while at least 64 values fit. Stops early
+ * at anything unusual (a value longer than 10 bytes, a stray 10th-byte
+ * bit) and leaves it to the scalar decoder to report.
+ */
+__attribute__((target("avx2,bmi,bmi2")))
+static void decode_avx2(const uint8_t *data, size_t len,
+                        uint64_t *values, size_t max_values,
+                        size_t *count_io, size_t *pos_io) {
+    size_t count = *count_io, pos = *pos_io;
+
+    // The pext loads read up to 8 bytes past a value's start
+    while (len - pos >= 64 + 8 && max_values - count >= 64) {
+        const uint8_t *block = data + pos;
+        __m256i lo = _mm256_loadu_si256((const __m256i *)block);
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+        uint64_t more = (uint64_t)(uint32_t)_mm256_movemask_epi8(lo) |
+                        ((uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32);
+
+        if (more == 0) {
+            // 64 single-byte values: widen them straight into the output
+            for (int i = 0; i < 64; i += 4) {
+                uint32_t four;
+                memcpy(&four, block + i, 4);
+                _mm256_storeu_si256((__m256i *)(values + count + i),
+                                    _mm256_cvtepu8_epi64(_mm_cvtsi32_si128((int)four)));
+            }
+            count += 64;
+            pos += 64;
+            continue;
+        }
+
+        // Each clear continuation bit ends a value
+        uint64_t ends = ~more;
+        size_t start = 0;
+        int stop = 0;
+        while (ends != 0) {
+            size_t end = _tzcnt_u64(ends);
+            size_t n = end - start + 1;
+            uint64_t word;
+            memcpy(&word, block + start, 8);
+
+            uint64_t v;
+            if (n <= 8) {
+                v = _pext_u64(word, PAYLOAD_BITS >> (64 - 8 * n));
+            } else if (n == 9) {
+                v = _pext_u64(word, PAYLOAD_BITS) | ((uint64_t)block[start + 8] << 56);
+            } else if (n == 10 && block[start + 9] <= 1) {
+                v = _pext_u64(word, PAYLOAD_BITS) |
+                    ((uint64_t)(block[start + 8] & 0x7F) << 56) |
+                    ((uint64_t)block[start + 9] << 63);
+            } else {
+                stop = 1;
+                break;
+            }
+            values[count++] = v;
+            start = end + 1;
+            ends = _blsr_u64(ends);
+        }
+
+        // A value still open at the block end restarts the next block
+        pos += start;
+        if (stop || start == 0) {
+            break;
+        }
+    }
+
+    *count_io = count;
+    *pos_io = pos;
+}
+
+#endif /* VARINT_HAVE_X86 */
+
+ConversionResult varint_decode_bulk(const uint8_t *data, size_t len,
+                                    uint64_t *values, size_t max_values,
+                                    size_t *num_values, size_t *consumed) {
+    size_t count = 0, pos = 0;
+
+#ifdef VARINT_HAVE_X86
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+        decode_avx2(data, len, values, max_values, &count, &pos);
+    }
+#endif
+
+    ConversionResult result = decode_scalar(data, len, values, max_values, &count, &pos);
+    *num_values = count;
+    *consumed = pos;
+    return result;
+}
+
+/* ============================================================================
+ * FILE MODES
+ * ============================================================================ */
+
+/* Values decoded per call to the bulk decoder */
+#define DECODE_BATCH 4096
+
+/* "-9223372036854775808" or "18446744073709551615" plus newline */
+#define DECIMAL_LINE_MAX 22
+
+static size_t format_decimal_line(uint64_t magnitude, int negative, char *dst) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    size_t len = 0;
+    if (negative) {
+        dst[len++] = '-';
+    }
+    while (n > 0) {
+        dst[len++] = digits[--n];
+    }
+    dst[len++] = '\n';
+    return len;
+}
+
+ConversionResult varint_decode_file(const char *path, uint64_t offset,
+                                    uint64_t length, int zigzag, int out_fd) {
+    MappedFile file;
+    ConversionResult result = map_file_range(path, offset, length, &file);
+    if (result != RESULT_OK) {
+        return result;
+    }
+    OutBuf *out = outbuf_open(out_fd);
+    if (out == NULL) {
+        unmap_file(&file);
+        return RESULT_OVERFLOW;
+    }
+
+    uint64_t values[DECODE_BATCH];
+    size_t pos = 0;
+    while (pos < file.size) {
+        size_t count, used;
+        result = varint_decode_bulk(file.data + pos, file.size - pos, values,
+                                    DECODE_BATCH, &count, &used);
+        for (size_t i = 0; i < count; i++) {
+            char *dst = outbuf_reserve(out, DECIMAL_LINE_MAX);
+            if (zigzag) {
+                int64_t v = zigzag_decode(values[i]);
+                uint64_t magnitude = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+                outbuf_commit(out, format_decimal_line(magnitude, v < 0, dst));
+            } else {
+                outbuf_commit(out, format_decimal_line(values[i], 0, dst));
+            }
+        }
+        pos += used;
+        if (result != RESULT_OK || count == 0) {
+            break;
+        }
+    }
+
+    ConversionResult out_result = outbuf_close(out);
+    if (pos < file.size) {
+        fprintf(stderr, "Error: %s varint at offset 0x%llx\n",
+                result == RESULT_OVERFLOW ? "Malformed" : "Truncated",
+                (unsigned long long)(file.offset + pos));
+        result = RESULT_FORMAT_ERROR;
+    } else {
+        result = out_result;
+    }
+    unmap_file(&file);
+    return result;
+}
+
+typedef struct {
+    int zigzag;
+    OutBuf *out;
+    uint64_t line;
+    uint64_t invalid;
+} LineEncoder;
+
+static void encode_line(void *ctx, const char *line, size_t len) {
+    LineEncoder *le = ctx;
+    le->line++;
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t')) {
+        len--;
+    }
+    while (len > 0 && (*line == ' ' || *line == '\t')) {
+        line++;
+        len--;
+    }
+    if (len == 0) {
+        return;  // Blank line
+    }
+
+    // strtoull/strtoll need a terminated copy; anything longer is not a number
+    char number[32];
+    int ok = len < sizeof(number);
+    uint64_t value = 0;
+    if (ok) {
+        memcpy(number, line, len);
+        number[len] = '\0';
+        char *endptr;
+        errno = 0;
+        if (le->zigzag) {
+            value = zigzag_encode((int64_t)strtoll(number, &endptr, 0));
+        } else {
+            value = (uint64_t)strtoull(number, &endptr, 0);
+            ok = number[0] != '-';
+        }
+        ok = ok && errno == 0 && *endptr == '\0';
+    }
+    if (!ok) {
+        if (le->invalid++ < MAX_REPORTED_LINES) {
+            fprintf(stderr, "Line %llu: not %s 64-bit number: %.*s\n",
+                    (unsigned long long)le->line, le->zigzag ? "a signed" : "an unsigned",
+                    (int)len, line);
+        }
+        return;
+    }
+
+    uint8_t *dst = (uint8_t *)outbuf_reserve(le->out, VARINT_MAX_BYTES);
+    outbuf_commit(le->out, varint_encode(value, dst));
+}
+
+ConversionResult varint_encode_lines(const char *path, int zigzag, int out_fd) {
+    LineEncoder le = { zigzag, NULL, 0, 0 };
+    le.out = outbuf_open(out_fd);
+    if (le.out == NULL) {
+        return RESULT_OVERFLOW;
+    }
+
+    ConversionResult result = for_each_line(path, encode_line, &le);
+    ConversionResult written = outbuf_close(le.out);
+    if (result != RESULT_OK) {
+        return result;
+    }
+    result = written;
+    if (le.invalid > 0) {
+        fprintf(stderr, "%llu line(s) without a number skipped\n",
+                (unsigned long long)le.invalid);
+        if (result == RESULT_OK) {
+            result = RESULT_INVALID_INPUT;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,81 @@
+/*
+ * Binary Data Converter - Varints
+ *
+ * Variable-length integers as used by protobuf/gRPC, DWARF and
+ * WebAssembly. A varint (unsigned LEB128) stores 7 bits per byte, least
+ * significant group first; the top bit of each byte is the continuation
+ * bit (1 = more bytes follow):
+ *
+ *   300 = 0b100101100  ->  1 0101100   0 0000010  =  ac 02
+ *
+ * Signed values use one of two schemes. Zigzag (protobuf sint32/sint64)
+ * maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ... so small negatives stay
+ * short. Signed LEB128 (DWARF, WebAssembly) sign-extends from bit 6 of
+ * the last byte instead.
+ */
+
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "converter.h"
+
+/* Longest 64-bit varint: ceil(64 / 7) bytes */
+#define VARINT_MAX_BYTES 10
+
+static inline uint64_t zigzag_encode(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/* Encode into `out` (VARINT_MAX_BYTES of room); returns the length */
+size_t varint_encode(uint64_t value, uint8_t *out);
+size_t sleb128_encode(int64_t value, uint8_t *out);
+
+/*
+ * Decode one value from the start of `data`. Returns RESULT_INVALID_INPUT
+ * if the data ends mid-value and RESULT_OVERFLOW if the value does not
+ * fit in 64 bits (more than 10 bytes, or stray bits in the 10th).
+ */
+ConversionResult varint_decode(const uint8_t *data, size_t len,
+                               uint64_t *value, size_t *consumed);
+ConversionResult sleb128_decode(const uint8_t *data, size_t len,
+                                int64_t *value, size_t *consumed);
+
+/*
+ * Decode consecutive varints from `data` into `values` until
+ * `max_values` are stored or the data runs out. *consumed is the number
+ * of bytes used; a value cut off at the end of the data is left
+ * unconsumed. Returns RESULT_OVERFLOW at a malformed value, with
+ * everything before it decoded.
+ *
+ * On CPUs with AVX2 and BMI2 the decoder takes the continuation bits of
+ * 64 bytes at once (one byte-sign mask, as in Masked VByte), walks the
+ * value ends in it with tzcnt, and gathers each value's 7-bit groups with
+ * a single pext. Blocks of single-byte values are widened directly.
+ */
+ConversionResult varint_decode_bulk(const uint8_t *data, size_t len,
+                                    uint64_t *values, size_t max_values,
+                                    size_t *num_values, size_t *consumed);
+
+/*
+ * Print the values of a varint stream in `path` (a byte range of it, as
+ * for the hexdump), one decimal per line; `zigzag` decodes them as
+ * signed.
+ */
+ConversionResult varint_decode_file(const char *path, uint64_t offset,
+                                    uint64_t length, int zigzag, int out_fd);
+
+/*
+ * Encode the numbers in `path` (NULL = stdin), one per line, as a varint
+ * stream written to out_fd. `zigzag` accepts negative numbers and
+ * encodes them the sint64 way.
+ */
+ConversionResult varint_encode_lines(const char *path, int zigzag, int out_fd);
+
+#endif /* VARINT_H */